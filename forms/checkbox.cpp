@@ -43,11 +43,11 @@ void CheckBox::OnRender()
 	{
 		if (useimage->size == Vec2<unsigned int>{Size.x, Size.y})
 		{
-			fw().renderer->draw(useimage, Vec2<float>{0, 0});
+			fw().renderer->draw(useimage, renderOffset);
 		}
 		else
 		{
-			fw().renderer->drawScaled(useimage, Vec2<float>{0, 0},
+			fw().renderer->drawScaled(useimage, renderOffset,
 			                          Vec2<float>{this->Size.x, this->Size.y});
 		}
 	}
@@ -67,6 +67,7 @@ void CheckBox::SetChecked(bool checked)
 	if (Checked == checked)
 		return;
 	Checked = checked;
+	SetDirty();
 	this->pushFormEvent(FormEventType::CheckBoxChange, nullptr);
 	if (checked)
 	{
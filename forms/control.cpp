@@ -2,6 +2,7 @@
 
 #include "forms/control.h"
 #include "framework/framework.h"
+#include "framework/metrics.h"
 #include "forms/forms.h"
 
 namespace OpenApoc
@@ -10,7 +11,9 @@ namespace OpenApoc
 Control::Control(bool takesFocus)
     : mouseInside(false), mouseDepressed(false), resolvedLocation(0, 0), Name("Control"),
       Location(0, 0), Size(0, 0), BackgroundColour(0, 0, 0, 0), takesFocus(takesFocus),
-      showBounds(false), Visible(true), canCopy(true), data(nullptr)
+      showBounds(false), Visible(true), canCopy(true), data(nullptr), dirty(true),
+      renderedLocation(0, 0), renderedSize(0, 0), renderedVisible(false),
+      renderedShowBounds(false), renderedChildren(0), renderOffset(0, 0)
 {
 }
 
@@ -54,6 +57,9 @@ void Control::ResolveLocation()
 
 void Control::EventOccured(Event *e)
 {
+	bool wasInside = mouseInside;
+	bool wasDepressed = mouseDepressed;
+
 	for (auto ctrlidx = Controls.rbegin(); ctrlidx != Controls.rend(); ctrlidx++)
 	{
 		auto c = *ctrlidx;
@@ -219,41 +225,139 @@ void Control::EventOccured(Event *e)
 			e->Handled = true;
 		}
 	}
+
+	// Buttons and the like draw differently when hovered or pressed
+	if (mouseInside != wasInside || mouseDepressed != wasDepressed)
+	{
+		SetDirty();
+	}
+}
+
+void Control::SetDirty()
+{
+	dirty = true;
+	// A dirty control's parents are always dirty too, so there's no need to go any further
+	auto parent = this->GetParent();
+	if (parent && !parent->dirty)
+	{
+		parent->SetDirty();
+	}
+}
+
+bool Control::NeedsClipping() { return !Controls.empty(); }
+
+bool Control::ChangedSinceRender() const { return false; }
+
+void Control::FindChanges()
+{
+	if (Location != renderedLocation || Size != renderedSize ||
+	    BackgroundColour != renderedBackground || Visible != renderedVisible ||
+	    showBounds != renderedShowBounds || Controls.size() != renderedChildren ||
+	    ChangedSinceRender())
+	{
+		SetDirty();
+	}
+	if (!Visible)
+	{
+		return;
+	}
+	for (auto &c : Controls)
+	{
+		c->FindChanges();
+	}
+}
+
+void Control::RecordRenderedState()
+{
+	renderedLocation = Location;
+	renderedSize = Size;
+	renderedBackground = BackgroundColour;
+	renderedVisible = Visible;
+	renderedShowBounds = showBounds;
+	renderedChildren = Controls.size();
 }
 
 void Control::Render()
+{
+	// Children are only checked when their parent is rendered, and a clean parent won't render
+	// them, so everything has to be checked up front
+	FindChanges();
+	RenderControl();
+}
+
+void Control::RenderControl()
 {
 	if (!Visible || Size.x == 0 || Size.y == 0)
 	{
+		dirty = false;
+		RecordRenderedState();
 		return;
 	}
 
-	if (controlArea == nullptr || controlArea->size != Vec2<unsigned int>(Size))
+	sp<Palette> previousPalette = fw().renderer->getPalette();
+	if (this->palette)
 	{
-		controlArea.reset(new Surface{Vec2<unsigned int>(Size)});
+		fw().renderer->setPalette(this->palette);
 	}
+	// Anything drawn with the palette that's inherited from the parent has to be redrawn if that
+	// palette changes
+	if (fw().renderer->getPalette() != renderedPalette)
 	{
-		sp<Palette> previousPalette;
-		if (this->palette)
-		{
-			previousPalette = fw().renderer->getPalette();
-			fw().renderer->setPalette(this->palette);
-		}
+		renderedPalette = fw().renderer->getPalette();
+		dirty = true;
+	}
 
-		RendererSurfaceBinding b(*fw().renderer, controlArea);
+	if (!NeedsClipping())
+	{
+		// Draw straight into the parent's surface, which is where this gets cached
+		controlArea.reset();
+		renderOffset = Location;
 		PreRender();
 		OnRender();
 		PostRender();
-		if (this->palette)
+		renderOffset = {0, 0};
+	}
+	else
+	{
+		if (controlArea == nullptr || controlArea->size != Vec2<unsigned int>(Size))
 		{
-			fw().renderer->setPalette(previousPalette);
+			controlArea.reset(new Surface{Vec2<unsigned int>(Size)});
+			dirty = true;
+		}
+		if (dirty)
+		{
+			static auto &surfaceRedraws = Metrics::counter("Forms.SurfaceRedraws");
+			surfaceRedraws.add();
+			RendererSurfaceBinding b(*fw().renderer, controlArea);
+			PreRender();
+			OnRender();
+			PostRender();
 		}
 	}
+	dirty = false;
+	RecordRenderedState();
 
-	fw().renderer->draw(controlArea, Location);
+	if (this->palette)
+	{
+		fw().renderer->setPalette(previousPalette);
+	}
+	if (controlArea)
+	{
+		fw().renderer->draw(controlArea, Location);
+	}
 }
 
-void Control::PreRender() { fw().renderer->clear(BackgroundColour); }
+void Control::PreRender()
+{
+	if (controlArea)
+	{
+		fw().renderer->clear(BackgroundColour);
+	}
+	else if (BackgroundColour.a != 0)
+	{
+		fw().renderer->drawFilledRect(renderOffset, Size, BackgroundColour);
+	}
+}
 
 void Control::OnRender()
 {
@@ -265,14 +369,21 @@ void Control::PostRender()
 	for (auto ctrlidx = Controls.begin(); ctrlidx != Controls.end(); ctrlidx++)
 	{
 		auto c = *ctrlidx;
-		if (c->Visible)
+		// Children entirely outside a control with its own surface would be clipped away anyway
+		// (e.g. scrolled out of a list). They keep any dirty flag so they're redrawn when they
+		// come back into view.
+		if (controlArea && (c->Location.x >= Size.x || c->Location.y >= Size.y ||
+		                    c->Location.x + c->Size.x <= 0 || c->Location.y + c->Size.y <= 0))
 		{
-			c->Render();
+			c->RecordRenderedState();
+			continue;
 		}
+		// Hidden controls still need to note that they've been hidden
+		c->RenderControl();
 	}
 	if (showBounds)
 	{
-		fw().renderer->drawRect({0, 0}, Size, Colour{255, 0, 0, 255});
+		fw().renderer->drawRect(renderOffset, Size, Colour{255, 0, 0, 255});
 	}
 }
 
@@ -620,8 +731,18 @@ void Control::SetParent(sp<Control> Parent)
 			LogError("Reparenting control");
 		}
 		Parent->Controls.push_back(shared_from_this());
+		Parent->SetDirty();
+	}
+	else
+	{
+		auto previousParent = this->owningControl.lock();
+		if (previousParent)
+		{
+			previousParent->SetDirty();
+		}
 	}
 	owningControl = Parent;
+	dirty = true;
 }
 
 Vec2<int> Control::GetLocationOnScreen() const
@@ -31,12 +31,40 @@ class Control : public std::enable_shared_from_this<Control>
 
 	std::map<FormEventType, std::list<std::function<void(FormsEvent *e)>>> callbacks;
 
+	// Set when the control (or anything in it) needs redrawing. A clean control that renders to
+	// its own surface just draws the surface from last time.
+	bool dirty;
+	// What the control was last rendered with. The public members can be changed directly, so
+	// they're compared against these rather than requiring every change to call SetDirty().
+	Vec2<int> renderedLocation;
+	Vec2<int> renderedSize;
+	Colour renderedBackground;
+	bool renderedVisible;
+	bool renderedShowBounds;
+	size_t renderedChildren;
+	sp<Palette> renderedPalette;
+
+	void FindChanges();
+	void RenderControl();
+	void RecordRenderedState();
+
   protected:
 	sp<Palette> palette;
 	wp<Control> owningControl;
 	bool mouseInside;
 	bool mouseDepressed;
 	Vec2<int> resolvedLocation;
+	// Added to everything drawn while rendering, non-zero when the control is drawn straight into
+	// its parent's surface rather than into its own
+	Vec2<int> renderOffset;
+
+	// Whether anything drawn can fall outside the control's bounds, in which case it has to be
+	// drawn into its own surface to be clipped. Controls that draw anything other than their
+	// background must override this unless they handle 'renderOffset'.
+	virtual bool NeedsClipping();
+	// For appearance that depends on something other than the control's own members or on
+	// members that can be changed without calling SetDirty(), checked before every render
+	virtual bool ChangedSinceRender() const;
 
 	virtual void PreRender();
 	virtual void PostRender();
@@ -79,6 +107,9 @@ class Control : public std::enable_shared_from_this<Control>
 
 	virtual void EventOccured(Event *e);
 	void Render();
+	// Mark the control as needing to be redrawn, along with everything it's drawn into
+	void SetDirty();
+	bool IsDirty() const { return dirty; }
 	virtual void Update();
 	virtual void UnloadResources();
 
@@ -6,8 +6,10 @@ namespace OpenApoc
 {
 
 Graphic::Graphic(sp<Image> Image)
-    : Control(), image(Image), ImageHAlign(HorizontalAlignment::Left),
-      ImageVAlign(VerticalAlignment::Top), ImagePosition(FillMethod::Fit), AutoSize(false)
+    : Control(), image(Image), renderedHAlign(HorizontalAlignment::Left),
+      renderedVAlign(VerticalAlignment::Top), renderedPosition(FillMethod::Fit),
+      ImageHAlign(HorizontalAlignment::Left), ImageVAlign(VerticalAlignment::Top),
+      ImagePosition(FillMethod::Fit), AutoSize(false)
 {
 }
 
@@ -17,22 +19,26 @@ void Graphic::EventOccured(Event *e) { Control::EventOccured(e); }
 
 void Graphic::OnRender()
 {
+	renderedHAlign = ImageHAlign;
+	renderedVAlign = ImageVAlign;
+	renderedPosition = ImagePosition;
 	if (!image)
 	{
 		return;
 	}
 
 	Vec2<float> pos = {0, 0};
+	Vec2<float> offset = renderOffset;
 	if (Vec2<unsigned int>(Size) == image->size)
 	{
-		fw().renderer->draw(image, pos);
+		fw().renderer->draw(image, pos + offset);
 	}
 	else
 	{
 		switch (ImagePosition)
 		{
 			case FillMethod::Stretch:
-				fw().renderer->drawScaled(image, pos, Size);
+				fw().renderer->drawScaled(image, pos + offset, Size);
 				break;
 
 			case FillMethod::Fit:
@@ -68,7 +74,7 @@ void Graphic::OnRender()
 						return;
 				}
 
-				fw().renderer->draw(image, pos);
+				fw().renderer->draw(image, pos + offset);
 				break;
 
 			case FillMethod::Tile:
@@ -76,7 +82,7 @@ void Graphic::OnRender()
 				{
 					for (pos.y = 0; pos.y < Size.y; pos.y += image->size.y)
 					{
-						fw().renderer->draw(image, pos);
+						fw().renderer->draw(image, pos + offset);
 					}
 				}
 				break;
@@ -84,6 +90,30 @@ void Graphic::OnRender()
 	}
 }
 
+bool Graphic::NeedsClipping()
+{
+	if (Control::NeedsClipping())
+	{
+		return true;
+	}
+	if (!image || ImagePosition == FillMethod::Stretch)
+	{
+		return false;
+	}
+	if (ImagePosition == FillMethod::Tile && Vec2<unsigned int>(Size) != image->size)
+	{
+		return true;
+	}
+	return image->size.x > static_cast<unsigned int>(Size.x) ||
+	       image->size.y > static_cast<unsigned int>(Size.y);
+}
+
+bool Graphic::ChangedSinceRender() const
+{
+	return ImageHAlign != renderedHAlign || ImageVAlign != renderedVAlign ||
+	       ImagePosition != renderedPosition;
+}
+
 void Graphic::Update()
 {
 	Control::Update();
@@ -102,7 +132,15 @@ void Graphic::UnloadResources()
 
 sp<Image> Graphic::GetImage() const { return image; }
 
-void Graphic::SetImage(sp<Image> Image) { image = Image; }
+void Graphic::SetImage(sp<Image> Image)
+{
+	if (image == Image)
+	{
+		return;
+	}
+	image = Image;
+	SetDirty();
+}
 
 sp<Control> Graphic::CopyTo(sp<Control> CopyParent)
 {
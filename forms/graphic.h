@@ -15,8 +15,15 @@ class Graphic : public Control
   private:
 	sp<Image> image;
 
+	// The public layout members as they were last drawn
+	HorizontalAlignment renderedHAlign;
+	VerticalAlignment renderedVAlign;
+	FillMethod renderedPosition;
+
   protected:
 	virtual void OnRender() override;
+	virtual bool NeedsClipping() override;
+	virtual bool ChangedSinceRender() const override;
 
   public:
 	HorizontalAlignment ImageHAlign;
@@ -84,6 +84,8 @@ void GraphicButton::OnRender()
 	}
 }
 
+bool GraphicButton::NeedsClipping() { return true; }
+
 void GraphicButton::Update() { Control::Update(); }
 
 void GraphicButton::UnloadResources()
@@ -96,15 +98,27 @@ void GraphicButton::UnloadResources()
 
 sp<Image> GraphicButton::GetImage() const { return image; }
 
-void GraphicButton::SetImage(sp<Image> Image) { image = Image; }
+void GraphicButton::SetImage(sp<Image> Image)
+{
+	image = Image;
+	SetDirty();
+}
 
 sp<Image> GraphicButton::GetDepressedImage() const { return imagedepressed; }
 
-void GraphicButton::SetDepressedImage(sp<Image> Image) { imagedepressed = Image; }
+void GraphicButton::SetDepressedImage(sp<Image> Image)
+{
+	imagedepressed = Image;
+	SetDirty();
+}
 
 sp<Image> GraphicButton::GetHoverImage() const { return imagehover; }
 
-void GraphicButton::SetHoverImage(sp<Image> Image) { imagehover = Image; }
+void GraphicButton::SetHoverImage(sp<Image> Image)
+{
+	imagehover = Image;
+	SetDirty();
+}
 
 sp<Control> GraphicButton::CopyTo(sp<Control> CopyParent)
 {
@@ -23,6 +23,7 @@ class GraphicButton : public Control
 
   protected:
 	virtual void OnRender() override;
+	virtual bool NeedsClipping() override;
 
   public:
 	sp<ScrollBar> ScrollBarPrev, ScrollBarNext;
@@ -8,8 +8,9 @@ namespace OpenApoc
 {
 
 Label::Label(UString Text, sp<BitmapFont> font)
-    : Control(), text(Text), font(font), TextHAlign(HorizontalAlignment::Left),
-      TextVAlign(VerticalAlignment::Top), WordWrap(true)
+    : Control(), text(Text), font(font), renderedHAlign(HorizontalAlignment::Left),
+      renderedVAlign(VerticalAlignment::Top), renderedWordWrap(true), wrappedWidth(-1),
+      TextHAlign(HorizontalAlignment::Left), TextVAlign(VerticalAlignment::Top), WordWrap(true)
 {
 	if (font)
 	{
@@ -21,11 +22,32 @@ Label::~Label() {}
 
 void Label::EventOccured(Event *e) { Control::EventOccured(e); }
 
+const std::list<UString> &Label::GetLines()
+{
+	if (wrappedWidth != Size.x || wrappedText != text || wrappedFont != font)
+	{
+		wrappedLines = WordWrapText(font, text);
+		wrappedText = text;
+		wrappedFont = font;
+		wrappedWidth = Size.x;
+	}
+	return wrappedLines;
+}
+
 void Label::OnRender()
 {
 	int xpos;
 	int ypos;
-	std::list<UString> lines = WordWrapText(font, text);
+	renderedText = text;
+	renderedFont = font;
+	renderedHAlign = TextHAlign;
+	renderedVAlign = TextVAlign;
+	renderedWordWrap = WordWrap;
+	if (!font)
+	{
+		return;
+	}
+	auto &lines = GetLines();
 
 	switch (TextVAlign)
 	{
@@ -43,7 +65,7 @@ void Label::OnRender()
 			return;
 	}
 
-	while (lines.size() > 0)
+	for (auto &line : lines)
 	{
 		switch (TextHAlign)
 		{
@@ -51,24 +73,54 @@ void Label::OnRender()
 				xpos = 0;
 				break;
 			case HorizontalAlignment::Centre:
-				xpos = (Size.x / 2) - (font->GetFontWidth(lines.front()) / 2);
+				xpos = (Size.x / 2) - (font->GetFontWidth(line) / 2);
 				break;
 			case HorizontalAlignment::Right:
-				xpos = Size.x - font->GetFontWidth(lines.front());
+				xpos = Size.x - font->GetFontWidth(line);
 				break;
 			default:
 				LogError("Unknown TextHAlign");
 				return;
 		}
 
-		auto textImage = font->getString(lines.front());
-		fw().renderer->draw(textImage, Vec2<float>{xpos, ypos});
+		auto textImage = font->getString(line);
+		fw().renderer->draw(textImage, Vec2<float>{xpos, ypos} + Vec2<float>{renderOffset});
 
-		lines.pop_front();
 		ypos += font->GetFontHeight();
 	}
 }
 
+bool Label::NeedsClipping()
+{
+	if (Control::NeedsClipping())
+	{
+		return true;
+	}
+	if (!font)
+	{
+		return false;
+	}
+	auto &lines = GetLines();
+	if (static_cast<int>(lines.size()) * font->GetFontHeight() > Size.y)
+	{
+		return true;
+	}
+	for (auto &line : lines)
+	{
+		if (font->GetFontWidth(line) > Size.x)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Label::ChangedSinceRender() const
+{
+	return text != renderedText || font != renderedFont || TextHAlign != renderedHAlign ||
+	       TextVAlign != renderedVAlign || WordWrap != renderedWordWrap;
+}
+
 void Label::Update()
 {
 	// No "updates"
@@ -82,7 +134,10 @@ void Label::SetText(UString Text) { text = Text; }
 
 sp<BitmapFont> Label::GetFont() const { return font; }
 
-void Label::SetFont(sp<BitmapFont> NewFont) { font = NewFont; }
+void Label::SetFont(sp<BitmapFont> NewFont)
+{
+	font = NewFont;
+}
 
 sp<Control> Label::CopyTo(sp<Control> CopyParent)
 {
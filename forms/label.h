@@ -6,6 +6,8 @@
 #include "framework/font.h"
 #include "forms_enums.h"
 
+#include <list>
+
 namespace OpenApoc
 {
 
@@ -16,8 +18,26 @@ class Label : public Control
 	UString text;
 	sp<BitmapFont> font;
 
+	// What was last drawn, so text that's cleared and set back to the same thing every frame
+	// doesn't cause a redraw
+	UString renderedText;
+	sp<BitmapFont> renderedFont;
+	HorizontalAlignment renderedHAlign;
+	VerticalAlignment renderedVAlign;
+	bool renderedWordWrap;
+
+	// The text split into lines, only worked out again when the text, font or width changes
+	std::list<UString> wrappedLines;
+	UString wrappedText;
+	sp<BitmapFont> wrappedFont;
+	int wrappedWidth;
+
+	const std::list<UString> &GetLines();
+
   protected:
 	virtual void OnRender() override;
+	virtual bool NeedsClipping() override;
+	virtual bool ChangedSinceRender() const override;
 
   public:
 	HorizontalAlignment TextHAlign;
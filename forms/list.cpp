@@ -7,12 +7,16 @@
 namespace OpenApoc
 {
 
+ListBoxDataSource::~ListBoxDataSource() {}
+
 ListBox::ListBox() : ListBox(nullptr) {}
 
 ListBox::ListBox(sp<ScrollBar> ExternalScrollBar)
     : Control(), scroller_is_internal(ExternalScrollBar == nullptr), hovered(nullptr),
-      selected(nullptr), scroller(ExternalScrollBar), ItemSize(64), ItemSpacing(1),
-      ListOrientation(Orientation::Vertical), HoverColour(0, 0, 0, 0), SelectedColour(0, 0, 0, 0)
+      selected(nullptr), renderedScrollValue(0), hoveredIndex(-1), selectedIndex(-1),
+      scroller(ExternalScrollBar), ItemSize(64),
+      ItemSpacing(1), ListOrientation(Orientation::Vertical), HoverColour(0, 0, 0, 0),
+      SelectedColour(0, 0, 0, 0)
 {
 }
 
@@ -47,6 +51,13 @@ void ListBox::OnRender()
 	{
 		ConfigureInternalScrollBar();
 	}
+	renderedScrollValue = scroller->GetValue();
+
+	if (dataSource)
+	{
+		LayoutRows();
+		return;
+	}
 
 	for (auto c = Controls.begin(); c != Controls.end(); c++)
 	{
@@ -92,6 +103,236 @@ void ListBox::OnRender()
 	    static_cast<int>(std::max((scroller->Maximum - scroller->Minimum + 2) / 10.0f, 4.0f));
 }
 
+void ListBox::LayoutRows()
+{
+	if (scroller == nullptr)
+	{
+		ConfigureInternalScrollBar();
+	}
+	if (ItemSize <= 0)
+	{
+		LogError("Virtual list \"%s\" needs a fixed item size", this->Name.c_str());
+		return;
+	}
+
+	int stride = ItemSize + ItemSpacing;
+	int count = static_cast<int>(dataSource->GetItemCount());
+	int scroll = scroller->GetValue();
+	int viewLength = ListOrientation == Orientation::Vertical ? Size.y : Size.x;
+	int first = std::max(scroll / stride, 0);
+	int last = std::min((scroll + viewLength - 1) / stride, count - 1);
+
+	for (auto it = rows.begin(); it != rows.end();)
+	{
+		int index = static_cast<int>(it->first);
+		if (index < first || index > last || staleRows.find(it->first) != staleRows.end())
+		{
+			ReleaseRow(it->second);
+			it = rows.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+	staleRows.clear();
+
+	for (int index = first; index <= last; index++)
+	{
+		if (rows.find(index) != rows.end())
+		{
+			continue;
+		}
+		sp<Control> recycled;
+		if (!spareRows.empty())
+		{
+			recycled = spareRows.back();
+			spareRows.pop_back();
+		}
+		auto row = dataSource->BindRow(index, recycled);
+		if (recycled && row != recycled)
+		{
+			spareRows.push_back(recycled);
+		}
+		if (!row)
+		{
+			LogError("Data source for list \"%s\" returned no control for item %d",
+			         this->Name.c_str(), index);
+			continue;
+		}
+		row->SetParent(shared_from_this());
+		rows[index] = row;
+	}
+	// Only keep enough spare rows to refill the view
+	size_t visibleRows = static_cast<size_t>(std::max(last - first + 1, 0));
+	if (spareRows.size() > visibleRows)
+	{
+		spareRows.resize(visibleRows);
+	}
+
+	for (auto &row : rows)
+	{
+		auto &ctrl = row.second;
+		int position = static_cast<int>(row.first) * stride - scroll;
+		switch (ListOrientation)
+		{
+			case Orientation::Vertical:
+				ctrl->Location = {0, position};
+				ctrl->Size.x = (scroller_is_internal ? scroller->Location.x : this->Size.x);
+				ctrl->Size.y = ItemSize;
+				break;
+			case Orientation::Horizontal:
+				ctrl->Location = {position, 0};
+				ctrl->Size.x = ItemSize;
+				ctrl->Size.y = (scroller_is_internal ? scroller->Location.y : this->Size.y);
+				break;
+		}
+	}
+
+	auto findRow = [this](int index) -> sp<Control>
+	{
+		auto it = rows.find(index);
+		return it == rows.end() ? nullptr : it->second;
+	};
+	hovered = findRow(hoveredIndex);
+	selected = findRow(selectedIndex);
+
+	ResolveLocation();
+	scroller->Maximum = std::max(count * stride - ItemSpacing - viewLength, scroller->Minimum);
+	scroller->LargeChange =
+	    static_cast<int>(std::max((scroller->Maximum - scroller->Minimum + 2) / 10.0f, 4.0f));
+}
+
+void ListBox::ReleaseRow(sp<Control> row)
+{
+	for (auto it = Controls.begin(); it != Controls.end(); it++)
+	{
+		if (*it == row)
+		{
+			Controls.erase(it);
+			break;
+		}
+	}
+	row->SetParent(nullptr);
+	spareRows.push_back(row);
+}
+
+int ListBox::GetRowIndex(sp<Control> row) const
+{
+	for (auto &r : rows)
+	{
+		if (r.second == row)
+		{
+			return static_cast<int>(r.first);
+		}
+	}
+	return -1;
+}
+
+void ListBox::SetDataSource(sp<ListBoxDataSource> source)
+{
+	Clear();
+	dataSource = source;
+	SetDirty();
+}
+
+void ListBox::ItemsInserted(unsigned int index, unsigned int count)
+{
+	std::map<unsigned int, sp<Control>> movedRows;
+	for (auto &row : rows)
+	{
+		movedRows[row.first >= index ? row.first + count : row.first] = row.second;
+	}
+	rows = std::move(movedRows);
+	std::set<unsigned int> movedStale;
+	for (auto stale : staleRows)
+	{
+		movedStale.insert(stale >= index ? stale + count : stale);
+	}
+	staleRows = std::move(movedStale);
+	if (hoveredIndex >= static_cast<int>(index))
+	{
+		hoveredIndex += count;
+	}
+	if (selectedIndex >= static_cast<int>(index))
+	{
+		selectedIndex += count;
+	}
+	SetDirty();
+}
+
+void ListBox::ItemsRemoved(unsigned int index, unsigned int count)
+{
+	std::map<unsigned int, sp<Control>> movedRows;
+	for (auto &row : rows)
+	{
+		if (row.first < index)
+		{
+			movedRows[row.first] = row.second;
+		}
+		else if (row.first >= index + count)
+		{
+			movedRows[row.first - count] = row.second;
+		}
+		else
+		{
+			ReleaseRow(row.second);
+		}
+	}
+	rows = std::move(movedRows);
+	std::set<unsigned int> movedStale;
+	for (auto stale : staleRows)
+	{
+		if (stale < index)
+		{
+			movedStale.insert(stale);
+		}
+		else if (stale >= index + count)
+		{
+			movedStale.insert(stale - count);
+		}
+	}
+	staleRows = std::move(movedStale);
+	auto adjustIndex = [index, count](int &i)
+	{
+		if (i >= static_cast<int>(index + count))
+		{
+			i -= count;
+		}
+		else if (i >= static_cast<int>(index))
+		{
+			i = -1;
+		}
+	};
+	adjustIndex(hoveredIndex);
+	adjustIndex(selectedIndex);
+	SetDirty();
+}
+
+void ListBox::ItemsChanged(unsigned int index, unsigned int count)
+{
+	for (unsigned int i = index; i < index + count; i++)
+	{
+		if (rows.find(i) != rows.end())
+		{
+			staleRows.insert(i);
+		}
+	}
+	SetDirty();
+}
+
+void ListBox::SetSelectedIndex(int index)
+{
+	if (selectedIndex == index)
+	{
+		return;
+	}
+	selectedIndex = index;
+	auto it = rows.find(index);
+	selected = it == rows.end() ? nullptr : it->second;
+	SetDirty();
+}
+
 void ListBox::PostRender()
 {
 	Control::PostRender();
@@ -112,6 +353,14 @@ void ListBox::PostRender()
 	}
 }
 
+// Items are scrolled past the edges
+bool ListBox::NeedsClipping() { return true; }
+
+bool ListBox::ChangedSinceRender() const
+{
+	return scroller && scroller->GetValue() != renderedScrollValue;
+}
+
 void ListBox::EventOccured(Event *e)
 {
 	Control::EventOccured(e);
@@ -143,6 +392,11 @@ void ListBox::EventOccured(Event *e)
 			if (hovered != ctrl)
 			{
 				hovered = ctrl;
+				if (dataSource)
+				{
+					hoveredIndex = GetRowIndex(ctrl);
+				}
+				SetDirty();
 				this->pushFormEvent(FormEventType::ListBoxChangeHover, e);
 			}
 		}
@@ -151,6 +405,11 @@ void ListBox::EventOccured(Event *e)
 			if (selected != ctrl && ctrl->GetParent() == shared_from_this() && ctrl != scroller)
 			{
 				selected = ctrl;
+				if (dataSource)
+				{
+					selectedIndex = GetRowIndex(ctrl);
+				}
+				SetDirty();
 				this->pushFormEvent(FormEventType::ListBoxChangeSelected, e);
 			}
 		}
@@ -168,6 +427,11 @@ void ListBox::Update()
 	{
 		scroller->Update();
 	}
+	// Rows are laid out here as well as when rendering, so they're in place for events
+	if (dataSource && (IsDirty() || scroller->GetValue() != renderedScrollValue))
+	{
+		LayoutRows();
+	}
 }
 
 void ListBox::UnloadResources() {}
@@ -181,6 +445,11 @@ void ListBox::Clear()
 	Controls.clear();
 	this->selected = nullptr;
 	this->hovered = nullptr;
+	this->rows.clear();
+	this->spareRows.clear();
+	this->staleRows.clear();
+	this->hoveredIndex = -1;
+	this->selectedIndex = -1;
 	if (scroller_is_internal)
 	{
 		ConfigureInternalScrollBar();
@@ -349,5 +618,10 @@ void ListBox::setSelected(sp<Control> c)
 		    "Trying set ListBox selected control to something that isn't a member of the list");
 	}
 	this->selected = c;
+	if (dataSource)
+	{
+		this->selectedIndex = GetRowIndex(c);
+	}
+	SetDirty();
 }
 }; // namespace OpenApoc
@@ -4,22 +4,56 @@
 #include "control.h"
 #include "forms_enums.h"
 
+#include <map>
+#include <set>
+#include <vector>
+
 namespace OpenApoc
 {
 
 class ScrollBar;
 
+// Supplies the items of a virtual ListBox, which only has controls for the rows that are in view
+class ListBoxDataSource
+{
+  public:
+	virtual ~ListBoxDataSource();
+	virtual unsigned int GetItemCount() = 0;
+	// Return the control to show item 'index'. 'recycled' is a row that was showing some other
+	// item (or nullptr), which can be updated and returned rather than creating a new control.
+	virtual sp<Control> BindRow(unsigned int index, sp<Control> recycled) = 0;
+};
+
 class ListBox : public Control
 {
   private:
 	bool scroller_is_internal;
 	sp<Control> hovered, selected;
+	// The scroll position the items were last laid out for, the scroll bar may be outside the
+	// list so changing it doesn't necessarily mark the list as dirty
+	int renderedScrollValue;
+
+	// Virtual mode, only used with a data source
+	sp<ListBoxDataSource> dataSource;
+	// The row controls for the items in view, by item index
+	std::map<unsigned int, sp<Control>> rows;
+	// Rows that have scrolled out of view, to be handed back to the data source
+	std::vector<sp<Control>> spareRows;
+	// Items in view that have changed since they were bound
+	std::set<unsigned int> staleRows;
+	int hoveredIndex, selectedIndex;
 
 	void ConfigureInternalScrollBar();
+	// Bind rows for the items now in view, and recycle the rest
+	void LayoutRows();
+	void ReleaseRow(sp<Control> row);
+	int GetRowIndex(sp<Control> row) const;
 
   protected:
 	virtual void OnRender() override;
 	virtual void PostRender() override;
+	virtual bool NeedsClipping() override;
+	virtual bool ChangedSinceRender() const override;
 
   public:
 	sp<ScrollBar> scroller;
@@ -37,6 +71,19 @@ class ListBox : public Control
 
 	void setSelected(sp<Control> c);
 
+	// Switch the list to only having controls for the rows in view, supplied by 'source'. This
+	// needs a fixed ItemSize, and the AddItem/RemoveItem functions can't be used alongside it.
+	// Pass nullptr to go back to a normal list.
+	void SetDataSource(sp<ListBoxDataSource> source);
+	// Tell a virtual list what changed in its data source
+	void ItemsInserted(unsigned int index, unsigned int count);
+	void ItemsRemoved(unsigned int index, unsigned int count);
+	void ItemsChanged(unsigned int index, unsigned int count);
+	// The item indices of a virtual list's hovered and selected rows, -1 if there isn't one
+	int GetHoveredIndex() const { return hoveredIndex; }
+	int GetSelectedIndex() const { return selectedIndex; }
+	void SetSelectedIndex(int index);
+
 	void Clear();
 	void AddItem(sp<Control> Item);
 	sp<Control> RemoveItem(sp<Control> Item);
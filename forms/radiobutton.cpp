@@ -54,7 +54,11 @@ void RadioButton::SetChecked(bool checked)
 				auto button = c.lock();
 				if (button)
 				{
-					button->Checked = false;
+					if (button->Checked)
+					{
+						button->Checked = false;
+						button->SetDirty();
+					}
 				}
 			}
 		}
@@ -11,7 +11,7 @@ ScrollBar::ScrollBar()
       gripperbutton(fw().data->load_image(
           "PCK:XCOM3/UFODATA/NEWBUT.PCK:XCOM3/UFODATA/NEWBUT.TAB:4:UI/menuopt.pal")),
       buttonerror(fw().data->load_sample("RAWSOUND:xcom3/RAWSOUND/EXTRA/TEXTBEEP.RAW:22050")),
-      Value(0), BarOrientation(Orientation::Vertical),
+      Value(0), BarOrientation(Orientation::Vertical), renderedGripper(false),
       RenderStyle(ScrollBarRenderStyles::MenuButtonStyle), GripperColour(220, 192, 192), Minimum(0),
       Maximum(10), LargeChange(2)
 {
@@ -31,6 +31,7 @@ bool ScrollBar::SetValue(int newValue)
 
 	this->pushFormEvent(FormEventType::ScrollBarChange, nullptr);
 	Value = newValue;
+	SetDirty();
 	return true;
 }
 
@@ -99,25 +100,47 @@ void ScrollBar::EventOccured(Event *e)
 	}
 }
 
-void ScrollBar::OnRender()
+bool ScrollBar::GetGripper(Vec2<float> &position, Vec2<float> &size) const
 {
-	// LoadResources();
 	if (Minimum == Maximum)
-		return;
+		return false;
 
 	int pos = static_cast<int>(segmentsize * (Value - Minimum));
-	Vec2<float> newpos, newsize;
 	switch (BarOrientation)
 	{
 		case Orientation::Vertical:
-			newpos = {0, pos};
-			newsize = {Size.x, grippersize};
+			position = {0, pos};
+			size = {Size.x, grippersize};
 			break;
 		case Orientation::Horizontal:
-			newpos = {pos, 0};
-			newsize = {grippersize, Size.y};
+			position = {pos, 0};
+			size = {grippersize, Size.y};
 			break;
 	}
+	return true;
+}
+
+bool ScrollBar::NeedsClipping() { return true; }
+
+// The gripper's size depends on the range, which the owner of the scroll bar can change at any
+// time (and a list box does while rendering)
+bool ScrollBar::ChangedSinceRender() const
+{
+	Vec2<float> position, size;
+	bool gripper = GetGripper(position, size);
+	return gripper != renderedGripper ||
+	       (gripper && (position != renderedGripperPosition || size != renderedGripperSize));
+}
+
+void ScrollBar::OnRender()
+{
+	// LoadResources();
+	Vec2<float> newpos, newsize;
+	renderedGripper = GetGripper(newpos, newsize);
+	renderedGripperPosition = newpos;
+	renderedGripperSize = newsize;
+	if (!renderedGripper)
+		return;
 
 	switch (RenderStyle)
 	{
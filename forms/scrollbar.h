@@ -22,10 +22,18 @@ class ScrollBar : public Control
 
 	int Value;
 	Orientation BarOrientation;
+	// Where the gripper was last drawn
+	bool renderedGripper;
+	Vec2<float> renderedGripperPosition;
+	Vec2<float> renderedGripperSize;
 	void LoadResources();
+	// Returns false if there's no gripper to draw
+	bool GetGripper(Vec2<float> &position, Vec2<float> &size) const;
 
   protected:
 	virtual void OnRender() override;
+	virtual bool NeedsClipping() override;
+	virtual bool ChangedSinceRender() const override;
 
   public:
 	enum class ScrollBarRenderStyles
@@ -95,6 +95,8 @@ void TextButton::OnRender()
 	}
 }
 
+bool TextButton::NeedsClipping() { return true; }
+
 void TextButton::Update()
 {
 	// No "updates"
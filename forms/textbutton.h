@@ -25,6 +25,7 @@ class TextButton : public Control
 
   protected:
 	virtual void OnRender() override;
+	virtual bool NeedsClipping() override;
 
   public:
 	enum class TextButtonRenderStyles
@@ -23,6 +23,9 @@ TextEdit::~TextEdit() {}
 void TextEdit::EventOccured(Event *e)
 {
 	UString keyname;
+	UString previousText = text;
+	unsigned int previousSelection = SelectionStart;
+	bool previousEditting = editting;
 
 	Control::EventOccured(e);
 
@@ -138,6 +141,11 @@ void TextEdit::EventOccured(Event *e)
 			}
 		}
 	}
+
+	if (text != previousText || SelectionStart != previousSelection || editting != previousEditting)
+	{
+		SetDirty();
+	}
 }
 
 void TextEdit::OnRender()
@@ -204,6 +212,8 @@ void TextEdit::OnRender()
 	fw().renderer->draw(textImage, Vec2<float>{xpos, ypos});
 }
 
+bool TextEdit::NeedsClipping() { return true; }
+
 void TextEdit::Update()
 {
 	if (editting)
@@ -212,6 +222,7 @@ void TextEdit::Update()
 		if (caretTimer == 0)
 		{
 			caretDraw = !caretDraw;
+			SetDirty();
 		}
 	}
 }
@@ -224,6 +235,7 @@ void TextEdit::SetText(UString Text)
 {
 	text = Text;
 	SelectionStart = text.length();
+	SetDirty();
 	RaiseEvent(FormEventType::TextChanged);
 }
 
@@ -235,7 +247,11 @@ void TextEdit::RaiseEvent(FormEventType Type)
 
 sp<BitmapFont> TextEdit::GetFont() const { return font; }
 
-void TextEdit::SetFont(sp<BitmapFont> NewFont) { font = NewFont; }
+void TextEdit::SetFont(sp<BitmapFont> NewFont)
+{
+	font = NewFont;
+	SetDirty();
+}
 
 sp<Control> TextEdit::CopyTo(sp<Control> CopyParent)
 {
@@ -28,6 +28,7 @@ class TextEdit : public Control
 
   protected:
 	virtual void OnRender() override;
+	virtual bool NeedsClipping() override;
 
   public:
 	unsigned int SelectionStart;
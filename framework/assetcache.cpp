@@ -0,0 +1,424 @@
+#include "framework/assetcache.h"
+#include "framework/fs.h"
+#include "framework/image.h"
+#include "framework/logger.h"
+#include "framework/palette.h"
+#include "framework/trace.h"
+#include "game/apocresources/loftemps.h"
+
+#include <physfs.h>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+// Bump cacheVersion whenever the layout or meaning of any entry changes, old entries are then just
+// ignored
+static const char cacheMagic[8] = {'O', 'A', 'C', 'A', 'C', 'H', 'E', '\0'};
+static const uint32_t cacheVersion = 2;
+
+enum class CacheType : uint32_t
+{
+	ImageSet = 1,
+	LOFTemps = 2,
+	Palette = 3,
+};
+
+// FNV-1a, used for the entry filenames
+static uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+class SourceInfo
+{
+  public:
+	UString path;
+	uint64_t size;
+	// The modification time, or 0 if the archive doesn't supply one
+	uint64_t stamp;
+};
+
+static bool getSourceInfo(FileSystem &fs, const UString &path, SourceInfo &info)
+{
+	auto foundPath = fs.getCorrectCaseFilename(path);
+	if (foundPath == "")
+		return false;
+	PHYSFS_Stat stat;
+	if (!PHYSFS_stat(foundPath.c_str(), &stat))
+		return false;
+	info.path = path;
+	info.size = stat.filesize;
+	// Without a modification time only the path and size are checked. Hashing the contents
+	// instead would mean reading every source in full on each start, which is what the cache is
+	// there to avoid.
+	info.stamp = stat.modtime >= 0 ? stat.modtime : 0;
+	return true;
+}
+
+class CacheWriter
+{
+  public:
+	std::vector<uint8_t> data;
+
+	void write(const void *src, size_t size)
+	{
+		auto *bytes = static_cast<const uint8_t *>(src);
+		data.insert(data.end(), bytes, bytes + size);
+	}
+	void writeule32(uint32_t val)
+	{
+		uint8_t bytes[4] = {static_cast<uint8_t>(val), static_cast<uint8_t>(val >> 8),
+		                    static_cast<uint8_t>(val >> 16), static_cast<uint8_t>(val >> 24)};
+		write(bytes, 4);
+	}
+	void writeule64(uint64_t val)
+	{
+		writeule32(static_cast<uint32_t>(val));
+		writeule32(static_cast<uint32_t>(val >> 32));
+	}
+	void writeString(const UString &str)
+	{
+		auto s = str.str();
+		writeule32(s.size());
+		write(s.data(), s.size());
+	}
+};
+
+static bool readule64(IFileCursor &cursor, uint64_t &val)
+{
+	uint32_t low, high;
+	if (!cursor.readule32(low) || !cursor.readule32(high))
+		return false;
+	val = (static_cast<uint64_t>(high) << 32) | low;
+	return true;
+}
+
+static bool readString(IFileCursor &cursor, UString &str)
+{
+	uint32_t length;
+	if (!cursor.readule32(length))
+		return false;
+	auto *chars = cursor.readSpan(length);
+	if (!chars)
+		return false;
+	str = std::string(reinterpret_cast<const char *>(chars), length);
+	return true;
+}
+
+// Header is {magic, version, type, key, source count, {path, size, stamp}[count]}
+static bool writeHeader(FileSystem &fs, CacheWriter &writer, const UString &key, CacheType type,
+                        const std::vector<UString> &sources)
+{
+	writer.write(cacheMagic, sizeof(cacheMagic));
+	writer.writeule32(cacheVersion);
+	writer.writeule32(static_cast<uint32_t>(type));
+	writer.writeString(key);
+	writer.writeule32(sources.size());
+	for (auto &source : sources)
+	{
+		SourceInfo info;
+		if (!getSourceInfo(fs, source, info))
+		{
+			LogWarning("Failed to stat cache source \"%s\"", source.c_str());
+			return false;
+		}
+		writer.writeString(info.path);
+		writer.writeule64(info.size);
+		writer.writeule64(info.stamp);
+	}
+	return true;
+}
+
+static bool checkHeader(FileSystem &fs, IFileCursor &cursor, const UString &key, CacheType type,
+                        const std::vector<UString> &sources)
+{
+	auto *magic = cursor.readSpan(sizeof(cacheMagic));
+	if (!magic || memcmp(magic, cacheMagic, sizeof(cacheMagic)) != 0)
+		return false;
+	uint32_t version, entryType, sourceCount;
+	if (!cursor.readule32(version) || version != cacheVersion)
+		return false;
+	if (!cursor.readule32(entryType) || entryType != static_cast<uint32_t>(type))
+		return false;
+	UString entryKey;
+	// The filename is a hash of the key, so check for collisions
+	if (!readString(cursor, entryKey) || entryKey != key)
+		return false;
+	if (!cursor.readule32(sourceCount) || sourceCount != sources.size())
+		return false;
+	for (auto &source : sources)
+	{
+		UString path;
+		uint64_t size, stamp;
+		if (!readString(cursor, path) || !readule64(cursor, size) || !readule64(cursor, stamp))
+			return false;
+		SourceInfo info;
+		if (path != source || !getSourceInfo(fs, source, info))
+			return false;
+		if (info.size != size || info.stamp != stamp)
+		{
+			LogInfo("Cache entry for \"%s\" is stale (\"%s\" changed)", key.c_str(),
+			        source.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+static void writeEntry(const UString &directory, const UString &path, const CacheWriter &writer)
+{
+	if (!PHYSFS_exists(directory.c_str()))
+		PHYSFS_mkdir(directory.c_str());
+	PHYSFS_File *file = PHYSFS_openWrite(path.c_str());
+	if (!file)
+	{
+		LogWarning("Failed to open cache entry \"%s\" for writing: %s", path.c_str(),
+		           PHYSFS_getLastError());
+		return;
+	}
+	auto written = PHYSFS_writeBytes(file, writer.data.data(), writer.data.size());
+	PHYSFS_close(file);
+	if (written != static_cast<PHYSFS_sint64>(writer.data.size()))
+	{
+		LogWarning("Failed to write cache entry \"%s\"", path.c_str());
+		// Don't leave a truncated entry behind
+		PHYSFS_delete(path.c_str());
+	}
+}
+
+} // anonymous namespace
+
+AssetCache::AssetCache(FileSystem &fs, const UString &directory) : fs(fs), directory(directory)
+{
+	LogInfo("Using decoded asset cache in \"%s\"", directory.c_str());
+}
+
+AssetCache::~AssetCache() {}
+
+UString AssetCache::getCachePath(const UString &key)
+{
+	auto keyStr = key.str();
+	auto hash = hashBytes(reinterpret_cast<const uint8_t *>(keyStr.data()), keyStr.size());
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+	return directory + "/" + name + ".bin";
+}
+
+// ImageSet payload is {count, maxSize, {size, bounds}[count], indices[]}
+sp<ImageSet> AssetCache::loadImageSet(const UString &key, const std::vector<UString> &sources)
+{
+	auto path = getCachePath(key);
+	// Opening an entry that was never written would log an error
+	if (!PHYSFS_exists(path.c_str()))
+		return nullptr;
+	auto file = fs.open(path);
+	if (!file)
+		return nullptr;
+	auto view = file.map();
+	IFileCursor cursor(view);
+	if (!checkHeader(fs, cursor, key, CacheType::ImageSet, sources))
+		return nullptr;
+
+	TRACE_FN_ARGS1("key", key);
+	uint32_t count, maxX, maxY;
+	if (!cursor.readule32(count) || !cursor.readule32(maxX) || !cursor.readule32(maxY))
+		return nullptr;
+
+	std::vector<Vec2<unsigned int>> sizes(count);
+	std::vector<Rect<unsigned int>> bounds(count);
+	size_t arenaSize = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t v[6];
+		for (auto &val : v)
+		{
+			if (!cursor.readule32(val))
+				return nullptr;
+		}
+		sizes[i] = {v[0], v[1]};
+		bounds[i] = {v[2], v[3], v[4], v[5]};
+		arenaSize += sizes[i].x * sizes[i].y;
+	}
+	auto *indices = cursor.readSpan(arenaSize);
+	if (!indices)
+	{
+		LogWarning("Truncated cache entry \"%s\"", path.c_str());
+		return nullptr;
+	}
+	auto arena = mksp<std::vector<uint8_t>>(indices, indices + arenaSize);
+
+	auto imageSet = mksp<ImageSet>();
+	imageSet->maxSize = {maxX, maxY};
+	imageSet->images.resize(count);
+	size_t offset = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		auto img = mksp<PaletteImage>(sizes[i], arena, offset);
+		img->bounds = bounds[i];
+		img->owningSet = imageSet;
+		img->indexInSet = i;
+		imageSet->images[i] = img;
+		offset += sizes[i].x * sizes[i].y;
+	}
+	return imageSet;
+}
+
+void AssetCache::storeImageSet(const UString &key, const std::vector<UString> &sources,
+                               sp<ImageSet> imageSet)
+{
+	CacheWriter writer;
+	if (!writeHeader(fs, writer, key, CacheType::ImageSet, sources))
+		return;
+	writer.writeule32(imageSet->images.size());
+	writer.writeule32(imageSet->maxSize.x);
+	writer.writeule32(imageSet->maxSize.y);
+	std::vector<sp<PaletteImage>> images;
+	for (auto &image : imageSet->images)
+	{
+		auto paletteImage = std::dynamic_pointer_cast<PaletteImage>(image);
+		// Only sets of palette images are cached
+		if (!paletteImage)
+			return;
+		writer.writeule32(image->size.x);
+		writer.writeule32(image->size.y);
+		writer.writeule32(image->bounds.p0.x);
+		writer.writeule32(image->bounds.p0.y);
+		writer.writeule32(image->bounds.p1.x);
+		writer.writeule32(image->bounds.p1.y);
+		images.push_back(paletteImage);
+	}
+	for (auto &image : images)
+	{
+		PaletteImageLock lock(image, ImageLockUse::Read);
+		writer.write(lock.getData(), image->size.x * image->size.y);
+	}
+	writeEntry(directory, getCachePath(key), writer);
+}
+
+// LOFTemps payload is {count, {size, packed bits}[count]}
+sp<LOFTemps> AssetCache::loadLOFTemps(const UString &key, const std::vector<UString> &sources)
+{
+	auto path = getCachePath(key);
+	// Opening an entry that was never written would log an error
+	if (!PHYSFS_exists(path.c_str()))
+		return nullptr;
+	auto file = fs.open(path);
+	if (!file)
+		return nullptr;
+	auto view = file.map();
+	IFileCursor cursor(view);
+	if (!checkHeader(fs, cursor, key, CacheType::LOFTemps, sources))
+		return nullptr;
+
+	TRACE_FN_ARGS1("key", key);
+	uint32_t count;
+	if (!cursor.readule32(count))
+		return nullptr;
+	std::vector<sp<VoxelSlice>> slices;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t width, height;
+		if (!cursor.readule32(width) || !cursor.readule32(height))
+			return nullptr;
+		auto *bits = cursor.readSpan((width * height + 7) / 8);
+		if (!bits)
+		{
+			LogWarning("Truncated cache entry \"%s\"", path.c_str());
+			return nullptr;
+		}
+		auto slice = mksp<VoxelSlice>(Vec2<int>{width, height});
+		for (unsigned int bit = 0; bit < width * height; bit++)
+		{
+			if (bits[bit / 8] & (1 << (bit % 8)))
+				slice->setBit({bit % width, bit / width}, true);
+		}
+		slices.push_back(slice);
+	}
+	return mksp<LOFTemps>(slices);
+}
+
+void AssetCache::storeLOFTemps(const UString &key, const std::vector<UString> &sources,
+                               sp<LOFTemps> lofTemps)
+{
+	CacheWriter writer;
+	if (!writeHeader(fs, writer, key, CacheType::LOFTemps, sources))
+		return;
+	writer.writeule32(lofTemps->getSliceCount());
+	for (unsigned int i = 0; i < lofTemps->getSliceCount(); i++)
+	{
+		auto slice = lofTemps->getSlice(i);
+		auto size = slice->getSize();
+		writer.writeule32(size.x);
+		writer.writeule32(size.y);
+		std::vector<uint8_t> bits((size.x * size.y + 7) / 8, 0);
+		for (int y = 0; y < size.y; y++)
+		{
+			for (int x = 0; x < size.x; x++)
+			{
+				int bit = y * size.x + x;
+				if (slice->getBit({x, y}))
+					bits[bit / 8] |= 1 << (bit % 8);
+			}
+		}
+		writer.write(bits.data(), bits.size());
+	}
+	writeEntry(directory, getCachePath(key), writer);
+}
+
+// Palette payload is {count, rgba[count]}
+sp<Palette> AssetCache::loadPalette(const UString &key, const std::vector<UString> &sources)
+{
+	auto path = getCachePath(key);
+	// Opening an entry that was never written would log an error
+	if (!PHYSFS_exists(path.c_str()))
+		return nullptr;
+	auto file = fs.open(path);
+	if (!file)
+		return nullptr;
+	auto view = file.map();
+	IFileCursor cursor(view);
+	if (!checkHeader(fs, cursor, key, CacheType::Palette, sources))
+		return nullptr;
+
+	uint32_t count;
+	if (!cursor.readule32(count))
+		return nullptr;
+	auto *colours = cursor.readSpan(count * 4);
+	if (!colours)
+	{
+		LogWarning("Truncated cache entry \"%s\"", path.c_str());
+		return nullptr;
+	}
+	auto palette = mksp<Palette>(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Colour c{colours[i * 4], colours[i * 4 + 1], colours[i * 4 + 2], colours[i * 4 + 3]};
+		palette->SetColour(i, c);
+	}
+	return palette;
+}
+
+void AssetCache::storePalette(const UString &key, const std::vector<UString> &sources,
+                              sp<Palette> palette)
+{
+	CacheWriter writer;
+	if (!writeHeader(fs, writer, key, CacheType::Palette, sources))
+		return;
+	writer.writeule32(palette->colours.size());
+	for (auto &c : palette->colours)
+	{
+		uint8_t rgba[4] = {c.r, c.g, c.b, c.a};
+		writer.write(rgba, 4);
+	}
+	writeEntry(directory, getCachePath(key), writer);
+}
+
+} // namespace OpenApoc
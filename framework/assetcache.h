@@ -0,0 +1,45 @@
+#pragma once
+#include "library/sp.h"
+#include "library/strings.h"
+
+#include <vector>
+
+namespace OpenApoc
+{
+
+class FileSystem;
+class ImageSet;
+class LOFTemps;
+class Palette;
+
+// An on-disk cache of decoded resources, stored in the user's write directory.
+// Each entry is keyed by the resource string and records the path, size and modification time (if
+// the archive provides one) of every source file it was decoded from. An entry is only used if all
+// its sources still match, otherwise it's ignored and overwritten the next time the resource is
+// decoded.
+class AssetCache
+{
+  private:
+	FileSystem &fs;
+	UString directory;
+
+	UString getCachePath(const UString &key);
+
+  public:
+	AssetCache(FileSystem &fs, const UString &directory);
+	~AssetCache();
+
+	sp<ImageSet> loadImageSet(const UString &key, const std::vector<UString> &sources);
+	void storeImageSet(const UString &key, const std::vector<UString> &sources,
+	                   sp<ImageSet> imageSet);
+
+	sp<LOFTemps> loadLOFTemps(const UString &key, const std::vector<UString> &sources);
+	void storeLOFTemps(const UString &key, const std::vector<UString> &sources,
+	                   sp<LOFTemps> lofTemps);
+
+	sp<Palette> loadPalette(const UString &key, const std::vector<UString> &sources);
+	void storePalette(const UString &key, const std::vector<UString> &sources,
+	                  sp<Palette> palette);
+};
+
+} // namespace OpenApoc
@@ -2,6 +2,7 @@ cmake_minimum_required(VERSION 2.8)
 
 option (BUILD_SDL2_SOUNDBACKEND "Build an SDL2 audio backend" ON)
 option (BUILD_NULL_SOUNDBACKEND "Build an null (non-functional) audio backend" ON)
+option (BUILD_FILE_SOUNDBACKEND "Build an audio backend that writes the mix to a WAV file" ON)
 
 set (SOUNDBACKENDS "")
 set (SOUNDBACKEND_SOURCES "")
@@ -11,6 +12,7 @@ set (SOUNDBACKEND_INCLUDES "")
 if(BUILD_SDL2_SOUNDBACKEND)
 		list(APPEND SOUNDBACKENDS sdl2)
 		list(APPEND SOUNDBACKEND_SOURCES "framework/sound/sdlraw_backend.cpp")
+		list(APPEND SOUNDBACKEND_SOURCES "framework/sound/mixer.cpp")
 		pkg_check_modules(PC_SDL2 REQUIRED sdl2>=2.0)
 		if (NOT PC_SDL2_FOUND)
 				message(FATAL_ERROR "sdl2 not found")
@@ -32,6 +34,14 @@ if(BUILD_NULL_SOUNDBACKEND)
 		list(APPEND SOUNDBACKEND_SOURCES "framework/sound/null_backend.cpp")
 endif()
 
+if(BUILD_FILE_SOUNDBACKEND)
+		list(APPEND SOUNDBACKENDS file)
+		list(APPEND SOUNDBACKEND_SOURCES "framework/sound/file_backend.cpp")
+		list(APPEND SOUNDBACKEND_SOURCES "framework/sound/mixer.cpp")
+endif()
+
+list(REMOVE_DUPLICATES SOUNDBACKEND_SOURCES)
+
 if (NOT SOUNDBACKENDS)
 		message(FATAL_ERROR "No sound backends specified")
 endif()
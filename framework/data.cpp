@@ -1,6 +1,8 @@
 #include "library/sp.h"
 #include "framework/logger.h"
 #include "framework/data.h"
+#include "framework/metrics.h"
+#include "framework/assetcache.h"
 #include "game/apocresources/pck.h"
 #include "game/apocresources/rawimage.h"
 #include "game/apocresources/apocpalette.h"
@@ -18,6 +20,49 @@ using namespace OpenApoc;
 
 namespace
 {
+// Number of cache misses between scans for expired weak entries
+const unsigned int pruneInterval = 256;
+
+// Approximate memory used by each resource type, for the resource cache budget
+size_t imageBytes(const OpenApoc::Image &img)
+{
+	size_t pixels = static_cast<size_t>(img.size.x) * img.size.y;
+	if (dynamic_cast<const OpenApoc::PaletteImage *>(&img))
+		return pixels;
+	return pixels * sizeof(OpenApoc::Colour);
+}
+
+size_t imageSetBytes(const OpenApoc::ImageSet &set)
+{
+	size_t bytes = 0;
+	for (auto &img : set.images)
+		bytes += imageBytes(*img);
+	return bytes;
+}
+
+size_t sampleBytes(const OpenApoc::Sample &sample)
+{
+	size_t bytesPerSample =
+	    sample.format.format == OpenApoc::AudioFormat::SampleFormat::PCM_SINT16 ? 2 : 1;
+	return static_cast<size_t>(sample.sampleCount) * sample.format.channels * bytesPerSample;
+}
+
+size_t paletteBytes(const OpenApoc::Palette &palette)
+{
+	return palette.colours.size() * sizeof(OpenApoc::Colour);
+}
+
+size_t lofTempsBytes(OpenApoc::LOFTemps &lofTemps)
+{
+	size_t bytes = 0;
+	for (unsigned int i = 0; i < lofTemps.getSliceCount(); i++)
+	{
+		auto &size = lofTemps.getSlice(i)->getSize();
+		bytes += size.x * size.y / 8;
+	}
+	return bytes;
+}
+
 std::map<UString, std::unique_ptr<OpenApoc::ImageLoaderFactory>> *registeredImageBackends = nullptr;
 std::map<UString, std::unique_ptr<OpenApoc::MusicLoaderFactory>> *registeredMusicLoaders = nullptr;
 std::map<UString, std::unique_ptr<OpenApoc::SampleLoaderFactory>> *registeredSampleLoaders =
@@ -55,9 +100,8 @@ void registerMusicLoader(MusicLoaderFactory *factory, UString name)
 	registeredMusicLoaders->emplace(name, std::unique_ptr<MusicLoaderFactory>(factory));
 }
 
-Data::Data(std::vector<UString> paths, int imageCacheSize, int imageSetCacheSize,
-           int voxelCacheSize)
-    : fs(paths)
+Data::Data(std::vector<UString> paths, size_t resourceCacheSize)
+    : resourceCache(resourceCacheSize), missesSincePrune(0), fs(paths)
 {
 	for (auto &imageBackend : *registeredImageBackends)
 	{
@@ -97,15 +141,85 @@ Data::Data(std::vector<UString> paths, int imageCacheSize, int imageSetCacheSize
 		else
 			LogWarning("Failed to load music loader %s", t.c_str());
 	}
-	for (int i = 0; i < imageCacheSize; i++)
-		pinnedImages.push(nullptr);
-	for (int i = 0; i < imageSetCacheSize; i++)
-		pinnedImageSets.push(nullptr);
-	for (int i = 0; i < voxelCacheSize; i++)
-		pinnedLOFVoxels.push(nullptr);
+	LogInfo("Resource cache budget %u KiB", static_cast<unsigned>(resourceCacheSize / 1024));
+}
+
+Data::~Data()
+{
+	auto &stats = this->resourceCache.getStats();
+	LogInfo("Resource cache: %llu hits, %llu misses, %llu evictions, %llu pruned, %u KiB in use",
+	        static_cast<unsigned long long>(stats.hits),
+	        static_cast<unsigned long long>(stats.misses),
+	        static_cast<unsigned long long>(stats.evictions),
+	        static_cast<unsigned long long>(stats.pruned),
+	        static_cast<unsigned>(this->resourceCache.getUsed() / 1024));
+}
+
+template <typename T>
+static uint64_t pruneMap(std::map<UString, std::weak_ptr<T>> &cache)
+{
+	uint64_t count = 0;
+	for (auto it = cache.begin(); it != cache.end();)
+	{
+		if (it->second.expired())
+		{
+			it = cache.erase(it);
+			count++;
+		}
+		else
+			it++;
+	}
+	return count;
+}
+
+void Data::pruneExpired()
+{
+	uint64_t count = 0;
+	count += pruneMap(this->imageCache);
+	count += pruneMap(this->imageSetCache);
+	count += pruneMap(this->sampleCache);
+	count += pruneMap(this->LOFVoxelCache);
+	count += pruneMap(this->paletteCache);
+	this->resourceCache.recordPruned(count);
+	this->missesSincePrune = 0;
+}
+
+template <typename T>
+sp<T> Data::findCached(std::map<UString, std::weak_ptr<T>> &cache, const UString &key)
+{
+	auto it = cache.find(key);
+	if (it != cache.end())
+	{
+		auto resource = it->second.lock();
+		if (resource)
+		{
+			static auto &hits = Metrics::counter("Data.CacheHits");
+			hits.add();
+			this->resourceCache.recordHit();
+			this->resourceCache.touch(resource.get());
+			return resource;
+		}
+	}
+	static auto &misses = Metrics::counter("Data.CacheMisses");
+	misses.add();
+	this->resourceCache.recordMiss();
+	if (++this->missesSincePrune >= pruneInterval)
+		this->pruneExpired();
+	return nullptr;
 }
 
-Data::~Data() {}
+template <typename T>
+void Data::storeCached(std::map<UString, std::weak_ptr<T>> &cache, const UString &key,
+                       sp<T> resource, size_t bytes)
+{
+	cache[key] = resource;
+	this->resourceCache.pin(resource, bytes);
+}
+
+void Data::enableDiskCache(const UString &directory)
+{
+	this->diskCache.reset(new AssetCache(this->fs, directory));
+}
 
 sp<VoxelSlice> Data::load_voxel_slice(const UString &path)
 {
@@ -122,7 +236,17 @@ sp<VoxelSlice> Data::load_voxel_slice(const UString &path)
 		// Cut off the index to get the LOFTemps file
 		UString cacheKey = splitString[0] + splitString[1] + splitString[2];
 		cacheKey = cacheKey.toUpper();
-		sp<LOFTemps> lofTemps = this->LOFVoxelCache[cacheKey].lock();
+		sp<LOFTemps> lofTemps = this->findCached(this->LOFVoxelCache, cacheKey);
+		std::vector<UString> sources = {splitString[1], splitString[2]};
+		if (!lofTemps && this->diskCache)
+		{
+			lofTemps = this->diskCache->loadLOFTemps(cacheKey, sources);
+			if (lofTemps)
+			{
+				this->storeCached(this->LOFVoxelCache, cacheKey, lofTemps,
+				                  lofTempsBytes(*lofTemps));
+			}
+		}
 		if (!lofTemps)
 		{
 			TRACE_FN_ARGS1("path", path);
@@ -139,9 +263,9 @@ sp<VoxelSlice> Data::load_voxel_slice(const UString &path)
 				return nullptr;
 			}
 			lofTemps = mksp<LOFTemps>(datFile, tabFile);
-			this->LOFVoxelCache[cacheKey] = lofTemps;
-			this->pinnedLOFVoxels.push(lofTemps);
-			this->pinnedLOFVoxels.pop();
+			if (this->diskCache)
+				this->diskCache->storeLOFTemps(cacheKey, sources, lofTemps);
+			this->storeCached(this->LOFVoxelCache, cacheKey, lofTemps, lofTempsBytes(*lofTemps));
 		}
 		int idx = Strings::ToInteger(splitString[3]);
 		slice = lofTemps->getSlice(idx);
@@ -162,17 +286,31 @@ sp<VoxelSlice> Data::load_voxel_slice(const UString &path)
 sp<ImageSet> Data::load_image_set(const UString &path)
 {
 	UString cacheKey = path.toUpper();
-	sp<ImageSet> imgSet = this->imageSetCache[cacheKey].lock();
+	sp<ImageSet> imgSet = this->findCached(this->imageSetCache, cacheKey);
 	if (imgSet)
 	{
 		return imgSet;
 	}
 	TRACE_FN_ARGS1("path", path);
+	// The files each set is decoded from, used to validate the disk cache
+	std::vector<UString> sources;
+	auto splitString = path.split(':');
+	if (path.substr(0, 4) == "RAW:" && splitString.size() >= 2)
+		sources = {splitString[1]};
+	else if (splitString.size() >= 3)
+		sources = {splitString[1], splitString[2]};
+	if (this->diskCache && !sources.empty())
+		imgSet = this->diskCache->loadImageSet(cacheKey, sources);
+	bool fromDiskCache = imgSet != nullptr;
+
+	if (fromDiskCache)
+	{
+		// Nothing to decode
+	}
 	// Raw resources come in the format:
 	//"RAW:PATH:WIDTH:HEIGHT[:optional/ignored]"
-	if (path.substr(0, 4) == "RAW:")
+	else if (path.substr(0, 4) == "RAW:")
 	{
-		auto splitString = path.split(':');
 		imgSet = RawImage::load_set(
 		    *this, splitString[1],
 		    Vec2<int>{Strings::ToInteger(splitString[2]), Strings::ToInteger(splitString[3])});
@@ -181,17 +319,14 @@ sp<ImageSet> Data::load_image_set(const UString &path)
 	//"PCK:PCKFILE:TABFILE[:optional/ignored]"
 	else if (path.substr(0, 4) == "PCK:")
 	{
-		auto splitString = path.split(':');
 		imgSet = PCKLoader::load(*this, splitString[1], splitString[2]);
 	}
 	else if (path.substr(0, 9) == "PCKSTRAT:")
 	{
-		auto splitString = path.split(':');
 		imgSet = PCKLoader::load_strat(*this, splitString[1], splitString[2]);
 	}
 	else if (path.substr(0, 10) == "PCKSHADOW:")
 	{
-		auto splitString = path.split(':');
 		imgSet = PCKLoader::load_shadow(*this, splitString[1], splitString[2]);
 	}
 	else
@@ -199,11 +334,13 @@ sp<ImageSet> Data::load_image_set(const UString &path)
 		LogError("Unknown image set format \"%s\"", path.c_str());
 		return nullptr;
 	}
+	if (imgSet && !fromDiskCache && this->diskCache && !sources.empty())
+	{
+		this->diskCache->storeImageSet(cacheKey, sources, imgSet);
+	}
 
-	this->pinnedImageSets.push(imgSet);
-	this->pinnedImageSets.pop();
-
-	this->imageSetCache[cacheKey] = imgSet;
+	if (imgSet)
+		this->storeCached(this->imageSetCache, cacheKey, imgSet, imageSetBytes(*imgSet));
 	return imgSet;
 }
 
@@ -220,7 +357,7 @@ sp<Sample> Data::load_sample(UString path)
 		}
 	}
 	UString cacheKey = path.toUpper();
-	sp<Sample> sample = this->sampleCache[cacheKey].lock();
+	sp<Sample> sample = this->findCached(this->sampleCache, cacheKey);
 	if (sample)
 		return sample;
 
@@ -236,7 +373,7 @@ sp<Sample> Data::load_sample(UString path)
 		LogInfo("Failed to load sample \"%s\"", path.c_str());
 		return nullptr;
 	}
-	this->sampleCache[cacheKey] = sample;
+	this->storeCached(this->sampleCache, cacheKey, sample, sampleBytes(*sample));
 	return sample;
 }
 
@@ -262,7 +399,7 @@ sp<Image> Data::load_image(const UString &path)
 	}
 	// Use an uppercase version of the path for the cache key
 	UString cacheKey = path.toUpper();
-	sp<Image> img = this->imageCache[cacheKey].lock();
+	sp<Image> img = this->findCached(this->imageCache, cacheKey);
 	if (img)
 	{
 		return img;
@@ -317,7 +454,7 @@ sp<Image> Data::load_image(const UString &path)
 				LogError("Failed to load palette for RAW image: \"%s\"", path.c_str());
 				return nullptr;
 			}
-			img = pImg->toRGBImage(pal);
+			img = pImg->withPalette(pal);
 		}
 		else
 		{
@@ -341,7 +478,7 @@ sp<Image> Data::load_image(const UString &path)
 		// PCK resources come in the format:
 		//"PCK:PCKFILE:TABFILE:INDEX"
 		// or
-		//"PCK:PCKFILE:TABFILE:INDEX:PALETTE" if we want them already in rgb space
+		//"PCK:PCKFILE:TABFILE:INDEX:PALETTE" if they should always be drawn with that palette
 		switch (splitString.size())
 		{
 			case 4:
@@ -356,7 +493,7 @@ sp<Image> Data::load_image(const UString &path)
 				assert(pImg);
 				auto pal = this->load_palette(splitString[4]);
 				assert(pal);
-				img = pImg->toRGBImage(pal);
+				img = pImg->withPalette(pal);
 				break;
 			}
 			default:
@@ -381,7 +518,7 @@ sp<Image> Data::load_image(const UString &path)
 		// PCK resources come in the format:
 		//"PCK:PCKFILE:TABFILE:INDEX"
 		// or
-		//"PCK:PCKFILE:TABFILE:INDEX:PALETTE" if we want them already in rgb space
+		//"PCK:PCKFILE:TABFILE:INDEX:PALETTE" if they should always be drawn with that palette
 		switch (splitString.size())
 		{
 			case 4:
@@ -396,7 +533,7 @@ sp<Image> Data::load_image(const UString &path)
 				assert(pImg);
 				auto pal = this->load_palette(splitString[4]);
 				assert(pal);
-				img = pImg->toRGBImage(pal);
+				img = pImg->withPalette(pal);
 				break;
 			}
 			default:
@@ -421,7 +558,7 @@ sp<Image> Data::load_image(const UString &path)
 		// PCK resources come in the format:
 		//"PCK:PCKFILE:TABFILE:INDEX"
 		// or
-		//"PCK:PCKFILE:TABFILE:INDEX:PALETTE" if we want them already in rgb space
+		//"PCK:PCKFILE:TABFILE:INDEX:PALETTE" if they should always be drawn with that palette
 		switch (splitString.size())
 		{
 			case 4:
@@ -436,7 +573,7 @@ sp<Image> Data::load_image(const UString &path)
 				assert(pImg);
 				auto pal = this->load_palette(splitString[4]);
 				assert(pal);
-				img = pImg->toRGBImage(pal);
+				img = pImg->withPalette(pal);
 				break;
 			}
 			default:
@@ -464,15 +601,32 @@ sp<Image> Data::load_image(const UString &path)
 		}
 	}
 
-	this->pinnedImages.push(img);
-	this->pinnedImages.pop();
-
-	this->imageCache[cacheKey] = img;
+	this->storeCached(this->imageCache, cacheKey, img, imageBytes(*img));
 	img->sourcePath = path;
 	return img;
 }
 
 sp<Palette> Data::load_palette(const UString &path)
+{
+	UString cacheKey = path.toUpper();
+	sp<Palette> pal = this->findCached(this->paletteCache, cacheKey);
+	if (pal)
+		return pal;
+
+	if (this->diskCache)
+		pal = this->diskCache->loadPalette(cacheKey, {path});
+	if (!pal)
+	{
+		pal = this->decode_palette(path);
+		if (pal && this->diskCache)
+			this->diskCache->storePalette(cacheKey, {path}, pal);
+	}
+	if (pal)
+		this->storeCached(this->paletteCache, cacheKey, pal, paletteBytes(*pal));
+	return pal;
+}
+
+sp<Palette> Data::decode_palette(const UString &path)
 {
 	auto pal = loadPCXPalette(*this, path);
 	if (pal)
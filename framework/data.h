@@ -5,10 +5,10 @@
 #include "framework/image.h"
 #include "framework/sound.h"
 #include "framework/fs.h"
+#include "framework/resourcecache.h"
 
 #include <memory>
 #include <map>
-#include <queue>
 #include <list>
 #include <vector>
 
@@ -20,6 +20,7 @@ class MusicLoader;
 class VoxelSlice;
 class LOFTemps;
 class ResourceAliases;
+class AssetCache;
 
 class Data
 {
@@ -31,28 +32,48 @@ class Data
 	std::map<UString, std::weak_ptr<Sample>> sampleCache;
 	std::map<UString, std::weak_ptr<MusicTrack>> musicCache;
 	std::map<UString, std::weak_ptr<LOFTemps>> LOFVoxelCache;
+	std::map<UString, std::weak_ptr<Palette>> paletteCache;
 
-	// Pin open 'imageCacheSize' images
-	std::queue<sp<Image>> pinnedImages;
-	// Pin open 'imageSetCacheSize' image sets
-	std::queue<sp<ImageSet>> pinnedImageSets;
-	std::queue<sp<LOFTemps>> pinnedLOFVoxels;
+	// Keeps the most recently used resources alive up to a memory budget
+	ResourceCache resourceCache;
+	// Expired entries are dropped from the maps above every 'pruneInterval' misses
+	unsigned int missesSincePrune;
+	void pruneExpired();
+
+	template <typename T>
+	sp<T> findCached(std::map<UString, std::weak_ptr<T>> &cache, const UString &key);
+	template <typename T>
+	void storeCached(std::map<UString, std::weak_ptr<T>> &cache, const UString &key,
+	                 sp<T> resource, size_t bytes);
 	std::list<std::unique_ptr<ImageLoader>> imageLoaders;
 	std::list<std::unique_ptr<SampleLoader>> sampleLoaders;
 	std::list<std::unique_ptr<MusicLoader>> musicLoaders;
 
+	// Optional on-disk cache of decoded image sets, LOFTemps and palettes
+	std::unique_ptr<AssetCache> diskCache;
+
+	sp<Palette> decode_palette(const UString &path);
+
   public:
 	std::weak_ptr<ResourceAliases> aliases;
 	FileSystem fs;
 
-	Data(std::vector<UString> paths, int imageCacheSize = 100, int imageSetCacheSize = 10,
-	     int voxelCacheSize = 1);
+	// 'resourceCacheSize' is the budget in bytes for keeping unreferenced resources loaded
+	Data(std::vector<UString> paths, size_t resourceCacheSize = 64 * 1024 * 1024);
 	~Data();
 
+	// Store decoded resources under 'directory' in the write dir and reuse them on later runs
+	void enableDiskCache(const UString &directory);
+
+	const ResourceCache::Stats &getCacheStats() const { return resourceCache.getStats(); }
+	size_t getCacheUsed() const { return resourceCache.getUsed(); }
+	void setCacheSize(size_t bytes) { resourceCache.setBudget(bytes); }
+
 	sp<Sample> load_sample(UString path);
 	sp<MusicTrack> load_music(const UString &path);
 	sp<Image> load_image(const UString &path);
 	sp<ImageSet> load_image_set(const UString &path);
+	// Palettes are shared between everything that loads the same path, so must not be modified
 	sp<Palette> load_palette(const UString &path);
 	sp<VoxelSlice> load_voxel_slice(const UString &path);
 };
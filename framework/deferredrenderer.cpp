@@ -0,0 +1,305 @@
+#include "library/sp.h"
+#include "framework/deferredrenderer.h"
+#include "framework/image.h"
+#include "framework/metrics.h"
+#include "framework/palette.h"
+#include "framework/trace.h"
+
+#include <algorithm>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+Rect<float> boundsOf(Vec2<float> a, Vec2<float> b, float border = 0.0f)
+{
+	return Rect<float>{std::min(a.x, b.x) - border, std::min(a.y, b.y) - border,
+	                   std::max(a.x, b.x) + border, std::max(a.y, b.y) + border};
+}
+
+} // anonymous namespace
+
+DeferredRenderer::DeferredRenderer(Renderer &target)
+    : target(target), currentPalette(target.getPalette()), batchCount(0), unsortedBatchCount(0)
+{
+}
+
+DeferredRenderer::~DeferredRenderer() { this->submit(); }
+
+void DeferredRenderer::record(Command &command)
+{
+	if (this->commands.empty() || this->commands.back().key != command.key)
+		this->unsortedBatchCount++;
+
+	unsigned int index = this->commands.size();
+	this->commands.push_back(std::move(command));
+	auto &c = this->commands.back();
+
+	// Walk back through the batches for one with the same state, stopping at the first one that
+	// draws anything under this call as it has to stay on top of that
+	unsigned int joined = this->batchCount;
+	unsigned int lowest = this->batchCount > MaxLookback ? this->batchCount - MaxLookback : 0;
+	for (unsigned int b = this->batchCount; b-- > lowest;)
+	{
+		if (this->batches[b].key == c.key)
+		{
+			joined = b;
+			break;
+		}
+		if (this->overlaps(this->batches[b], c.bounds))
+			break;
+	}
+
+	if (joined == this->batchCount)
+	{
+		if (this->batches.size() == this->batchCount)
+			this->batches.emplace_back();
+		auto &batch = this->batches[this->batchCount++];
+		batch.key = c.key;
+		batch.bounds = c.bounds;
+	}
+	else
+	{
+		auto &bounds = this->batches[joined].bounds;
+		bounds.p0.x = std::min(bounds.p0.x, c.bounds.p0.x);
+		bounds.p0.y = std::min(bounds.p0.y, c.bounds.p0.y);
+		bounds.p1.x = std::max(bounds.p1.x, c.bounds.p1.x);
+		bounds.p1.y = std::max(bounds.p1.y, c.bounds.p1.y);
+	}
+	this->batches[joined].commands.push_back(index);
+}
+
+bool DeferredRenderer::overlaps(const Batch &batch, const Rect<float> &bounds) const
+{
+	if (!batch.bounds.intersects(bounds))
+		return false;
+	// Calls are mostly recorded near the ones before them, so the newest are the likeliest to
+	// overlap and checking them first keeps this from scanning the whole batch on every call
+	for (auto it = batch.commands.rbegin(); it != batch.commands.rend(); it++)
+	{
+		if (this->commands[*it].bounds.intersects(bounds))
+			return true;
+	}
+	return false;
+}
+
+void DeferredRenderer::execute(const Command &command)
+{
+	if (command.palette && command.palette != this->target.getPalette())
+		this->target.setPalette(command.palette);
+	switch (command.key.type)
+	{
+		case CommandType::Draw:
+			this->target.draw(command.image, command.position);
+			break;
+		case CommandType::DrawRotated:
+			this->target.drawRotated(command.image, command.extent, command.position,
+			                         command.value);
+			break;
+		case CommandType::DrawScaled:
+			this->target.drawScaled(command.image, command.position, command.extent,
+			                        command.scaler);
+			break;
+		case CommandType::DrawTinted:
+			this->target.drawTinted(command.image, command.position, command.colour);
+			break;
+		case CommandType::DrawFilledRect:
+			this->target.drawFilledRect(command.position, command.extent, command.colour);
+			break;
+		case CommandType::DrawRect:
+			this->target.drawRect(command.position, command.extent, command.colour,
+			                      command.value);
+			break;
+		case CommandType::DrawLine:
+			this->target.drawLine(command.position, command.extent, command.colour,
+			                      command.value);
+			break;
+	}
+}
+
+void DeferredRenderer::submit()
+{
+	if (this->commands.empty())
+		return;
+	TRACE_FN;
+
+	// The batch counts are estimated from the state keys, the target's Renderer.Flushes counter
+	// has the batches it really drew
+	static auto &commandCount = Metrics::counter("Renderer.DeferredCommands");
+	static auto &unsortedBatches = Metrics::counter("Renderer.DeferredBatchesInOrder");
+	static auto &sortedBatches = Metrics::counter("Renderer.DeferredBatchesSorted");
+	commandCount.add(this->commands.size());
+	unsortedBatches.add(this->unsortedBatchCount);
+	sortedBatches.add(this->batchCount);
+
+	for (unsigned int b = 0; b < this->batchCount; b++)
+	{
+		for (auto index : this->batches[b].commands)
+			this->execute(this->commands[index]);
+		this->batches[b].commands.clear();
+	}
+	this->commands.clear();
+	this->batchCount = 0;
+	this->unsortedBatchCount = 0;
+
+	if (this->currentPalette && this->target.getPalette() != this->currentPalette)
+		this->target.setPalette(this->currentPalette);
+}
+
+void DeferredRenderer::setSurface(sp<Surface> s)
+{
+	this->submit();
+	this->target.setSurface(s);
+}
+
+sp<Surface> DeferredRenderer::getSurface() { return this->target.getSurface(); }
+
+void DeferredRenderer::clear(Colour c)
+{
+	// Anything recorded would be cleared anyway
+	this->commands.clear();
+	for (unsigned int b = 0; b < this->batchCount; b++)
+		this->batches[b].commands.clear();
+	this->batchCount = 0;
+	this->unsortedBatchCount = 0;
+	this->target.clear(c);
+}
+
+void DeferredRenderer::setPalette(sp<Palette> p) { this->currentPalette = p; }
+
+sp<Palette> DeferredRenderer::getPalette() { return this->currentPalette; }
+
+void DeferredRenderer::draw(sp<Image> i, Vec2<float> position)
+{
+	Command c;
+	c.key.type = CommandType::Draw;
+	// Everything in a set can be batched together
+	auto owningSet = i->owningSet.lock();
+	c.key.texture = owningSet ? static_cast<const void *>(owningSet.get()) : i.get();
+	c.key.palette = nullptr;
+	auto paletteImage = std::dynamic_pointer_cast<PaletteImage>(i);
+	if (paletteImage)
+	{
+		c.palette = this->currentPalette;
+		c.key.palette = paletteImage->palette ? paletteImage->palette.get() : c.palette.get();
+	}
+	c.position = position;
+	c.bounds = boundsOf(position, position + Vec2<float>{i->size});
+	c.image = std::move(i);
+	this->record(c);
+}
+
+void DeferredRenderer::drawRotated(sp<Image> i, Vec2<float> center, Vec2<float> position,
+                                   float angle)
+{
+	Command c;
+	c.key.type = CommandType::DrawRotated;
+	c.key.texture = i.get();
+	c.key.palette = nullptr;
+	c.position = position;
+	c.extent = center;
+	c.value = angle;
+	// Whatever the angle, the image stays within the circle around the center that reaches its
+	// furthest corner
+	Vec2<float> size{i->size};
+	float radius = 0.0f;
+	for (auto corner : {Vec2<float>{0, 0}, Vec2<float>{size.x, 0}, Vec2<float>{0, size.y}, size})
+		radius = std::max(radius, glm::length(corner - center));
+	c.bounds = boundsOf(position + center, position + center, radius);
+	c.image = std::move(i);
+	this->record(c);
+}
+
+void DeferredRenderer::drawScaled(sp<Image> i, Vec2<float> position, Vec2<float> size,
+                                  Scaler scaler)
+{
+	Command c;
+	c.key.type = CommandType::DrawScaled;
+	c.key.texture = i.get();
+	c.key.palette = nullptr;
+	if (std::dynamic_pointer_cast<PaletteImage>(i))
+	{
+		c.palette = this->currentPalette;
+		c.key.palette = c.palette.get();
+	}
+	c.position = position;
+	c.extent = size;
+	c.scaler = scaler;
+	c.bounds = boundsOf(position, position + size);
+	c.image = std::move(i);
+	this->record(c);
+}
+
+void DeferredRenderer::drawTinted(sp<Image> i, Vec2<float> position, Colour tint)
+{
+	Command c;
+	c.key.type = CommandType::DrawTinted;
+	c.key.texture = i.get();
+	c.key.palette = nullptr;
+	if (std::dynamic_pointer_cast<PaletteImage>(i))
+	{
+		c.palette = this->currentPalette;
+		c.key.palette = c.palette.get();
+	}
+	c.position = position;
+	c.colour = tint;
+	c.bounds = boundsOf(position, position + Vec2<float>{i->size});
+	c.image = std::move(i);
+	this->record(c);
+}
+
+void DeferredRenderer::drawFilledRect(Vec2<float> position, Vec2<float> size, Colour colour)
+{
+	Command c;
+	c.key.type = CommandType::DrawFilledRect;
+	c.key.texture = nullptr;
+	c.key.palette = nullptr;
+	c.position = position;
+	c.extent = size;
+	c.colour = colour;
+	c.bounds = boundsOf(position, position + size);
+	this->record(c);
+}
+
+void DeferredRenderer::drawRect(Vec2<float> position, Vec2<float> size, Colour colour,
+                                float thickness)
+{
+	Command c;
+	c.key.type = CommandType::DrawRect;
+	c.key.texture = nullptr;
+	c.key.palette = nullptr;
+	c.position = position;
+	c.extent = size;
+	c.colour = colour;
+	c.value = thickness;
+	c.bounds = boundsOf(position, position + size);
+	this->record(c);
+}
+
+void DeferredRenderer::drawLine(Vec2<float> p1, Vec2<float> p2, Colour colour, float thickness)
+{
+	Command c;
+	c.key.type = CommandType::DrawLine;
+	c.key.texture = nullptr;
+	c.key.palette = nullptr;
+	c.position = p1;
+	c.extent = p2;
+	c.colour = colour;
+	c.value = thickness;
+	c.bounds = boundsOf(p1, p2, thickness);
+	this->record(c);
+}
+
+void DeferredRenderer::flush()
+{
+	this->submit();
+	this->target.flush();
+}
+
+UString DeferredRenderer::getName() { return "Deferred " + this->target.getName(); }
+
+sp<Surface> DeferredRenderer::getDefaultSurface() { return this->target.getDefaultSurface(); }
+
+} // namespace OpenApoc
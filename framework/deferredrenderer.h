@@ -0,0 +1,112 @@
+#pragma once
+#include "library/sp.h"
+#include "library/rect.h"
+#include "framework/renderer.h"
+
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Records draw calls instead of making them, then hands them to another renderer grouped so calls
+// using the same program and texture are made together and can share a batch. A call is only
+// moved ahead of earlier calls it doesn't overlap on screen, so the result looks the same as
+// drawing everything in the order it was recorded.
+class DeferredRenderer : public Renderer
+{
+  private:
+	enum class CommandType
+	{
+		Draw,
+		DrawRotated,
+		DrawScaled,
+		DrawTinted,
+		DrawFilledRect,
+		DrawRect,
+		DrawLine,
+	};
+
+	// Calls with equal keys can be made one after another without the target changing state
+	class StateKey
+	{
+	  public:
+		CommandType type;
+		const void *texture;
+		const Palette *palette;
+
+		bool operator==(const StateKey &other) const
+		{
+			return type == other.type && texture == other.texture && palette == other.palette;
+		}
+		bool operator!=(const StateKey &other) const { return !(*this == other); }
+	};
+
+	class Command
+	{
+	  public:
+		StateKey key;
+		sp<Image> image;
+		sp<Palette> palette;
+		// The second point of a line, the size of a rect or scaled image, or the rotation center
+		Vec2<float> position, extent;
+		// Line or rect thickness, or the rotation angle
+		float value = 0.0f;
+		Colour colour;
+		Scaler scaler = Scaler::Nearest;
+		Rect<float> bounds;
+	};
+
+	class Batch
+	{
+	  public:
+		StateKey key;
+		Rect<float> bounds;
+		std::vector<unsigned int> commands;
+	};
+
+	Renderer &target;
+	sp<Palette> currentPalette;
+	std::vector<Command> commands;
+	// Only the first 'batchCount' are in use, the rest are kept to reuse their command lists
+	std::vector<Batch> batches;
+	unsigned int batchCount;
+	// Number of times the key changes between consecutive calls in recorded order
+	unsigned int unsortedBatchCount;
+
+	void record(Command &command);
+	bool overlaps(const Batch &batch, const Rect<float> &bounds) const;
+	void execute(const Command &command);
+
+	void setSurface(sp<Surface> s) override;
+	sp<Surface> getSurface() override;
+
+  public:
+	// How many batches back a call is allowed to move past looking for one it can join
+	static const unsigned int MaxLookback = 64;
+
+	DeferredRenderer(Renderer &target);
+	~DeferredRenderer() override;
+
+	// Make every recorded call on the target renderer, without flushing it
+	void submit();
+
+	void clear(Colour c = Colour{0, 0, 0, 0}) override;
+	void setPalette(sp<Palette> p) override;
+	sp<Palette> getPalette() override;
+	void draw(sp<Image> i, Vec2<float> position) override;
+	void drawRotated(sp<Image> i, Vec2<float> center, Vec2<float> position,
+	                 float angle) override;
+	void drawScaled(sp<Image> i, Vec2<float> position, Vec2<float> size,
+	                Scaler scaler = Scaler::Linear) override;
+	void drawTinted(sp<Image> i, Vec2<float> position, Colour tint) override;
+	void drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c) override;
+	void drawRect(Vec2<float> position, Vec2<float> size, Colour c,
+	              float thickness = 1.0) override;
+	void drawLine(Vec2<float> p1, Vec2<float> p2, Colour c, float thickness = 1.0) override;
+	void flush() override;
+	UString getName() override;
+
+	sp<Surface> getDefaultSurface() override;
+};
+
+} // namespace OpenApoc
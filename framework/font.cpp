@@ -3,8 +3,6 @@
 #include "framework/image.h"
 #include "framework/font.h"
 
-#include <boost/locale.hpp>
-
 namespace OpenApoc
 {
 
@@ -17,12 +15,8 @@ sp<PaletteImage> BitmapFont::getString(const UString &Text)
 	auto img = mksp<PaletteImage>(Vec2<int>{width, height});
 	int pos = 0;
 
-	auto u8Str = Text.str();
-	auto pointString = boost::locale::conv::utf_to_utf<UniChar>(u8Str);
-
-	for (size_t i = 0; i < pointString.length(); i++)
+	for (UniChar c : Text)
 	{
-		UniChar c = pointString[i];
 		auto glyph = this->getGlyph(c);
 		PaletteImage::blit(glyph, Vec2<int>{pos, 0}, img);
 		pos += glyph->size.x;
@@ -34,12 +28,9 @@ sp<PaletteImage> BitmapFont::getString(const UString &Text)
 int BitmapFont::GetFontWidth(const UString &Text)
 {
 	int textlen = 0;
-	auto u8Str = Text.str();
-	auto pointString = boost::locale::conv::utf_to_utf<UniChar>(u8Str);
-
-	for (size_t i = 0; i < Text.length(); i++)
+	for (UniChar c : Text)
 	{
-		auto glyph = this->getGlyph(pointString[i]);
+		auto glyph = this->getGlyph(c);
 		textlen += glyph->size.x;
 	}
 	return textlen;
@@ -6,12 +6,16 @@
 #include "framework/renderer_interface.h"
 #include "framework/sound_interface.h"
 #include "framework/sound.h"
+#include "framework/metrics.h"
+#include "framework/metricsoverlay.h"
 #include "framework/trace.h"
+#include "framework/inputrecording.h"
 
 #include "game/resources/gamecore.h"
 
 #include <SDL.h>
 #include <iostream>
+#include <random>
 #include <string>
 
 // Use physfs to get prefs dir
@@ -61,14 +65,26 @@ static std::map<UString, UString> defaultConfig = {
     {"Resource.SystemDataDir", DATA_DIRECTORY},
     {"Resource.LocalCDPath", "./data/cd.iso"},
     {"Resource.SystemCDPath", DATA_DIRECTORY "/cd.iso"},
+    {"Resource.CacheSizeMB", "64"},
+    {"Resource.DiskCache", "true"},
+    {"Resource.DiskCacheDir", "cache"},
     {"Visual.Renderers", RENDERERS},
     {"Audio.Backends", "SDLRaw:null"},
     {"Audio.GlobalGain", "20"},
     {"Audio.SampleGain", "20"},
     {"Audio.MusicGain", "20"},
+    {"Audio.MaxVoices", "32"},
+    {"Audio.File.Path", "audio.wav"},
+    {"Audio.File.Paced", "true"},
     {"Framework.ThreadPoolSize", "0"},
+    {"Framework.LogLevel", "Info"},
+    {"Framework.MetricsCSV", "metrics.csv"},
+    {"Framework.MetricsOnExit", "false"},
+    {"Framework.InputRecord", ""},
+    {"Framework.InputReplay", ""},
     {"Visual.ScaleX", "100"},
     {"Visual.ScaleY", "100"},
+    {"Visual.DeferredWorldRendering", "false"},
 };
 
 std::map<UString, std::unique_ptr<OpenApoc::RendererFactory>> *registeredRenderers = nullptr;
@@ -167,6 +183,13 @@ class FrameworkPrivate
 	Vec2<int> windowSize;
 
 	sp<Surface> scaleSurface;
+
+	std::unique_ptr<MetricsOverlay> metricsOverlay;
+
+	uint64_t frame;
+	unsigned int randomSeed;
+	std::unique_ptr<InputRecorder> inputRecorder;
+	std::unique_ptr<InputReplay> inputReplay;
 };
 
 Framework::Framework(const UString programName, const std::vector<UString> cmdline)
@@ -179,6 +202,8 @@ Framework::Framework(const UString programName, const std::vector<UString> cmdli
 	{
 		LogError("Multiple Framework instances created");
 	}
+	// Set early so backends can read the settings while they're initialised
+	Framework::instance = this;
 
 	PHYSFS_init(programName.c_str());
 #ifdef ANDROID
@@ -194,6 +219,7 @@ Framework::Framework(const UString programName, const std::vector<UString> cmdli
 	}
 	LogInfo("Loading config\n");
 	p->quitProgram = false;
+	p->metricsOverlay.reset(new MetricsOverlay());
 	UString settingsPath(PHYSFS_getPrefDir(PROGRAM_ORGANISATION, PROGRAM_NAME));
 	settingsPath += "/settings.cfg";
 	Settings.reset(new ConfigFile(settingsPath, defaultConfig));
@@ -214,6 +240,37 @@ Framework::Framework(const UString programName, const std::vector<UString> cmdli
 		}
 	}
 
+	auto logLevel = Settings->getString("Framework.LogLevel");
+	if (logLevel == "Warning")
+		setLogLevel(LogLevel::Warning);
+	else if (logLevel == "Error")
+		setLogLevel(LogLevel::Error);
+	else if (logLevel != "Info")
+		LogWarning("Unknown log level \"%s\" - using Info", logLevel.c_str());
+
+	p->frame = 0;
+	p->randomSeed = std::random_device{}();
+	auto replayPath = Settings->getString("Framework.InputReplay");
+	auto recordPath = Settings->getString("Framework.InputRecord");
+	// Only for this run, otherwise they'd be saved and every later run would replay or record
+	Settings->set("Framework.InputReplay", UString(""));
+	Settings->set("Framework.InputRecord", UString(""));
+	if (replayPath != "")
+	{
+		// Recordings go in the write directory, which isn't set up until Data is, so find the
+		// replay there the same way as settings.cfg
+		UString fullReplayPath(PHYSFS_getPrefDir(PROGRAM_ORGANISATION, PROGRAM_NAME));
+		fullReplayPath += "/" + replayPath;
+		p->inputReplay.reset(new InputReplay(fullReplayPath));
+		if (p->inputReplay->isLoaded())
+		{
+			p->randomSeed = p->inputReplay->getSeed();
+			p->inputReplay->applySettings(*Settings);
+		}
+		else
+			p->inputReplay.reset();
+	}
+
 	// This is always set, the default being an empty string (which correctly chooses 'system
 	// langauge')
 	auto desiredLanguageName = Settings->getString("Language");
@@ -244,6 +301,7 @@ Framework::Framework(const UString programName, const std::vector<UString> cmdli
 
 	std::locale loc = gen(desiredLanguageName.str());
 	std::locale::global(loc);
+	clearTranslationCache();
 
 	auto localeName = std::use_facet<boost::locale::info>(loc).name();
 	auto localeLang = std::use_facet<boost::locale::info>(loc).language();
@@ -278,7 +336,15 @@ Framework::Framework(const UString programName, const std::vector<UString> cmdli
 
 	this->threadPool.reset(new ThreadPool(threadPoolSize));
 
-	this->data.reset(new Data(resourcePaths));
+	int cacheSizeMB = Settings->getInt("Resource.CacheSizeMB");
+	if (cacheSizeMB < 0)
+	{
+		LogWarning("Invalid resource cache size %d, disabling cache", cacheSizeMB);
+		cacheSizeMB = 0;
+	}
+	this->data.reset(new Data(resourcePaths, static_cast<size_t>(cacheSizeMB) * 1024 * 1024));
+	if (Settings->getBool("Resource.DiskCache"))
+		this->data->enableDiskCache(Settings->getString("Resource.DiskCacheDir"));
 
 	auto testFile = this->data->fs.open("MUSIC");
 	if (!testFile)
@@ -293,12 +359,16 @@ Framework::Framework(const UString programName, const std::vector<UString> cmdli
 		LogError("Succeded in opening \"FileDoesntExist\" - either you have the weirdest filename "
 		         "preferences or something is wrong");
 	}
-	srand(static_cast<unsigned int>(SDL_GetTicks()));
+	if (recordPath != "" && !p->inputReplay)
+	{
+		p->inputRecorder.reset(new InputRecorder(recordPath, p->randomSeed, *Settings));
+		if (!p->inputRecorder->isOpen())
+			p->inputRecorder.reset();
+	}
+	srand(p->randomSeed);
 
 	Display_Initialise();
 	Audio_Initialise();
-
-	Framework::instance = this;
 }
 
 Framework::~Framework()
@@ -309,6 +379,12 @@ Framework::~Framework()
 	// backends are de-inited
 	gamecore.reset();
 	p->ProgramStages.Clear();
+	p->metricsOverlay.reset();
+	if (Settings->getBool("Framework.MetricsOnExit"))
+		Metrics::writeCSV(Settings->getString("Framework.MetricsCSV"));
+	// A replay's settings came from whoever recorded it, so shouldn't replace the user's
+	if (p->inputReplay)
+		p->inputReplay->restoreSettings(*Settings);
 	LogInfo("Saving config");
 	SaveSettings();
 
@@ -319,6 +395,7 @@ Framework::~Framework()
 	PHYSFS_deinit();
 	SDL_Quit();
 	Framework::instance = nullptr;
+	flushLog();
 }
 
 Framework &Framework::getInstance()
@@ -332,8 +409,8 @@ Framework &Framework::getInstance()
 
 void Framework::Run()
 {
-	int frame = 0;
 	TRACE_FN;
+	auto &frameTime = Metrics::histogram("Frame.TimeMs");
 	LogInfo("Program loop started");
 
 	p->ProgramStages.Push(mksp<BootUp>());
@@ -342,8 +419,16 @@ void Framework::Run()
 
 	while (!p->quitProgram)
 	{
-		frame++;
-		TraceObj obj{"Frame", {{"frame", Strings::FromInteger(frame)}}};
+		p->frame++;
+		if (p->inputReplay && p->inputReplay->isFinished(p->frame))
+		{
+			LogInfo("Input replay finished after %llu frames",
+			        static_cast<unsigned long long>(p->frame - 1));
+			ShutdownFramework();
+			break;
+		}
+		TraceObj obj{"Frame", {{"frame", Strings::FromInteger(static_cast<int>(p->frame))}}};
+		MetricTimer frameTimer(frameTime);
 
 		ProcessEvents();
 
@@ -356,6 +441,8 @@ void Framework::Run()
 			TraceObj updateObj("Update");
 			p->ProgramStages.Current()->Update(&cmd);
 		}
+		if (this->soundBackend)
+			this->soundBackend->advanceFrame();
 		switch (cmd.cmd)
 		{
 			case StageCmd::Command::CONTINUE:
@@ -392,6 +479,12 @@ void Framework::Run()
 				this->renderer->clear();
 				this->renderer->drawScaled(p->scaleSurface, {0, 0}, p->windowSize);
 			}
+			if (p->metricsOverlay->isVisible())
+			{
+				// Drawn at window resolution so it stays readable when scaling
+				RendererSurfaceBinding overlayBind(*this->renderer, p->defaultSurface);
+				p->metricsOverlay->render();
+			}
 			{
 				TraceObj flipObj("Flip");
 #ifndef OPENAPOC_GLES
@@ -419,6 +512,10 @@ void Framework::ProcessEvents()
 
 	// TODO: Consider threading the translation
 	TranslateSDLEvents();
+	if (p->inputReplay)
+		p->inputReplay->replay(p->frame, p->eventQueue);
+	else if (p->inputRecorder)
+		p->inputRecorder->record(p->frame, p->eventQueue);
 
 	while (p->eventQueue.size() > 0 && !p->ProgramStages.IsEmpty())
 	{
@@ -436,6 +533,20 @@ void Framework::ProcessEvents()
 				delete e;
 				ShutdownFramework();
 				return;
+			case EVENT_KEY_DOWN:
+				// Debug hotkeys work in every stage, so don't pass them on
+				if (e->Keyboard().KeyCode == SDLK_F3)
+				{
+					p->metricsOverlay->toggle();
+					break;
+				}
+				if (e->Keyboard().KeyCode == SDLK_F4)
+				{
+					Metrics::writeCSV(Settings->getString("Framework.MetricsCSV"));
+					break;
+				}
+				p->ProgramStages.Current()->EventOccurred(e);
+				break;
 			default:
 				p->ProgramStages.Current()->EventOccurred(e);
 				break;
@@ -629,6 +740,12 @@ void Framework::TranslateSDLEvents()
 	}
 }
 
+unsigned int Framework::getRandomSeed() const { return p->randomSeed; }
+
+bool Framework::isInputFrameLocked() const { return p->inputRecorder || p->inputReplay; }
+
+MetricsOverlay &Framework::getMetricsOverlay() { return *p->metricsOverlay; }
+
 void Framework::ShutdownFramework()
 {
 	LogInfo("Shutdown framework");
@@ -738,7 +855,8 @@ void Framework::Display_Initialise()
 	SDL_GL_GetAttribute(SDL_GL_BLUE_SIZE, &bitsBlue);
 	SDL_GL_GetAttribute(SDL_GL_ALPHA_SIZE, &bitsAlpha);
 	LogInfo("  RGBA bits: %d-%d-%d-%d", bitsRed, bitsGreen, bitsBlue, bitsAlpha);
-	SDL_GL_SetSwapInterval(1);
+	// Replays are for measuring, so run them as fast as possible
+	SDL_GL_SetSwapInterval(p->inputReplay ? 0 : 1);
 	SDL_GL_MakeCurrent(p->window, p->context); // for good measure?
 	SDL_ShowCursor(SDL_DISABLE);
 
@@ -875,6 +993,7 @@ void Framework::Audio_Initialise()
 	this->soundBackend->setGain(SoundBackend::Gain::Sample,
 	                            static_cast<float>(this->Settings->getInt("Audio.SampleGain")) /
 	                                20.0f);
+	this->soundBackend->setMaxVoices(std::max(1, this->Settings->getInt("Audio.MaxVoices")));
 }
 
 void Framework::Audio_Shutdown()
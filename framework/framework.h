@@ -28,6 +28,7 @@ namespace OpenApoc
 
 class Shader;
 class GameCore;
+class MetricsOverlay;
 
 #define FRAMES_PER_SECOND 100
 
@@ -66,6 +67,15 @@ class Framework
 	void ShutdownFramework();
 	bool IsShuttingDown();
 
+	// Seeds all game randomness, taken from the input recording when replaying one
+	unsigned int getRandomSeed() const;
+	// True when input is being recorded or replayed. Events are matched up by frame number then, so
+	// anything that would take however many frames it takes (like waiting on a background load)
+	// has to finish in a fixed number of frames instead.
+	bool isInputFrameLocked() const;
+	// Toggled with F3 over any stage
+	MetricsOverlay &getMetricsOverlay();
+
 	void SaveSettings();
 
 	void Display_Initialise();
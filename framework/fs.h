@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 
 #include "library/strings.h"
 #include "library/sp.h"
@@ -17,6 +18,105 @@ class IFileImpl
 	virtual ~IFileImpl();
 };
 
+// A read-only view of the whole contents of a file. Files in real directories are mmap()ed where
+// supported, anything else (e.g. members of an iso image) is read into a single buffer.
+class IFileView
+{
+  private:
+	friend class IFile;
+	const uint8_t *ptr;
+	size_t len;
+	std::unique_ptr<uint8_t[]> buffer;
+	void *mapping;
+	IFileView(const IFileView &) = delete;
+
+  public:
+	IFileView();
+	IFileView(IFileView &&other);
+	IFileView &operator=(IFileView &&other);
+	~IFileView();
+	const uint8_t *data() const { return ptr; }
+	size_t size() const { return len; }
+	explicit operator bool() const { return ptr != nullptr; }
+};
+
+// Little-endian typed reads from a byte span. Reading past the end returns false and leaves the
+// cursor in the failed state (and the out value untouched) until the next seek()
+class IFileCursor
+{
+  private:
+	const uint8_t *start;
+	size_t len;
+	size_t pos;
+	bool good;
+
+	bool check(size_t count)
+	{
+		if (!good || count > len - pos)
+			good = false;
+		return good;
+	}
+
+  public:
+	IFileCursor(const uint8_t *data, size_t size) : start(data), len(size), pos(0), good(true) {}
+	IFileCursor(const IFileView &view) : IFileCursor(view.data(), view.size()) {}
+
+	bool readu8(uint8_t &val)
+	{
+		if (!check(1))
+			return false;
+		val = start[pos++];
+		return true;
+	}
+	bool readule16(uint16_t &val)
+	{
+		if (!check(2))
+			return false;
+		val = static_cast<uint16_t>(start[pos] | (start[pos + 1] << 8));
+		pos += 2;
+		return true;
+	}
+	bool readule32(uint32_t &val)
+	{
+		if (!check(4))
+			return false;
+		val = static_cast<uint32_t>(start[pos]) | (static_cast<uint32_t>(start[pos + 1]) << 8) |
+		      (static_cast<uint32_t>(start[pos + 2]) << 16) |
+		      (static_cast<uint32_t>(start[pos + 3]) << 24);
+		pos += 4;
+		return true;
+	}
+	bool read(void *dst, size_t count)
+	{
+		if (!check(count))
+			return false;
+		memcpy(dst, start + pos, count);
+		pos += count;
+		return true;
+	}
+	// Returns a pointer to the next 'count' bytes without copying them, or nullptr on EOF
+	const uint8_t *readSpan(size_t count)
+	{
+		if (!check(count))
+			return nullptr;
+		const uint8_t *span = start + pos;
+		pos += count;
+		return span;
+	}
+	bool skip(size_t count) { return readSpan(count) != nullptr; }
+	bool seek(size_t offset)
+	{
+		good = offset <= len;
+		if (good)
+			pos = offset;
+		return good;
+	}
+	size_t tell() const { return pos; }
+	size_t size() const { return len; }
+	size_t remaining() const { return len - pos; }
+	explicit operator bool() const { return good; }
+};
+
 class IFile : public std::istream
 {
   private:
@@ -28,6 +128,8 @@ class IFile : public std::istream
 	~IFile();
 	size_t size() const;
 	std::unique_ptr<char[]> readAll();
+	// Map the whole file for direct access, doesn't change the stream offset
+	IFileView map();
 	bool readule16(uint16_t &val);
 	bool readule32(uint32_t &val);
 	const UString &fileName() const;
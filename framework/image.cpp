@@ -32,10 +32,15 @@ Surface::Surface(Vec2<unsigned int> size) : Image(size) {}
 Surface::~Surface() {}
 
 PaletteImage::PaletteImage(Vec2<unsigned int> size, uint8_t initialIndex)
-    : Image(size), indices(new uint8_t[size.x * size.y])
+    : Image(size), storage(mksp<std::vector<uint8_t>>(size.x * size.y, initialIndex)),
+      indices(storage->data())
 {
-	for (unsigned int i = 0; i < size.x * size.y; i++)
-		this->indices[i] = initialIndex;
+}
+
+PaletteImage::PaletteImage(Vec2<unsigned int> size, sp<std::vector<uint8_t>> arena, size_t offset)
+    : Image(size), storage(arena), indices(storage->data() + offset)
+{
+	assert(offset + size.x * size.y <= storage->size());
 }
 
 PaletteImage::~PaletteImage() {}
@@ -57,6 +62,16 @@ sp<RGBImage> PaletteImage::toRGBImage(sp<Palette> p)
 	return i;
 }
 
+sp<PaletteImage> PaletteImage::withPalette(sp<Palette> p)
+{
+	auto img = mksp<PaletteImage>(size, storage, indices - storage->data());
+	img->palette = p;
+	img->bounds = bounds;
+	img->owningSet = owningSet;
+	img->indexInSet = indexInSet;
+	return img;
+}
+
 void PaletteImage::blit(sp<PaletteImage> src, Vec2<unsigned int> offset, sp<PaletteImage> dst)
 {
 	PaletteImageLock reader(src, ImageLockUse::Read);
@@ -216,7 +231,7 @@ void PaletteImageLock::set(Vec2<unsigned int> pos, uint8_t idx)
 	this->img->indices[offset] = idx;
 }
 
-void *PaletteImageLock::getData() { return this->img->indices.get(); }
+void *PaletteImageLock::getData() { return this->img->indices; }
 
 void PaletteImage::CalculateBounds()
 {
@@ -49,12 +49,24 @@ class PaletteImage : public Image
 {
   private:
 	friend class PaletteImageLock;
-	std::unique_ptr<uint8_t[]> indices;
+	// The index storage may be shared with other images (e.g. all images in a decoded PCK live in
+	// one contiguous arena), 'indices' points to the start of this image's pixels within it
+	sp<std::vector<uint8_t>> storage;
+	uint8_t *indices;
 
   public:
 	PaletteImage(Vec2<unsigned int> size, uint8_t initialIndex = 0);
+	// Create an image using size.x*size.y bytes starting at 'offset' within 'arena' as its index
+	// data. The arena must not be resized after any images referencing it have been created.
+	PaletteImage(Vec2<unsigned int> size, sp<std::vector<uint8_t>> arena, size_t offset);
 	~PaletteImage();
 	sp<RGBImage> toRGBImage(sp<Palette> p);
+	// A copy that shares this image's pixels (and its place in its set, so it can still be
+	// batched) but is always drawn with 'p'
+	sp<PaletteImage> withPalette(sp<Palette> p);
+
+	// If set the renderer draws this image with it instead of the current palette
+	sp<Palette> palette;
 	static void blit(sp<PaletteImage> src, Vec2<unsigned int> offset, sp<PaletteImage> dst);
 
 	void CalculateBounds();
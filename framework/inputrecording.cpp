@@ -0,0 +1,288 @@
+#include "framework/inputrecording.h"
+#include "framework/event.h"
+#include "framework/logger.h"
+#include "library/configfile.h"
+
+#include <physfs.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+// Settings that change how the game plays or how input maps onto the screen
+const char *recordedSettings[] = {
+    "Visual.ScreenWidth", "Visual.ScreenHeight", "Visual.ScaleX",
+    "Visual.ScaleY",      "GameRules",           "Language",
+};
+
+enum class InputKind
+{
+	None,
+	Key,
+	Mouse,
+	Finger,
+	Display,
+};
+
+InputKind getInputKind(EventTypes type)
+{
+	switch (type)
+	{
+		case EVENT_KEY_DOWN:
+		case EVENT_KEY_PRESS:
+		case EVENT_KEY_UP:
+			return InputKind::Key;
+		case EVENT_MOUSE_DOWN:
+		case EVENT_MOUSE_UP:
+		case EVENT_MOUSE_MOVE:
+			return InputKind::Mouse;
+		case EVENT_FINGER_DOWN:
+		case EVENT_FINGER_UP:
+		case EVENT_FINGER_MOVE:
+			return InputKind::Finger;
+		case EVENT_WINDOW_ACTIVATE:
+		case EVENT_WINDOW_DEACTIVATE:
+		case EVENT_WINDOW_RESIZE:
+		case EVENT_WINDOW_CLOSED:
+			return InputKind::Display;
+		default:
+			// Timer, form and user events are raised by the game itself, so replaying the input
+			// raises them again
+			return InputKind::None;
+	}
+}
+
+} // anonymous namespace
+
+InputRecorder::InputRecorder(const UString &path, unsigned int seed, ConfigFile &settings)
+    : file(PHYSFS_openWrite(path.c_str())), lastFrame(0)
+{
+	if (!file)
+	{
+		LogError("Failed to open \"%s\" to record input: %s", path.c_str(),
+		         PHYSFS_getLastError());
+		return;
+	}
+	LogInfo("Recording input to \"%s\"", path.c_str());
+	std::ostringstream header;
+	header << "# OpenApoc input recording\n";
+	header << "seed " << seed << "\n";
+	for (auto *key : recordedSettings)
+		header << "setting " << key << "=" << settings.getString(key).str() << "\n";
+	this->write(header.str());
+}
+
+InputRecorder::~InputRecorder()
+{
+	if (!file)
+		return;
+	std::ostringstream end;
+	end << "end " << lastFrame << "\n";
+	this->write(end.str());
+	PHYSFS_close(file);
+}
+
+void InputRecorder::write(const std::string &text)
+{
+	if (PHYSFS_writeBytes(file, text.data(), text.size()) !=
+	    static_cast<PHYSFS_sint64>(text.size()))
+		LogError("Failed to write input recording: %s", PHYSFS_getLastError());
+}
+
+void InputRecorder::record(uint64_t frame, const std::list<Event *> &events)
+{
+	if (!file)
+		return;
+	this->lastFrame = frame;
+	std::ostringstream lines;
+	for (auto *e : events)
+	{
+		int type = static_cast<int>(e->Type());
+		switch (getInputKind(e->Type()))
+		{
+			case InputKind::None:
+				break;
+			case InputKind::Key:
+			{
+				auto &k = e->Keyboard();
+				lines << frame << " key " << type << " " << k.KeyCode << " " << k.UniChar << " "
+				      << k.Modifiers << "\n";
+				break;
+			}
+			case InputKind::Mouse:
+			{
+				auto &m = e->Mouse();
+				lines << frame << " mouse " << type << " " << m.X << " " << m.Y << " " << m.DeltaX
+				      << " " << m.DeltaY << " " << m.WheelVertical << " " << m.WheelHorizontal
+				      << " " << m.Button << "\n";
+				break;
+			}
+			case InputKind::Finger:
+			{
+				auto &f = e->Finger();
+				lines << frame << " finger " << type << " " << f.X << " " << f.Y << " " << f.DeltaX
+				      << " " << f.DeltaY << " " << f.Id << " " << f.IsPrimary << "\n";
+				break;
+			}
+			case InputKind::Display:
+			{
+				auto &d = e->Display();
+				lines << frame << " display " << type << " " << d.Active << " " << d.X << " "
+				      << d.Y << " " << d.Width << " " << d.Height << "\n";
+				break;
+			}
+		}
+	}
+	if (!lines.str().empty())
+		this->write(lines.str());
+}
+
+InputReplay::InputReplay(const UString &path) : seed(0), endFrame(0), loaded(false)
+{
+	std::ifstream inFile{path.c_str(), std::ios::in};
+	if (!inFile)
+	{
+		LogError("Failed to open input recording \"%s\"", path.c_str());
+		return;
+	}
+	bool sawEnd = false;
+	int lineNo = 0;
+	std::string line;
+	while (std::getline(inFile, line))
+	{
+		lineNo++;
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream in{line};
+		std::string first;
+		in >> first;
+		if (first == "seed")
+		{
+			in >> this->seed;
+		}
+		else if (first == "setting")
+		{
+			auto splitPos = line.find_first_of('=');
+			if (splitPos == line.npos)
+			{
+				LogError("Invalid setting in \"%s\" line %d", path.c_str(), lineNo);
+				continue;
+			}
+			// Skip "setting "
+			this->settings.emplace_back(line.substr(8, splitPos - 8), line.substr(splitPos + 1));
+		}
+		else if (first == "end")
+		{
+			in >> this->endFrame;
+			sawEnd = true;
+		}
+		else
+		{
+			char *frameEnd;
+			uint64_t frame = std::strtoull(first.c_str(), &frameEnd, 10);
+			if (first.empty() || *frameEnd != '\0')
+			{
+				LogError("Unknown line in \"%s\" line %d", path.c_str(), lineNo);
+				continue;
+			}
+			std::string kind;
+			int type;
+			in >> kind >> type;
+			auto eventType = static_cast<EventTypes>(type);
+			Event *e = nullptr;
+			if (kind == "key" && getInputKind(eventType) == InputKind::Key)
+			{
+				e = new KeyboardEvent(eventType);
+				auto &k = e->Keyboard();
+				in >> k.KeyCode >> k.UniChar >> k.Modifiers;
+			}
+			else if (kind == "mouse" && getInputKind(eventType) == InputKind::Mouse)
+			{
+				e = new MouseEvent(eventType);
+				auto &m = e->Mouse();
+				in >> m.X >> m.Y >> m.DeltaX >> m.DeltaY >> m.WheelVertical >> m.WheelHorizontal >>
+				    m.Button;
+			}
+			else if (kind == "finger" && getInputKind(eventType) == InputKind::Finger)
+			{
+				e = new FingerEvent(eventType);
+				auto &f = e->Finger();
+				in >> f.X >> f.Y >> f.DeltaX >> f.DeltaY >> f.Id >> f.IsPrimary;
+			}
+			else if (kind == "display" && getInputKind(eventType) == InputKind::Display)
+			{
+				e = new DisplayEvent(eventType);
+				auto &d = e->Display();
+				in >> d.Active >> d.X >> d.Y >> d.Width >> d.Height;
+			}
+			if (!e || !in)
+			{
+				LogError("Invalid event in \"%s\" line %d", path.c_str(), lineNo);
+				delete e;
+				continue;
+			}
+			this->events.emplace_back(frame, e);
+			this->endFrame = std::max(this->endFrame, frame);
+		}
+	}
+	if (!sawEnd)
+		LogWarning("Input recording \"%s\" has no end, it may be truncated", path.c_str());
+	LogInfo("Loaded %u input events over %llu frames from \"%s\"",
+	        static_cast<unsigned>(this->events.size()),
+	        static_cast<unsigned long long>(this->endFrame), path.c_str());
+	this->loaded = true;
+}
+
+InputReplay::~InputReplay()
+{
+	for (auto &pair : this->events)
+		delete pair.second;
+}
+
+void InputReplay::applySettings(ConfigFile &config)
+{
+	this->previousSettings.clear();
+	for (auto &setting : this->settings)
+	{
+		this->previousSettings.emplace_back(setting.first, config.getString(setting.first));
+		LogInfo("Setting option \"%s\" to \"%s\" from input recording", setting.first.c_str(),
+		        setting.second.c_str());
+		config.set(setting.first, setting.second);
+	}
+}
+
+void InputReplay::restoreSettings(ConfigFile &config) const
+{
+	for (auto &setting : this->previousSettings)
+		config.set(setting.first, setting.second);
+}
+
+void InputReplay::replay(uint64_t frame, std::list<Event *> &queue)
+{
+	for (auto it = queue.begin(); it != queue.end();)
+	{
+		// Still let the window be closed
+		auto type = (*it)->Type();
+		if (type != EVENT_WINDOW_CLOSED && getInputKind(type) != InputKind::None)
+		{
+			delete *it;
+			it = queue.erase(it);
+		}
+		else
+			it++;
+	}
+	while (!this->events.empty() && this->events.front().first <= frame)
+	{
+		queue.push_back(this->events.front().second);
+		this->events.pop_front();
+	}
+}
+
+} // namespace OpenApoc
@@ -0,0 +1,73 @@
+#pragma once
+#include "library/sp.h"
+#include "library/strings.h"
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <utility>
+#include <vector>
+
+struct PHYSFS_File;
+
+namespace OpenApoc
+{
+
+class Event;
+class ConfigFile;
+
+// Recordings are text, one line per event tagged with the frame it arrived in, after a header with
+// the random seed and the settings that change how the game plays or is laid out
+
+// Writes every input event the framework translates to a file so the session can be played back
+// with InputReplay. 'path' is in the PhysFS write directory.
+class InputRecorder
+{
+  private:
+	PHYSFS_File *file;
+	uint64_t lastFrame;
+
+	void write(const std::string &text);
+
+  public:
+	InputRecorder(const UString &path, unsigned int seed, ConfigFile &settings);
+	~InputRecorder();
+
+	bool isOpen() const { return file != nullptr; }
+	// Record the input events in 'events', which arrived in 'frame'
+	void record(uint64_t frame, const std::list<Event *> &events);
+};
+
+// Plays back a recording made by InputRecorder. Game time only advances by a fixed amount each
+// frame, so as long as the seed and settings match, every frame sees the same input and the game
+// follows the same path however long each frame takes.
+class InputReplay
+{
+  private:
+	unsigned int seed;
+	std::vector<std::pair<UString, UString>> settings;
+	// What applySettings() replaced, so the user's own settings aren't saved over
+	std::vector<std::pair<UString, UString>> previousSettings;
+	// Owned, in frame order
+	std::deque<std::pair<uint64_t, Event *>> events;
+	uint64_t endFrame;
+	bool loaded;
+
+  public:
+	InputReplay(const UString &path);
+	~InputReplay();
+
+	bool isLoaded() const { return loaded; }
+	unsigned int getSeed() const { return seed; }
+	// Overrides 'config' with the settings the recording was made with
+	void applySettings(ConfigFile &config);
+	// Puts back the settings applySettings() overrode
+	void restoreSettings(ConfigFile &config) const;
+	const std::vector<std::pair<UString, UString>> &getSettings() const { return settings; }
+	// Replaces the live input events in 'queue' with the ones recorded for 'frame'
+	void replay(uint64_t frame, std::list<Event *> &queue);
+	// True once every frame in the recording has been played
+	bool isFinished(uint64_t frame) const { return frame > endFrame; }
+};
+
+} // namespace OpenApoc
@@ -3,9 +3,16 @@
 #endif
 
 #include "framework/logger.h"
+#include "library/sp.h"
+#include <algorithm>
+#include <condition_variable>
 #include <cstdarg>
+#include <cstdio>
 #include <mutex>
 #include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
 #ifdef BACKTRACE_LIBUNWIND
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE
@@ -148,128 +155,434 @@ static void print_backtrace(FILE *f)
 }
 #endif
 
-static FILE *outFile = nullptr;
+std::atomic<int> logRuntimeLevel(0);
 
-static std::mutex logMutex;
-static std::chrono::time_point<std::chrono::high_resolution_clock> timeInit =
-    std::chrono::high_resolution_clock::now();
+namespace
+{
+
+// Errors are always logged, Info and Warning messages are limited to this many a second from any
+// single call site
+const unsigned int MaxMessagesPerSitePerSecond = 20;
+// Per-thread queue length, if the writer falls this far behind messages are dropped (and counted)
+// rather than blocking the logging thread
+const size_t ThreadQueueSize = 1024;
+const auto WriterInterval = std::chrono::milliseconds(20);
+
+const std::chrono::time_point<std::chrono::steady_clock> timeInit =
+    std::chrono::steady_clock::now();
+
+uint64_t logClockNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+	                                                            timeInit)
+	    .count();
+}
+
+class LogRecord
+{
+  public:
+	const LogSite *site = nullptr;
+	uint64_t clockns = 0;
+	unsigned int suppressed = 0;
+	std::string message;
+};
+
+// Written only by the owning thread and read only by whoever holds the writer's output lock
+class ThreadLogQueue
+{
+  private:
+	std::vector<LogRecord> records;
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+
+  public:
+	// Set when the owning thread exits, the queue is removed once it's been drained
+	std::atomic<bool> orphaned;
+
+	ThreadLogQueue() : records(ThreadQueueSize), head(0), tail(0), orphaned(false) {}
+
+	bool push(LogRecord &record)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == records.size())
+			return false;
+		records[t % records.size()] = std::move(record);
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(LogRecord &record)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+		record = std::move(records[h % records.size()]);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const
+	{
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+};
+
+const char *levelPrefix(LogLevel level)
+{
+	switch (level)
+	{
+		case LogLevel::Info:
+			return "I";
+		case LogLevel::Warning:
+			return "W";
+		default:
+			return "E";
+	}
+}
 
-void Log(LogLevel level, UString prefix, UString format, ...)
+#if defined(ERROR_DIALOG)
+// Returns true if the user asked to exit
+bool showErrorDialog(const char *message)
 {
-	bool exit_app = false;
-	const char *level_prefix;
-	auto timeNow = std::chrono::high_resolution_clock::now();
-	unsigned long long clockns =
-	    std::chrono::duration<unsigned long long, std::nano>(timeNow - timeInit).count();
-
-	logMutex.lock();
-	if (!outFile)
+	SDL_MessageBoxData mBoxData;
+	mBoxData.flags = SDL_MESSAGEBOX_ERROR;
+	mBoxData.window = NULL; // Might happen before we get our window?
+	mBoxData.title = "OpenApoc ERROR";
+	mBoxData.message = message;
+	mBoxData.numbuttons = 2;
+	SDL_MessageBoxButtonData buttons[2];
+	buttons[0].flags = SDL_MESSAGEBOX_BUTTON_RETURNKEY_DEFAULT;
+	buttons[0].buttonid = 1;
+	buttons[0].text = "Exit";
+	buttons[1].flags = SDL_MESSAGEBOX_BUTTON_ESCAPEKEY_DEFAULT;
+	buttons[1].buttonid = 2;
+	buttons[1].text = "try to limp along";
+	mBoxData.buttons = buttons;
+	mBoxData.colorScheme = NULL; // Use system settings
+
+	int but;
+	SDL_ShowMessageBox(&mBoxData, &but);
+
+	/* button 1 = "exit", button 2 = "try to limp along" */
+	return but == 1;
+}
+#endif
+
+// Owns the log file and the background thread that drains every thread's queue into it. Logging
+// threads only format their message and push it onto their own queue, the only lock they ever
+// take is when a thread logs for the first time (to register its queue) or logs an Error.
+class LogWriter
+{
+  private:
+	FILE *outFile;
+	// Protects outFile and the consumer side of every queue
+	std::mutex outputMutex;
+	// Protects the queue list itself
+	std::mutex queuesMutex;
+	std::vector<sp<ThreadLogQueue>> queues;
+
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	bool shutdown;
+	std::thread thread;
+
+	std::atomic<uint64_t> droppedMessages;
+	std::vector<LogRecord> pending;
+
+	void openLog()
 	{
 #ifdef UNIT_TEST
 		outFile = stderr;
 #else
-		#ifndef ANDROID
+#ifndef ANDROID
 		outFile = fopen(LOG_PATH LOGFILE, "w");
 		if (!outFile)
 		{
 			// No log file, have to hope stderr goes somewhere useful
 			fprintf(stderr, "Failed to open logfile \"%s\"\n", LOGFILE);
 			LOGE("Failed to open logfile \"%s\"\n", LOGFILE);
-			return;
+			outFile = stderr;
 		}
-		#endif
+#else
+		outFile = stderr;
+#endif
 #endif
 	}
 
-	switch (level)
+	void writeRecord(const LogRecord &record)
 	{
-		case LogLevel::Info:
-			level_prefix = "I";
-			break;
-		case LogLevel::Warning:
-			level_prefix = "W";
-			break;
-		default:
-			level_prefix = "E";
-			break;
-	}
-
-	va_list arglist;
-	va_start(arglist, format);
+		const char *level = levelPrefix(record.site->level);
+		unsigned long long clockns = record.clockns;
+		if (record.suppressed)
+		{
 #ifdef ANDROID
-	LOGD("%s %llu %s: ", level_prefix, clockns, prefix.c_str());
-	LOGDV(format.c_str(), arglist);
-	va_end(arglist);
+			LOGD("%s %llu %s: (%u similar messages suppressed)", level, clockns,
+			     record.site->function, record.suppressed);
 #else
-	fprintf(outFile, "%s %llu %s: ", level_prefix, clockns, prefix.c_str());
-	vfprintf(outFile, format.c_str(), arglist);
-
-	// On error print a backtrace to the log file
-	if (level == LogLevel::Error)
-		print_backtrace(outFile);
-	fprintf(outFile, "\n");
-	va_end(arglist);
+			fprintf(outFile, "%s %llu %s: (%u similar messages suppressed)\n", level, clockns,
+			        record.site->function, record.suppressed);
+#endif
+		}
+#ifdef ANDROID
+		LOGD("%s %llu %s: %s", level, clockns, record.site->function, record.message.c_str());
+#else
+		fprintf(outFile, "%s %llu %s: %s\n", level, clockns, record.site->function,
+		        record.message.c_str());
+		if (record.site->level != LogLevel::Info)
+			fprintf(stderr, "%s %llu %s: %s\n", level, clockns, record.site->function,
+			        record.message.c_str());
+#endif
+	}
 
-	// If it's a warning or error flush the outfile (in case we crash 'soon') and also print to
-	// stderr
-	if (level != LogLevel::Info)
+	// Must be called with outputMutex held
+	void drainLocked()
 	{
+		{
+			std::lock_guard<std::mutex> lock(queuesMutex);
+			for (auto it = queues.begin(); it != queues.end();)
+			{
+				// Check the orphan flag first, so anything pushed before the thread exited is
+				// still picked up below
+				bool orphaned = (*it)->orphaned.load(std::memory_order_acquire);
+				LogRecord record;
+				while ((*it)->pop(record))
+					pending.push_back(std::move(record));
+				if (orphaned)
+					it = queues.erase(it);
+				else
+					++it;
+			}
+		}
+		auto dropped = droppedMessages.exchange(0);
+		if (pending.empty() && !dropped)
+			return;
+		// Each queue is in order, but interleave the threads by time
+		std::stable_sort(pending.begin(), pending.end(),
+		                 [](const LogRecord &a, const LogRecord &b) {
+			                 return a.clockns < b.clockns;
+			             });
+		for (auto &record : pending)
+			writeRecord(record);
+		pending.clear();
+		if (dropped)
+		{
+			fprintf(outFile, "W %llu %s: %llu log messages dropped\n",
+			        static_cast<unsigned long long>(logClockNs()), __func__,
+			        static_cast<unsigned long long>(dropped));
+		}
 		fflush(outFile);
-		va_start(arglist, format);
-		fprintf(stderr, "%s %llu %s: ", level_prefix, clockns, prefix.c_str());
-		vfprintf(stderr, format.c_str(), arglist);
-		fprintf(stderr, "\n");
-		va_end(arglist);
 	}
-#endif
-#if defined(ERROR_DIALOG)
-	if (level == LogLevel::Error)
+
+	void writerLoop()
+	{
+		std::unique_lock<std::mutex> wakeLock(wakeMutex);
+		while (!shutdown)
+		{
+			wakeCondition.wait_for(wakeLock, WriterInterval);
+			wakeLock.unlock();
+			{
+				std::lock_guard<std::mutex> lock(outputMutex);
+				drainLocked();
+			}
+			wakeLock.lock();
+		}
+	}
+
+  public:
+	LogWriter() : outFile(nullptr), shutdown(false), droppedMessages(0)
+	{
+		openLog();
+		thread = std::thread(&LogWriter::writerLoop, this);
+	}
+
+	~LogWriter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			shutdown = true;
+		}
+		wakeCondition.notify_one();
+		thread.join();
+		std::lock_guard<std::mutex> lock(outputMutex);
+		drainLocked();
+		if (outFile != stderr)
+			fclose(outFile);
+	}
+
+	sp<ThreadLogQueue> registerThread()
 	{
-		/* How big should the string be? */
-		va_start(arglist, format);
-		auto strSize = vsnprintf(NULL, 0, format.c_str(), arglist);
-		strSize += 1; // NULL terminator
-		std::unique_ptr<char[]> string(new char[strSize]);
-		va_end(arglist);
-
-		/* Now format the string */
-		va_start(arglist, format);
-		vsnprintf(string.get(), strSize, format.c_str(), arglist);
-		va_end(arglist);
-
-		SDL_MessageBoxData mBoxData;
-		mBoxData.flags = SDL_MESSAGEBOX_ERROR;
-		mBoxData.window = NULL; // Might happen before we get our window?
-		mBoxData.title = "OpenApoc ERROR";
-		mBoxData.message = string.get();
-		mBoxData.numbuttons = 2;
-		SDL_MessageBoxButtonData buttons[2];
-		buttons[0].flags = SDL_MESSAGEBOX_BUTTON_RETURNKEY_DEFAULT;
-		buttons[0].buttonid = 1;
-		buttons[0].text = "Exit";
-		buttons[1].flags = SDL_MESSAGEBOX_BUTTON_ESCAPEKEY_DEFAULT;
-		buttons[1].buttonid = 2;
-		buttons[1].text = "try to limp along";
-		mBoxData.buttons = buttons;
-		mBoxData.colorScheme = NULL; // Use system settings
-
-		int but;
-		SDL_ShowMessageBox(&mBoxData, &but);
-
-		/* button 1 = "exit", button 2 = "try to limp along" */
-		if (but == 1)
+		auto queue = mksp<ThreadLogQueue>();
+		std::lock_guard<std::mutex> lock(queuesMutex);
+		queues.push_back(queue);
+		return queue;
+	}
+
+	void push(ThreadLogQueue &queue, LogRecord &record)
+	{
+		bool urgent = record.site->level != LogLevel::Info;
+		if (!queue.push(record))
 		{
-			exit_app = true;
+			droppedMessages++;
+			urgent = true;
 		}
+		// Warnings are written out promptly in case we crash 'soon', and a queue that's filling up
+		// shouldn't wait for the next interval
+		if (urgent || queue.size() > ThreadQueueSize / 2)
+			wakeCondition.notify_one();
 	}
+
+	void flush()
+	{
+		std::lock_guard<std::mutex> lock(outputMutex);
+		drainLocked();
+	}
+
+	// Errors are written straight away from the calling thread (so the backtrace is of the right
+	// thread), after everything queued before them
+	void writeError(const LogRecord &record)
+	{
+		std::lock_guard<std::mutex> lock(outputMutex);
+		drainLocked();
+		writeRecord(record);
+#ifndef ANDROID
+		// On error print a backtrace to the log file
+		print_backtrace(outFile);
+		fflush(outFile);
 #endif
+	}
+};
+
+// Set once the writer has been destroyed at exit, anything logged after that is written
+// synchronously to stderr. This is trivially destructible so it's still valid then.
+std::atomic<bool> writerDestroyed(false);
+
+class LogWriterHolder
+{
+  public:
+	LogWriter writer;
+	~LogWriterHolder() { writerDestroyed = true; }
+};
+
+LogWriter &getWriter()
+{
+	static LogWriterHolder holder;
+	return holder.writer;
+}
+
+class ThreadLogQueueHandle
+{
+  public:
+	sp<ThreadLogQueue> queue;
+	ThreadLogQueueHandle() : queue(getWriter().registerThread()) {}
+	~ThreadLogQueueHandle() { queue->orphaned.store(true, std::memory_order_release); }
+};
+
+// Returns false if the message should be dropped, and the number of messages suppressed since
+// the last one that got through in 'suppressed'
+bool rateLimit(LogSite &site, uint64_t clockns, unsigned int &suppressed)
+{
+	suppressed = 0;
+	if (site.level == LogLevel::Error)
+		return true;
+	// Races between threads logging from the same site at once can let a message or two extra
+	// through, which doesn't matter
+	uint64_t nowMs = clockns / 1000000;
+	uint64_t windowStart = site.windowStartMs.load(std::memory_order_relaxed);
+	if (nowMs - windowStart >= 1000 &&
+	    site.windowStartMs.compare_exchange_strong(windowStart, nowMs))
+	{
+		site.windowCount = 0;
+		suppressed = site.suppressed.exchange(0);
+	}
+	if (site.windowCount.fetch_add(1, std::memory_order_relaxed) >= MaxMessagesPerSitePerSecond)
+	{
+		site.suppressed++;
+		return false;
+	}
+	return true;
+}
+
+void formatMessage(std::string &message, const char *format, va_list arglist)
+{
+	// Most messages fit in the stack buffer so are only formatted once
+	char buffer[512];
+	va_list copy;
+	va_copy(copy, arglist);
+	int len = vsnprintf(buffer, sizeof(buffer), format, copy);
+	va_end(copy);
+	if (len < 0)
+	{
+		message = format;
+		return;
+	}
+	if (static_cast<size_t>(len) < sizeof(buffer))
+	{
+		message.assign(buffer, len);
+		return;
+	}
+	message.resize(len + 1);
+	vsnprintf(&message[0], len + 1, format, arglist);
+	message.resize(len);
+}
+
+void logMessage(LogSite &site, const char *format, va_list arglist)
+{
+	LogRecord record;
+	record.clockns = logClockNs();
+	if (!rateLimit(site, record.clockns, record.suppressed))
+		return;
+	record.site = &site;
+	formatMessage(record.message, format, arglist);
 
-	logMutex.unlock();
+	if (writerDestroyed)
+	{
+		fprintf(stderr, "%s %llu %s: %s\n", levelPrefix(site.level),
+		        static_cast<unsigned long long>(record.clockns), site.function,
+		        record.message.c_str());
+		return;
+	}
 
-	if (exit_app)
+	auto &writer = getWriter();
+	if (site.level != LogLevel::Error)
+	{
+		thread_local ThreadLogQueueHandle handle;
+		writer.push(*handle.queue, record);
+		return;
+	}
+
+	writer.writeError(record);
+#if defined(ERROR_DIALOG)
+	if (showErrorDialog(record.message.c_str()))
 	{
 		exit(EXIT_FAILURE);
 	}
+#endif
+}
+
+} // anonymous namespace
+
+void setLogLevel(LogLevel level) { logRuntimeLevel = static_cast<int>(level); }
+
+void flushLog()
+{
+	if (!writerDestroyed)
+		getWriter().flush();
+}
+
+void Log(LogSite &site, const char *format, ...)
+{
+	va_list arglist;
+	va_start(arglist, format);
+	logMessage(site, format, arglist);
+	va_end(arglist);
+}
+
+void Log(LogSite &site, UString format, ...)
+{
+	va_list arglist;
+	va_start(arglist, format);
+	logMessage(site, format.c_str(), arglist);
+	va_end(arglist);
 }
 
 }; // namespace OpenApoc
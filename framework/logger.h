@@ -2,6 +2,9 @@
 
 #include "library/strings.h"
 
+#include <atomic>
+#include <cstdint>
+
 #if defined(_MSC_VER) && _MSC_VER > 1400
 #include <sal.h>
 #endif
@@ -9,6 +12,11 @@
 /* The logger is global state as we want it to be available even if the framework hasn't been
  * successfully initialised */
 
+/* Log calls below this level are compiled out entirely (0 = Info, 1 = Warning, 2 = Error) */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
 namespace OpenApoc
 {
 /* MSVC doesn't ahve __PRETTY_FUNCTION__ but __FUNCSIG__? */
@@ -25,30 +33,57 @@ enum class LogLevel
 	Warning,
 	Error,
 };
+
+// One of these is created (once) for every LogInfo/LogWarning/LogError call site. The function
+// name is kept as the compiler's own string constant, so it's never copied or converted on the
+// logging thread, and the rate limiting state is per-site so one noisy call can't drown out the
+// rest of the log.
+class LogSite
+{
+  public:
+	constexpr LogSite(LogLevel level, const char *function)
+	    : level(level), function(function), windowStartMs(0), windowCount(0), suppressed(0)
+	{
+	}
+	const LogLevel level;
+	const char *const function;
+	std::atomic<uint64_t> windowStartMs;
+	std::atomic<unsigned int> windowCount;
+	// Messages dropped by the rate limit since the last one that got through
+	std::atomic<unsigned int> suppressed;
+};
+
+extern std::atomic<int> logRuntimeLevel;
+
+static inline bool logLevelEnabled(LogLevel level)
+{
+	return static_cast<int>(level) >= LOG_MIN_LEVEL &&
+	       static_cast<int>(level) >= logRuntimeLevel.load(std::memory_order_relaxed);
+}
+
+// Drop messages below 'level' at runtime, anything below LOG_MIN_LEVEL is already compiled out
+void setLogLevel(LogLevel level);
+// Write out everything queued so far, Errors always do this before they're logged
+void flushLog();
+
 // All format strings (%s) are expected to be UTF8
-void Log(LogLevel level, UString prefix, UString format, ...);
+void Log(LogSite &site, const char *format, ...);
+void Log(LogSite &site, UString format, ...);
 // All logger output will be UTF8
 }; // namespace OpenApoc
 
-//#ifndef __ANDROID__
-#if defined(__GNUC__)
-// GCC has an extension if __VA_ARGS__ are not supplied to 'remove' the precending comma
-#define LogInfo(f, ...)                                                                            \
-	OpenApoc::Log(OpenApoc::LogLevel::Info, OpenApoc::UString(LOGGER_PREFIX), f, ##__VA_ARGS__)
-#define LogWarning(f, ...)                                                                         \
-	OpenApoc::Log(OpenApoc::LogLevel::Warning, OpenApoc::UString(LOGGER_PREFIX), f, ##__VA_ARGS__)
-#define LogError(f, ...)                                                                           \
-	OpenApoc::Log(OpenApoc::LogLevel::Error, OpenApoc::UString(LOGGER_PREFIX), f, ##__VA_ARGS__)
-#else
-// At least msvc automatically removes the comma
-#define LogInfo(f, ...) OpenApoc::Log(OpenApoc::LogLevel::Info, LOGGER_PREFIX, f, __VA_ARGS__)
-#define LogWarning(f, ...) OpenApoc::Log(OpenApoc::LogLevel::Warning, LOGGER_PREFIX, f, __VA_ARGS__)
-#define LogError(f, ...) OpenApoc::Log(OpenApoc::LogLevel::Error, LOGGER_PREFIX, f, __VA_ARGS__)
-#endif
-//#else
-#if 0
-#define LogInfo(f, ...)
-#define LogWarning(f, ...)
-#define LogError(f, ...)
-#endif
-//#endif
+// The level check is a constant for disabled levels so the whole call (including evaluating the
+// arguments) is removed, and otherwise just a relaxed load before any work is done.
+#define LOG_AT_LEVEL(lvl, ...)                                                                     \
+	do                                                                                             \
+	{                                                                                              \
+		if (OpenApoc::logLevelEnabled(lvl))                                                        \
+		{                                                                                          \
+			static OpenApoc::LogSite logSite_(lvl, LOGGER_PREFIX);                                 \
+			OpenApoc::Log(logSite_, __VA_ARGS__);                                                  \
+		}                                                                                          \
+	} while (0)
+
+#define LogInfo(...) LOG_AT_LEVEL(OpenApoc::LogLevel::Info, __VA_ARGS__)
+#define LogWarning(...) LOG_AT_LEVEL(OpenApoc::LogLevel::Warning, __VA_ARGS__)
+#define LogError(...) LOG_AT_LEVEL(OpenApoc::LogLevel::Error, __VA_ARGS__)
@@ -0,0 +1,169 @@
+#include "framework/metrics.h"
+#include "framework/logger.h"
+#include "library/sp.h"
+
+#include <physfs.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+class MetricRegistry
+{
+  public:
+	std::mutex mutex;
+	// std::map never moves its values, so references handed out stay valid
+	std::map<UString, up<MetricCounter>> counters;
+	std::map<UString, up<MetricGauge>> gauges;
+	std::map<UString, up<MetricHistogram>> histograms;
+
+	template <typename T> T &get(std::map<UString, up<T>> &metrics, const UString &name)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &metric = metrics[name];
+		if (!metric)
+			metric.reset(new T());
+		return *metric;
+	}
+};
+
+MetricRegistry &getRegistry()
+{
+	static MetricRegistry registry;
+	return registry;
+}
+
+const char *typeName(Metrics::Type type)
+{
+	switch (type)
+	{
+		case Metrics::Type::Counter:
+			return "counter";
+		case Metrics::Type::Gauge:
+			return "gauge";
+		default:
+			return "histogram";
+	}
+}
+
+} // anonymous namespace
+
+MetricHistogram::MetricHistogram() : count(0)
+{
+	for (auto &s : samples)
+		s.store(0.0f, std::memory_order_relaxed);
+}
+
+MetricHistogram::Summary MetricHistogram::summarise() const
+{
+	Summary summary;
+	summary.count = count.load(std::memory_order_acquire);
+	size_t n = static_cast<size_t>(std::min<uint64_t>(summary.count, Size));
+	if (n == 0)
+		return summary;
+	std::array<float, Size> sorted;
+	for (size_t i = 0; i < n; i++)
+		sorted[i] = samples[i].load(std::memory_order_relaxed);
+	std::sort(sorted.begin(), sorted.begin() + n);
+	double total = 0;
+	for (size_t i = 0; i < n; i++)
+		total += sorted[i];
+	summary.min = sorted[0];
+	summary.max = sorted[n - 1];
+	summary.mean = total / n;
+	summary.p95 = sorted[std::min(n - 1, n * 95 / 100)];
+	return summary;
+}
+
+MetricCounter &Metrics::counter(const UString &name)
+{
+	auto &registry = getRegistry();
+	return registry.get(registry.counters, name);
+}
+
+MetricGauge &Metrics::gauge(const UString &name)
+{
+	auto &registry = getRegistry();
+	return registry.get(registry.gauges, name);
+}
+
+MetricHistogram &Metrics::histogram(const UString &name)
+{
+	auto &registry = getRegistry();
+	return registry.get(registry.histograms, name);
+}
+
+std::vector<Metrics::Sample> Metrics::sample()
+{
+	auto &registry = getRegistry();
+	std::vector<Sample> samples;
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (auto &c : registry.counters)
+	{
+		Sample s;
+		s.name = c.first;
+		s.type = Type::Counter;
+		s.value = static_cast<double>(c.second->get());
+		samples.push_back(s);
+	}
+	for (auto &g : registry.gauges)
+	{
+		Sample s;
+		s.name = g.first;
+		s.type = Type::Gauge;
+		s.value = g.second->get();
+		samples.push_back(s);
+	}
+	for (auto &h : registry.histograms)
+	{
+		Sample s;
+		s.name = h.first;
+		s.type = Type::Histogram;
+		s.summary = h.second->summarise();
+		s.value = s.summary.mean;
+		samples.push_back(s);
+	}
+	std::sort(samples.begin(), samples.end(),
+	          [](const Sample &a, const Sample &b) { return a.name < b.name; });
+	return samples;
+}
+
+bool Metrics::writeCSV(const UString &path)
+{
+	// Relative paths go in the write directory with everything else the game saves, rather than
+	// wherever it happened to be started from
+	UString fullPath = path;
+	auto pathStr = path.str();
+	bool absolute = (!pathStr.empty() && (pathStr[0] == '/' || pathStr[0] == '\\')) ||
+	                (pathStr.size() > 1 && pathStr[1] == ':');
+	const char *writeDir = PHYSFS_getWriteDir();
+	if (!absolute && writeDir)
+	{
+		fullPath = UString(writeDir) + "/" + path;
+	}
+	FILE *f = fopen(fullPath.c_str(), "w");
+	if (!f)
+	{
+		LogWarning("Failed to open \"%s\" to write metrics", fullPath.c_str());
+		return false;
+	}
+	fprintf(f, "name,type,value,count,min,mean,p95,max\n");
+	for (auto &s : Metrics::sample())
+	{
+		fprintf(f, "%s,%s,%f,%llu,%f,%f,%f,%f\n", s.name.c_str(), typeName(s.type), s.value,
+		        static_cast<unsigned long long>(s.summary.count), s.summary.min, s.summary.mean,
+		        s.summary.p95, s.summary.max);
+	}
+	fclose(f);
+	LogInfo("Wrote metrics to \"%s\"", fullPath.c_str());
+	return true;
+}
+
+} // namespace OpenApoc
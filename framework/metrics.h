@@ -0,0 +1,144 @@
+#pragma once
+
+#include "library/strings.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Counters, gauges and histograms that subsystems update as they go and the metrics overlay (or
+// a CSV dump) reads. Look a metric up once, e.g.
+//   static auto &drawCalls = Metrics::counter("Renderer.DrawCalls");
+// after which updating it is a single relaxed atomic operation, safe from any thread.
+
+// A running total, readers work out rates from the difference between samples
+class MetricCounter
+{
+  private:
+	std::atomic<uint64_t> value;
+
+  public:
+	MetricCounter() : value(0) {}
+	void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+	uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+// The latest value of something
+class MetricGauge
+{
+  private:
+	std::atomic<double> value;
+
+  public:
+	MetricGauge() : value(0) {}
+	void set(double v) { value.store(v, std::memory_order_relaxed); }
+	double get() const { return value.load(std::memory_order_relaxed); }
+};
+
+// Keeps the most recent Size samples. Only meant to be recorded to from one thread at a time,
+// reading while it's being recorded to just sees a mix of old and new samples.
+class MetricHistogram
+{
+  public:
+	static const unsigned int Size = 256;
+
+	class Summary
+	{
+	  public:
+		uint64_t count = 0;
+		double min = 0;
+		double mean = 0;
+		double p95 = 0;
+		double max = 0;
+	};
+
+  private:
+	std::array<std::atomic<float>, Size> samples;
+	std::atomic<uint64_t> count;
+
+  public:
+	MetricHistogram();
+	void record(float sample)
+	{
+		auto n = count.load(std::memory_order_relaxed);
+		samples[n % Size].store(sample, std::memory_order_relaxed);
+		count.store(n + 1, std::memory_order_release);
+	}
+	// Statistics over the samples still in the window, 'count' is every sample ever recorded
+	Summary summarise() const;
+};
+
+// Records the time from construction to destruction in milliseconds
+class MetricTimer
+{
+  private:
+	MetricHistogram &histogram;
+	std::chrono::steady_clock::time_point start;
+
+  public:
+	MetricTimer(MetricHistogram &histogram)
+	    : histogram(histogram), start(std::chrono::steady_clock::now())
+	{
+	}
+	~MetricTimer()
+	{
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		histogram.record(elapsed.count());
+	}
+};
+
+// Times a run of consecutive phases, each lap() records the time since the previous one
+class MetricStopwatch
+{
+  private:
+	std::chrono::steady_clock::time_point last;
+
+  public:
+	MetricStopwatch() : last(std::chrono::steady_clock::now()) {}
+	void lap(MetricHistogram &histogram)
+	{
+		auto now = std::chrono::steady_clock::now();
+		std::chrono::duration<float, std::milli> elapsed = now - last;
+		histogram.record(elapsed.count());
+		last = now;
+	}
+};
+
+class Metrics
+{
+  public:
+	enum class Type
+	{
+		Counter,
+		Gauge,
+		Histogram,
+	};
+
+	class Sample
+	{
+	  public:
+		UString name;
+		Type type;
+		// The counter total or gauge value, for histograms the mean
+		double value = 0;
+		MetricHistogram::Summary summary;
+	};
+
+	// Metrics live until exit, so the references can be kept
+	static MetricCounter &counter(const UString &name);
+	static MetricGauge &gauge(const UString &name);
+	static MetricHistogram &histogram(const UString &name);
+
+	// Every metric, sorted by name
+	static std::vector<Sample> sample();
+	// Write the current sample() to 'path' as CSV, one row per metric. A relative path is taken
+	// from the PhysFS write directory.
+	static bool writeCSV(const UString &path);
+};
+
+} // namespace OpenApoc
@@ -0,0 +1,103 @@
+#include "framework/metricsoverlay.h"
+#include "framework/font.h"
+#include "framework/framework.h"
+#include "framework/metrics.h"
+#include "framework/renderer.h"
+
+namespace OpenApoc
+{
+
+namespace
+{
+const std::chrono::milliseconds refreshInterval(250);
+} // anonymous namespace
+
+MetricsOverlay::MetricsOverlay() : visible(false) {}
+
+MetricsOverlay::~MetricsOverlay() {}
+
+void MetricsOverlay::toggle()
+{
+	visible = !visible;
+	if (visible)
+	{
+		// Start the rates from now rather than from whenever the overlay was last shown
+		lastCounters.clear();
+		lastRefresh = {};
+	}
+}
+
+void MetricsOverlay::setFont(sp<BitmapFont> newFont)
+{
+	font = newFont;
+	lines.clear();
+	lastRefresh = {};
+}
+
+void MetricsOverlay::refresh()
+{
+	auto now = std::chrono::steady_clock::now();
+	if (now - lastRefresh < refreshInterval)
+		return;
+	std::chrono::duration<double> elapsed = now - lastRefresh;
+	bool haveRates = !lastCounters.empty();
+	lastRefresh = now;
+
+	if (!font)
+		return;
+
+	lines.clear();
+	for (auto &sample : Metrics::sample())
+	{
+		UString text;
+		switch (sample.type)
+		{
+			case Metrics::Type::Counter:
+			{
+				auto &last = lastCounters[sample.name];
+				if (haveRates)
+					text = UString::format("%s: %.0f/s", sample.name.c_str(),
+					                       (sample.value - last) / elapsed.count());
+				else
+					text = UString::format("%s: %.0f", sample.name.c_str(), sample.value);
+				last = sample.value;
+				break;
+			}
+			case Metrics::Type::Gauge:
+				text = UString::format("%s: %.1f", sample.name.c_str(), sample.value);
+				break;
+			case Metrics::Type::Histogram:
+				text = UString::format("%s: %.2f mean %.2f p95 %.2f max", sample.name.c_str(),
+				                       sample.summary.mean, sample.summary.p95,
+				                       sample.summary.max);
+				break;
+		}
+		lines.push_back(font->getString(text));
+	}
+}
+
+void MetricsOverlay::render()
+{
+	if (!visible)
+		return;
+	this->refresh();
+	if (lines.empty())
+		return;
+
+	Vec2<float> size = {0, 0};
+	for (auto &line : lines)
+	{
+		size.x = std::max(size.x, static_cast<float>(line->size.x));
+		size.y += line->size.y;
+	}
+	Vec2<float> position = {4, 4};
+	fw().renderer->drawFilledRect(position, size + Vec2<float>{4, 4}, Colour{0, 0, 0, 192});
+	position += Vec2<float>{2, 2};
+	for (auto &line : lines)
+	{
+		fw().renderer->draw(line, position);
+		position.y += line->size.y;
+	}
+}
+
+}; // namespace OpenApoc
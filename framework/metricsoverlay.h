@@ -0,0 +1,44 @@
+#pragma once
+
+#include "library/sp.h"
+#include "library/strings.h"
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+namespace OpenApoc
+{
+
+class BitmapFont;
+class PaletteImage;
+
+// Draws the current Metrics over whatever stage is running. This is driven directly by the
+// Framework rather than being a Stage itself, so it can be shown over any stage without taking
+// events or stage commands away from it.
+class MetricsOverlay
+{
+  private:
+	bool visible;
+	sp<BitmapFont> font;
+	std::vector<sp<PaletteImage>> lines;
+	std::chrono::steady_clock::time_point lastRefresh;
+	// Counter values at the last refresh, to show them as a rate
+	std::map<UString, double> lastCounters;
+
+	// Rendering text is too slow to do every frame, so the lines are only rebuilt a few times a
+	// second
+	void refresh();
+
+  public:
+	MetricsOverlay();
+	~MetricsOverlay();
+
+	void toggle();
+	bool isVisible() const { return visible; }
+	// The framework has no fonts of its own, so nothing is drawn until the game supplies one
+	void setFont(sp<BitmapFont> newFont);
+	void render();
+};
+
+}; // namespace OpenApoc
@@ -14,6 +14,11 @@
 #define le64toh(x) htole64(x)
 #endif
 #include <endian.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP
 #else
 /* Windows is always little endian? */
 static inline uint16_t le16toh(uint16_t val) { return val; }
@@ -30,7 +35,7 @@ static UString GetCorrectCaseFilename(const UString &Filename)
 	std::string u8Filename = Filename.str();
 	std::unique_ptr<char[]> buf(new char[u8Filename.length() + 1]);
 	strncpy(buf.get(), u8Filename.c_str(), u8Filename.length());
-	buf[Filename.length()] = '\0';
+	buf[u8Filename.length()] = '\0';
 	if (PHYSFSEXT_locateCorrectCase(buf.get()))
 	{
 		LogInfo("Failed to find file \"%s\"", Filename.c_str());
@@ -45,6 +50,7 @@ class PhysfsIFileImpl : public std::streambuf, public IFileImpl
 	size_t bufferSize;
 	std::unique_ptr<char[]> buffer;
 	UString systemPath;
+	UString realDir;
 	UString caseCorrectedPath;
 	UString suppliedPath;
 
@@ -59,8 +65,8 @@ class PhysfsIFileImpl : public std::streambuf, public IFileImpl
 			LogError("Failed to open file \"%s\" : \"%s\"", path.c_str(), PHYSFS_getLastError());
 			return;
 		}
-		systemPath = PHYSFS_getRealDir(path.c_str());
-		systemPath += "/" + path;
+		realDir = PHYSFS_getRealDir(path.c_str());
+		systemPath = realDir + "/" + path;
 	}
 	virtual ~PhysfsIFileImpl()
 	{
@@ -221,6 +227,92 @@ std::unique_ptr<char[]> IFile::readAll()
 	return mem;
 }
 
+IFileView::IFileView() : ptr(nullptr), len(0), mapping(nullptr) {}
+
+IFileView::IFileView(IFileView &&other)
+    : ptr(other.ptr), len(other.len), buffer(std::move(other.buffer)), mapping(other.mapping)
+{
+	other.ptr = nullptr;
+	other.len = 0;
+	other.mapping = nullptr;
+}
+
+IFileView &IFileView::operator=(IFileView &&other)
+{
+	if (this == &other)
+		return *this;
+#ifdef HAVE_MMAP
+	if (mapping)
+		munmap(mapping, len);
+#endif
+	ptr = other.ptr;
+	len = other.len;
+	buffer = std::move(other.buffer);
+	mapping = other.mapping;
+	other.ptr = nullptr;
+	other.len = 0;
+	other.mapping = nullptr;
+	return *this;
+}
+
+IFileView::~IFileView()
+{
+#ifdef HAVE_MMAP
+	if (mapping)
+		munmap(mapping, len);
+#endif
+}
+
+IFileView IFile::map()
+{
+	IFileView view;
+	if (!this->f)
+		return view;
+	auto *impl = dynamic_cast<PhysfsIFileImpl *>(f.get());
+	auto fileSize = this->size();
+
+#ifdef HAVE_MMAP
+	// Only files directly in a mounted directory can be mapped, members of an archive (or the CD
+	// iso) have to be read through physfs
+	struct stat dirStat;
+	if (fileSize > 0 && stat(impl->realDir.c_str(), &dirStat) == 0 && S_ISDIR(dirStat.st_mode))
+	{
+		int fd = ::open(impl->systemPath.c_str(), O_RDONLY);
+		if (fd >= 0)
+		{
+			void *mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (mapping != MAP_FAILED)
+			{
+				view.mapping = mapping;
+				view.ptr = static_cast<const uint8_t *>(mapping);
+				view.len = fileSize;
+				return view;
+			}
+		}
+		LogWarning("Failed to map \"%s\" - falling back to read", impl->systemPath.c_str());
+	}
+#endif
+
+	view.buffer.reset(new uint8_t[fileSize > 0 ? fileSize : 1]);
+	// Read directly from physfs, restoring the file position afterwards so the stream's buffered
+	// data stays valid
+	auto currentPos = PHYSFS_tell(impl->file);
+	PHYSFS_seek(impl->file, 0);
+	auto bytesRead = PHYSFS_readBytes(impl->file, view.buffer.get(), fileSize);
+	PHYSFS_seek(impl->file, currentPos);
+	if (bytesRead != static_cast<decltype(bytesRead)>(fileSize))
+	{
+		LogError("Failed to read %llu bytes from \"%s\"", static_cast<long long unsigned>(fileSize),
+		         impl->suppliedPath.c_str());
+		view.buffer.reset();
+		return view;
+	}
+	view.ptr = view.buffer.get();
+	view.len = fileSize;
+	return view;
+}
+
 IFile::~IFile() {}
 
 FileSystem::FileSystem(std::vector<UString> paths)
@@ -1,10 +1,14 @@
 #include "library/sp.h"
 #include "framework/renderer_interface.h"
 #include "framework/logger.h"
+#include "framework/metrics.h"
 #include "framework/image.h"
 #include "framework/palette.h"
-#include <memory>
+#include "framework/trace.h"
+#include <algorithm>
 #include <array>
+#include <memory>
+#include <numeric>
 
 namespace
 {
@@ -19,6 +23,9 @@ namespace
 
 using namespace OpenApoc;
 
+MetricCounter &drawCallCount = Metrics::counter("Renderer.DrawCalls");
+MetricCounter &flushCount = Metrics::counter("Renderer.Flushes");
+
 class Program
 {
   public:
@@ -200,25 +207,30 @@ const char *PaletteProgram_vertexSource = {
     "#version 110\n"
     "attribute vec2 position;\n"
     "attribute vec2 texcoord_in;\n"
+    "attribute float paletteRow_in;\n"
     "varying vec2 texcoord;\n"
+    "varying float paletteRow;\n"
     "uniform vec2 screenSize;\n"
     "uniform bool flipY;\n"
     "void main() {\n"
     "  texcoord = texcoord_in;\n"
+    "  paletteRow = paletteRow_in;\n"
     "  vec2 tmpPos = position;\n"
     "  tmpPos /= screenSize;\n"
     "  tmpPos -= vec2(0.5,0.5);\n"
     "  if (flipY) gl_Position = vec4((tmpPos.x*2.0), -(tmpPos.y*2.0),0.0,1.0);\n"
     "  else gl_Position = vec4((tmpPos.x*2.0), (tmpPos.y*2.0),0.0,1.0);\n"
     "}\n"};
-const char *PaletteProgram_fragmentSource = {"#version 110\n"
-                                             "varying vec2 texcoord;\n"
-                                             "uniform sampler2D tex;\n"
-                                             "uniform sampler2D pal;\n"
-                                             "void main() {\n"
-                                             " float idx = texture2D(tex, texcoord,0.0).r;\n"
-                                             " gl_FragColor = texture2D(pal, vec2(idx,0.0),0.0);\n"
-                                             "}\n"};
+const char *PaletteProgram_fragmentSource = {
+    "#version 110\n"
+    "varying vec2 texcoord;\n"
+    "uniform sampler2D tex;\n"
+    "uniform sampler2D pal;\n"
+    "varying float paletteRow;\n"
+    "void main() {\n"
+    " float idx = texture2D(tex, texcoord,0.0).r;\n"
+    " gl_FragColor = texture2D(pal, vec2(idx,paletteRow),0.0);\n"
+    "}\n"};
 class PaletteProgram : public SpriteProgram
 {
   private:
@@ -229,6 +241,7 @@ class PaletteProgram : public SpriteProgram
 
   public:
 	GLint palLoc;
+	GLint paletteRowLoc;
 	PaletteProgram()
 	    : SpriteProgram(PaletteProgram_vertexSource, PaletteProgram_fragmentSource),
 	      currentScreenSize(0, 0), currentFlipY(false), currentTexUnit(0), currentPalUnit(0)
@@ -238,8 +251,17 @@ class PaletteProgram : public SpriteProgram
 		this->screenSizeLoc = gl::GetUniformLocation(this->prog, "screenSize");
 		this->texLoc = gl::GetUniformLocation(this->prog, "tex");
 		this->palLoc = gl::GetUniformLocation(this->prog, "pal");
+		this->paletteRowLoc = gl::GetAttribLocation(this->prog, "paletteRow_in");
 		this->flipYLoc = gl::GetUniformLocation(this->prog, "flipY");
 	}
+	// 'row' is the texture coordinate of the palette's row in the palette table. This sets it for
+	// single draws, batches give each vertex its own.
+	void setPaletteRow(float row)
+	{
+		// The value is shared by every program, and an array left enabled would override it
+		gl::DisableVertexAttribArray(this->paletteRowLoc);
+		gl::VertexAttrib1f(this->paletteRowLoc, row);
+	}
 	void setUniforms(Vec2<int> screenSize, bool flipY, GLint texUnit = 0, GLint palUnit = 1)
 	{
 		if (screenSize != currentScreenSize)
@@ -368,12 +390,14 @@ class Quad
 		gl::EnableVertexAttribArray(texcoordAttribPos);
 		gl::VertexAttribPointer(texcoordAttribPos, 2, gl::FLOAT, gl::FALSE_, 0, &texcoords);
 		gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
+		drawCallCount.add();
 	}
 	void draw(GLuint vertexAttribPos)
 	{
 		gl::EnableVertexAttribArray(vertexAttribPos);
 		gl::VertexAttribPointer(vertexAttribPos, 2, gl::FLOAT, gl::FALSE_, 0, &vertices);
 		gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
+		drawCallCount.add();
 	}
 };
 class Line
@@ -391,6 +415,7 @@ class Line
 		gl::EnableVertexAttribArray(vertexAttribPos);
 		gl::VertexAttribPointer(vertexAttribPos, 2, gl::FLOAT, gl::FALSE_, 0, &vertices);
 		gl::DrawArrays(gl::LINES, 0, 2);
+		drawCallCount.add();
 	}
 };
 class ActiveTexture
@@ -568,24 +593,74 @@ class GLRGBImage : public RendererImageData
 	virtual ~GLRGBImage() { gl::DeleteTextures(1, &this->texID); }
 };
 
-class GLPalette : public RendererImageData
+// Every palette in use is uploaded to a row of one texture, so switching palettes only changes
+// which row the shader reads from
+class PaletteTable
 {
   public:
+	static const int Width = 256;
+	static const int Rows = 256;
 	GLuint texID;
-	Vec2<float> size;
-	std::weak_ptr<Palette> parent;
-	GLPalette(sp<Palette> parent) : size(Vec2<float>(parent->colours.size(), 1)), parent(parent)
+	std::vector<GLint> freeRows;
+
+	PaletteTable()
 	{
+		TRACE_FN;
 		gl::GenTextures(1, &this->texID);
 		BindTexture b(this->texID);
 		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
 		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
 		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE);
 		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE);
-		gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA, parent->colours.size(), 1, 0, gl::RGBA,
-		               gl::UNSIGNED_BYTE, parent->colours.data());
+		gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA, Width, Rows, 0, gl::RGBA, gl::UNSIGNED_BYTE,
+		               NULL);
+		for (GLint row = Rows - 1; row >= 0; row--)
+		{
+			freeRows.push_back(row);
+		}
+	}
+	~PaletteTable() { gl::DeleteTextures(1, &this->texID); }
+
+	// Returns -1 if every row is in use
+	GLint allocate(const Palette &palette)
+	{
+		if (freeRows.empty())
+		{
+			return -1;
+		}
+		GLint row = freeRows.back();
+		freeRows.pop_back();
+		BindTexture b(this->texID);
+		GLsizei count = std::min(static_cast<GLsizei>(palette.colours.size()), Width);
+		gl::TexSubImage2D(gl::TEXTURE_2D, 0, 0, row, count, 1, gl::RGBA, gl::UNSIGNED_BYTE,
+		                  palette.colours.data());
+		return row;
+	}
+	void release(GLint row) { freeRows.push_back(row); }
+	static float rowCoord(GLint row) { return (row + 0.5f) / Rows; }
+};
+
+class GLPalette : public RendererImageData
+{
+  public:
+	sp<PaletteTable> table;
+	GLint row;
+	bool ownsRow;
+	std::weak_ptr<Palette> parent;
+	GLPalette(sp<PaletteTable> table, sp<Palette> parent)
+	    : table(table), row(table->allocate(*parent)), ownsRow(row >= 0), parent(parent)
+	{
+		if (!ownsRow)
+		{
+			LogError("Palette table full, drawing with the first palette instead");
+			row = 0;
+		}
+	}
+	virtual ~GLPalette()
+	{
+		if (ownsRow)
+			table->release(row);
 	}
-	virtual ~GLPalette() { gl::DeleteTextures(1, &this->texID); }
 };
 
 class GLPaletteImage : public RendererImageData
@@ -610,9 +685,156 @@ class GLPaletteImage : public RendererImageData
 	virtual ~GLPaletteImage() { gl::DeleteTextures(1, &this->texID); }
 };
 
+// Lays out every image of a set on a single texture. This is a simple shelf packer: images are
+// placed left to right in rows, tallest first so little space is wasted at the bottom of each row.
+// A 1 pixel gap is left to the right of and below each image so nothing bleeds into its
+// neighbours. Returns false if the set doesn't fit in a 'maxTextureSize' square texture.
+bool packAtlas(const ImageSet &set, int maxTextureSize, Vec2<int> &atlasSize,
+               std::vector<Vec2<int>> &positions)
+{
+	const int padding = 1;
+	std::vector<unsigned int> order(set.images.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&set](unsigned int a, unsigned int b) {
+		return set.images[a]->size.y > set.images[b]->size.y;
+	});
+
+	uint64_t area = 0;
+	int widest = 0;
+	for (auto &image : set.images)
+	{
+		area += static_cast<uint64_t>(image->size.x + padding) * (image->size.y + padding);
+		widest = std::max(widest, static_cast<int>(image->size.x) + padding);
+	}
+	// Aim for a roughly square atlas, with power of two sizes for older hardware
+	int width = 64;
+	while (width < widest || static_cast<uint64_t>(width) * width < area)
+	{
+		width *= 2;
+	}
+	width = std::min(width, maxTextureSize);
+	if (widest > width)
+	{
+		return false;
+	}
+
+	positions.resize(set.images.size());
+	int x = 0;
+	int y = 0;
+	int rowHeight = 0;
+	for (auto index : order)
+	{
+		auto size = set.images[index]->size;
+		if (x + static_cast<int>(size.x) + padding > width)
+		{
+			y += rowHeight;
+			x = 0;
+			rowHeight = 0;
+		}
+		positions[index] = {x, y};
+		x += size.x + padding;
+		rowHeight = std::max(rowHeight, static_cast<int>(size.y) + padding);
+	}
+
+	int height = 1;
+	while (height < y + rowHeight)
+	{
+		height *= 2;
+	}
+	if (height > maxTextureSize)
+	{
+		return false;
+	}
+	atlasSize = {width, height};
+	return true;
+}
+
+// All the images of an ImageSet packed into one 2D texture, so sprites from the same set can be
+// batched without the texture arrays the GL3 renderer relies on. Each atlas owns the vertex buffer
+// its batches are streamed through.
+class GLPaletteAtlas : public RendererImageData
+{
+  public:
+	std::weak_ptr<ImageSet> parent;
+	GLuint texID;
+	GLuint vertexBuffer;
+	Vec2<int> atlasSize;
+	// Normalised texture coordinates of each image, indexed by indexInSet
+	std::vector<Rect<float>> texCoords;
+	// False if the set couldn't be packed, its images are then drawn one at a time
+	bool valid;
+
+	GLPaletteAtlas(sp<ImageSet> parent, int maxTextureSize)
+	    : parent(parent), texID(0), vertexBuffer(0), atlasSize(0, 0), valid(false)
+	{
+		TRACE_FN;
+		for (auto &image : parent->images)
+		{
+			if (!std::dynamic_pointer_cast<PaletteImage>(image))
+			{
+				LogWarning("Image set contains non-palette images, not creating an atlas");
+				return;
+			}
+		}
+		std::vector<Vec2<int>> positions;
+		if (!packAtlas(*parent, maxTextureSize, atlasSize, positions))
+		{
+			LogWarning("%u images don't fit in a %d texture, not creating an atlas",
+			           static_cast<unsigned>(parent->images.size()), maxTextureSize);
+			return;
+		}
+
+		LogInfo("Uploading %u sprites in {%d,%d} atlas", static_cast<unsigned>(positions.size()),
+		        atlasSize.x, atlasSize.y);
+		// Anything not covered by an image is index 0, which is transparent
+		std::vector<uint8_t> pixels(atlasSize.x * atlasSize.y, 0);
+		texCoords.resize(positions.size());
+		for (unsigned int i = 0; i < positions.size(); i++)
+		{
+			auto img = std::static_pointer_cast<PaletteImage>(parent->images[i]);
+			PaletteImageLock l(img, ImageLockUse::Read);
+			auto *src = static_cast<const uint8_t *>(l.getData());
+			for (unsigned int row = 0; row < img->size.y; row++)
+			{
+				std::copy(src + row * img->size.x, src + (row + 1) * img->size.x,
+				          pixels.begin() + (positions[i].y + row) * atlasSize.x + positions[i].x);
+			}
+			Vec2<int> end = positions[i] + Vec2<int>{img->size};
+			texCoords[i] = {Vec2<float>{positions[i]} / Vec2<float>{atlasSize},
+			                Vec2<float>{end} / Vec2<float>{atlasSize}};
+		}
+
+		gl::GenTextures(1, &this->texID);
+		BindTexture b(this->texID);
+		UnpackAlignment align(1);
+		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE);
+		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE);
+		gl::TexImage2D(gl::TEXTURE_2D, 0, 1, atlasSize.x, atlasSize.y, 0, gl::RED,
+		               gl::UNSIGNED_BYTE, pixels.data());
+
+		gl::GenBuffers(1, &this->vertexBuffer);
+		valid = true;
+	}
+	virtual ~GLPaletteAtlas()
+	{
+		if (texID)
+			gl::DeleteTextures(1, &texID);
+		if (vertexBuffer)
+			gl::DeleteBuffers(1, &vertexBuffer);
+	}
+};
+
 class OGL20Renderer : public Renderer
 {
   private:
+	enum class RendererState
+	{
+		Idle,
+		BatchingAtlas,
+	};
+	RendererState state;
 	sp<RGBProgram> rgbProgram;
 	sp<SolidColourProgram> colourProgram;
 	sp<PaletteProgram> paletteProgram;
@@ -622,6 +844,20 @@ class OGL20Renderer : public Renderer
 	sp<Surface> currentSurface;
 	sp<Palette> currentPalette;
 
+	// Images bound to a palette are drawn with it regardless of the current one
+	const sp<Palette> &getImagePalette(const PaletteImage &img)
+	{
+		return img.palette ? img.palette : this->currentPalette;
+	}
+	sp<PaletteTable> paletteTable;
+	// The palette table row for 'p', uploading it the first time it's used
+	GLint getPaletteRow(const sp<Palette> &p)
+	{
+		if (!p->rendererPrivateData)
+			p->rendererPrivateData.reset(new GLPalette(this->paletteTable, p));
+		return static_cast<GLPalette *>(p->rendererPrivateData.get())->row;
+	}
+
 	friend class RendererSurfaceBinding;
 	virtual void setSurface(sp<Surface> s) override
 	{
@@ -644,8 +880,9 @@ class OGL20Renderer : public Renderer
 
   public:
 	OGL20Renderer()
-	    : rgbProgram(new RGBProgram()), colourProgram(new SolidColourProgram()),
-	      paletteProgram(new PaletteProgram()), currentBoundProgram(0), currentBoundFBO(0)
+	    : state(RendererState::Idle), rgbProgram(new RGBProgram()),
+	      colourProgram(new SolidColourProgram()), paletteProgram(new PaletteProgram()),
+	      currentBoundProgram(0), currentBoundFBO(0)
 	{
 		GLint viewport[4];
 		gl::GetIntegerv(gl::VIEWPORT, viewport);
@@ -654,14 +891,38 @@ class OGL20Renderer : public Renderer
 		this->defaultSurface = mksp<Surface>(Vec2<int>{viewport[2], viewport[3]});
 		this->defaultSurface->rendererPrivateData.reset(new FBOData(0));
 		this->currentSurface = this->defaultSurface;
+		this->paletteTable = mksp<PaletteTable>();
 
 		GLint maxTexUnits;
 		gl::GetIntegerv(gl::MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTexUnits);
 		LogInfo("MAX_COMBINED_TEXTURE_IMAGE_UNITS: %d", maxTexUnits);
+		gl::GetIntegerv(gl::MAX_TEXTURE_SIZE, &this->maxTextureSize);
+		LogInfo("MAX_TEXTURE_SIZE: %d", this->maxTextureSize);
+
+		// Every batch is drawn as indexed triangles, the indices never change so they're uploaded
+		// once. 16 bit indices are all GLES2 guarantees, which limits a batch to 16384 sprites.
+		this->maxBatchedSprites = 2048;
+		std::vector<GLushort> indices(this->maxBatchedSprites * 6);
+		for (unsigned int i = 0; i < this->maxBatchedSprites; i++)
+		{
+			GLushort first = static_cast<GLushort>(i * 4);
+			indices[i * 6 + 0] = first;
+			indices[i * 6 + 1] = first + 1;
+			indices[i * 6 + 2] = first + 2;
+			indices[i * 6 + 3] = first + 2;
+			indices[i * 6 + 4] = first + 1;
+			indices[i * 6 + 5] = first + 3;
+		}
+		gl::GenBuffers(1, &this->indexBuffer);
+		gl::BindBuffer(gl::ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+		gl::BufferData(gl::ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(),
+		               gl::STATIC_DRAW);
+		gl::BindBuffer(gl::ELEMENT_ARRAY_BUFFER, 0);
+
 		gl::Enable(gl::BLEND);
 		gl::BlendFunc(gl::SRC_ALPHA, gl::ONE_MINUS_SRC_ALPHA);
 	}
-	virtual ~OGL20Renderer(){};
+	virtual ~OGL20Renderer() { gl::DeleteBuffers(1, &this->indexBuffer); };
 	virtual void clear(Colour c = Colour{0, 0, 0, 0}) override
 	{
 		this->flush();
@@ -672,20 +933,54 @@ class OGL20Renderer : public Renderer
 	{
 		if (p == this->currentPalette)
 			return;
-		this->flush();
-		if (!p->rendererPrivateData)
-			p->rendererPrivateData.reset(new GLPalette(p));
+		// Batched sprites carry their own palette row, so nothing needs flushing
+		this->getPaletteRow(p);
 		this->currentPalette = p;
 	}
 	virtual sp<Palette> getPalette() override { return this->currentPalette; }
 	virtual void draw(sp<Image> image, Vec2<float> position) override
 	{
+		sp<ImageSet> owningSet = image->owningSet.lock();
+		if (owningSet)
+		{
+			sp<GLPaletteAtlas> atlas =
+			    std::dynamic_pointer_cast<GLPaletteAtlas>(owningSet->rendererPrivateData);
+			if (!atlas)
+			{
+				atlas = mksp<GLPaletteAtlas>(owningSet, this->maxTextureSize);
+				owningSet->rendererPrivateData = atlas;
+			}
+			if (atlas->valid)
+			{
+				if (this->state == RendererState::BatchingAtlas &&
+				    (atlas != this->boundAtlas ||
+				     this->batchedSprites.size() >= this->maxBatchedSprites))
+				{
+					this->flush();
+				}
+				this->boundAtlas = atlas;
+				this->state = RendererState::BatchingAtlas;
+				// Everything in an atlas is a PaletteImage
+				auto &palette = getImagePalette(static_cast<PaletteImage &>(*image));
+				if (this->batchedPalettes.empty() || this->batchedPalettes.back() != palette)
+				{
+					this->batchedPalettes.push_back(palette);
+				}
+				this->batchedSprites.emplace_back(
+				    position, Vec2<float>(image->size.x, image->size.y),
+				    atlas->texCoords[image->indexInSet],
+				    PaletteTable::rowCoord(getPaletteRow(palette)));
+				return;
+			}
+		}
 		drawScaled(image, position, image->size, Scaler::Nearest);
 	}
 	virtual void drawRotated(sp<Image> image, Vec2<float> center, Vec2<float> position,
 	                         float angle) override
 	{
 		auto size = image->size;
+		if (this->state != RendererState::Idle)
+			this->flush();
 		sp<RGBImage> rgbImage = std::dynamic_pointer_cast<RGBImage>(image);
 		if (rgbImage)
 		{
@@ -705,7 +1000,8 @@ class OGL20Renderer : public Renderer
 	virtual void drawScaled(sp<Image> image, Vec2<float> position, Vec2<float> size,
 	                        Scaler scaler = Scaler::Linear) override
 	{
-
+		if (this->state != RendererState::Idle)
+			this->flush();
 		sp<RGBImage> rgbImage = std::dynamic_pointer_cast<RGBImage>(image);
 		if (rgbImage)
 		{
@@ -729,13 +1025,15 @@ class OGL20Renderer : public Renderer
 				img = new GLPaletteImage(paletteImage);
 				image->rendererPrivateData.reset(img);
 			}
-			if (scaler != Scaler::Nearest)
+			// Images bound to a palette used to be loaded as RGB, so callers may still ask for
+			// linear scaling. They're drawn nearest like any other paletted image.
+			if (scaler != Scaler::Nearest && !paletteImage->palette)
 			{
 				// blending indices doesn't make sense. You'll have to render
 				// it to an RGB surface then scale that
 				LogError("Only nearest scaler is supported on paletted images");
 			}
-			this->DrawPalette(*img, position, size);
+			this->DrawPalette(*img, position, size, getImagePalette(*paletteImage));
 			return;
 		}
 
@@ -763,6 +1061,8 @@ class OGL20Renderer : public Renderer
 	}
 	virtual void drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c) override
 	{
+		if (this->state != RendererState::Idle)
+			this->flush();
 		this->DrawRect(position, size, c);
 	}
 	virtual void drawRect(Vec2<float> position, Vec2<float> size, Colour c,
@@ -837,9 +1137,23 @@ class OGL20Renderer : public Renderer
 	}
 	virtual void drawLine(Vec2<float> p1, Vec2<float> p2, Colour c, float thickness = 1.0) override
 	{
+		if (this->state != RendererState::Idle)
+			this->flush();
 		this->DrawLine(p1, p2, c, thickness);
 	}
-	virtual void flush() override { /* Nothing to flush */}
+	virtual void flush() override
+	{
+		switch (this->state)
+		{
+			case RendererState::Idle:
+				break;
+			case RendererState::BatchingAtlas:
+				flushCount.add();
+				this->DrawBatchedAtlas();
+				break;
+		}
+		this->state = RendererState::Idle;
+	}
 	virtual UString getName() override { return "OGL2.0 Renderer"; }
 	virtual sp<Surface> getDefaultSurface() override { return this->defaultSurface; }
 
@@ -879,7 +1193,8 @@ class OGL20Renderer : public Renderer
 		Quad q(pos, Rect<float>{{0, 0}, {1, 1}}, rotationCenter, rotationAngleRadians);
 		q.draw(rgbProgram->posLoc, rgbProgram->texcoordLoc);
 	}
-	void DrawPalette(GLPaletteImage &img, Vec2<float> offset, Vec2<float> size)
+	void DrawPalette(GLPaletteImage &img, Vec2<float> offset, Vec2<float> size,
+	                 const sp<Palette> &palette)
 	{
 		BindProgram(paletteProgram);
 		Rect<float> pos(offset, offset + size);
@@ -888,9 +1203,8 @@ class OGL20Renderer : public Renderer
 			flipY = true;
 		paletteProgram->setUniforms(this->currentSurface->size, flipY);
 		BindTexture t(img.texID, 0);
-
-		BindTexture p(
-		    static_cast<GLPalette *>(this->currentPalette->rendererPrivateData.get())->texID, 1);
+		paletteProgram->setPaletteRow(PaletteTable::rowCoord(getPaletteRow(palette)));
+		BindTexture p(this->paletteTable->texID, 1);
 		Quad q(pos, Rect<float>{{0, 0}, {1, 1}});
 		q.draw(paletteProgram->posLoc, paletteProgram->texcoordLoc);
 	}
@@ -946,6 +1260,93 @@ class OGL20Renderer : public Renderer
 		Line l(p0, p1, thickness);
 		l.draw(colourProgram->posLoc);
 	}
+	class BatchedVertex
+	{
+	  public:
+		Vec2<float> position;
+		Vec2<float> texCoord;
+		// GL2 has no integer attributes, so this is the row's texture coordinate like the
+		// single draw's
+		float paletteRow;
+		BatchedVertex() {}
+		BatchedVertex(Vec2<float> p, Vec2<float> tc, float palette)
+		    : position(p), texCoord(tc), paletteRow(palette)
+		{
+		}
+	};
+	static_assert(sizeof(BatchedVertex) == 20, "BatchedVertex unexpected size");
+
+	class BatchedSprite
+	{
+	  public:
+		std::array<BatchedVertex, 4> vertices;
+		BatchedSprite(Vec2<float> screenPosition, Vec2<float> spriteSize,
+		              const Rect<float> &texCoords, float paletteRow)
+		{
+			Vec2<float> maxPosition = screenPosition + spriteSize;
+			vertices[0] = BatchedVertex{screenPosition, texCoords.p0, paletteRow};
+			vertices[1] = BatchedVertex{Vec2<float>{maxPosition.x, screenPosition.y},
+			                            Vec2<float>{texCoords.p1.x, texCoords.p0.y}, paletteRow};
+			vertices[2] = BatchedVertex{Vec2<float>{screenPosition.x, maxPosition.y},
+			                            Vec2<float>{texCoords.p0.x, texCoords.p1.y}, paletteRow};
+			vertices[3] = BatchedVertex{maxPosition, texCoords.p1, paletteRow};
+		}
+	};
+	static_assert(sizeof(BatchedSprite) == sizeof(BatchedVertex) * 4,
+	              "BatchedSprite unexpected size");
+
+	std::vector<BatchedSprite> batchedSprites;
+	unsigned maxBatchedSprites;
+	GLint maxTextureSize;
+	GLuint indexBuffer;
+	sp<GLPaletteAtlas> boundAtlas;
+	// Keeps the palettes used by the batch (and so their table rows) alive until it's drawn
+	std::vector<sp<Palette>> batchedPalettes;
+
+	void DrawBatchedAtlas()
+	{
+		BindProgram(paletteProgram);
+		bool flipY = false;
+		if (currentBoundFBO == 0)
+			flipY = true;
+		paletteProgram->setUniforms(this->currentSurface->size, flipY);
+		BindTexture t(this->boundAtlas->texID, 0);
+		BindTexture p(this->paletteTable->texID, 1);
+
+		// Respecifying the whole buffer lets the driver hand out fresh storage instead of waiting
+		// for the previous batch from this atlas to finish drawing
+		gl::BindBuffer(gl::ARRAY_BUFFER, this->boundAtlas->vertexBuffer);
+		gl::BufferData(gl::ARRAY_BUFFER, this->batchedSprites.size() * sizeof(BatchedSprite),
+		               this->batchedSprites.data(), gl::STREAM_DRAW);
+
+		gl::EnableVertexAttribArray(paletteProgram->posLoc);
+		gl::EnableVertexAttribArray(paletteProgram->texcoordLoc);
+		gl::EnableVertexAttribArray(paletteProgram->paletteRowLoc);
+		gl::VertexAttribPointer(paletteProgram->posLoc, 2, gl::FLOAT, gl::FALSE_,
+		                        sizeof(BatchedVertex),
+		                        reinterpret_cast<const void *>(offsetof(BatchedVertex, position)));
+		gl::VertexAttribPointer(paletteProgram->texcoordLoc, 2, gl::FLOAT, gl::FALSE_,
+		                        sizeof(BatchedVertex),
+		                        reinterpret_cast<const void *>(offsetof(BatchedVertex, texCoord)));
+		gl::VertexAttribPointer(
+		    paletteProgram->paletteRowLoc, 1, gl::FLOAT, gl::FALSE_, sizeof(BatchedVertex),
+		    reinterpret_cast<const void *>(offsetof(BatchedVertex, paletteRow)));
+
+		gl::BindBuffer(gl::ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+		gl::DrawElements(gl::TRIANGLES, this->batchedSprites.size() * 6, gl::UNSIGNED_SHORT,
+		                 nullptr);
+		drawCallCount.add();
+
+		// Everything else is drawn straight from client memory, with the palette row set once per
+		// draw
+		gl::BindBuffer(gl::ARRAY_BUFFER, 0);
+		gl::BindBuffer(gl::ELEMENT_ARRAY_BUFFER, 0);
+		gl::DisableVertexAttribArray(paletteProgram->paletteRowLoc);
+
+		this->batchedSprites.clear();
+		this->batchedPalettes.clear();
+		this->state = RendererState::Idle;
+	}
 };
 
 class OGL20RendererFactory : public OpenApoc::RendererFactory
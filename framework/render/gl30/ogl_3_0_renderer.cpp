@@ -1,11 +1,13 @@
 #include "library/sp.h"
 #include "framework/renderer_interface.h"
 #include "framework/logger.h"
+#include "framework/metrics.h"
 #include "framework/image.h"
 #include "framework/palette.h"
 #include "framework/trace.h"
-#include <memory>
+#include <algorithm>
 #include <array>
+#include <memory>
 
 namespace
 {
@@ -20,6 +22,9 @@ namespace
 
 using namespace OpenApoc;
 
+MetricCounter &drawCallCount = Metrics::counter("Renderer.DrawCalls");
+MetricCounter &flushCount = Metrics::counter("Renderer.Flushes");
+
 class Program
 {
   public:
@@ -231,12 +236,13 @@ const char *PaletteProgram_fragmentSource = {
     "in vec2 texcoord;\n"
     "uniform isampler2D tex;\n"
     "uniform sampler2D pal;\n"
+    "uniform int paletteRow;\n"
     "uniform vec4 tint;\n"
     "out vec4 out_colour;\n"
     "void main() {\n"
     " int idx = texelFetch(tex, ivec2(texcoord.x, texcoord.y),0).r;\n"
     " if (idx == 0) discard;\n"
-    " out_colour = tint * texelFetch(pal, ivec2(idx,0),0);\n"
+    " out_colour = tint * texelFetch(pal, ivec2(idx,paletteRow),0);\n"
     "}\n"};
 class PaletteProgram : public SpriteProgram
 {
@@ -245,10 +251,12 @@ class PaletteProgram : public SpriteProgram
 	bool currentFlipY;
 	GLint currentTexUnit;
 	GLint currentPalUnit;
+	GLint currentPaletteRow = -1;
 	Colour currentTint;
 
   public:
 	GLint palLoc;
+	GLint paletteRowLoc;
 	PaletteProgram()
 	    : SpriteProgram(PaletteProgram_vertexSource, PaletteProgram_fragmentSource),
 	      currentScreenSize(0, 0), currentFlipY(false), currentTexUnit(0), currentPalUnit(0),
@@ -259,11 +267,20 @@ class PaletteProgram : public SpriteProgram
 		this->screenSizeLoc = gl::GetUniformLocation(this->prog, "screenSize");
 		this->texLoc = gl::GetUniformLocation(this->prog, "tex");
 		this->palLoc = gl::GetUniformLocation(this->prog, "pal");
+		this->paletteRowLoc = gl::GetUniformLocation(this->prog, "paletteRow");
 		this->flipYLoc = gl::GetUniformLocation(this->prog, "flipY");
 		this->tintLoc = gl::GetUniformLocation(this->prog, "tint");
 		if (this->tintLoc < 0)
 			LogError("\"tint\" uniform not found in shader");
 	}
+	void setPaletteRow(GLint row)
+	{
+		if (row != currentPaletteRow)
+		{
+			currentPaletteRow = row;
+			this->Uniform(this->paletteRowLoc, row);
+		}
+	}
 	void setUniforms(Vec2<int> screenSize, bool flipY, GLint texUnit = 0, GLint palUnit = 1,
 	                 Colour tint = {255, 255, 255, 255})
 	{
@@ -300,13 +317,16 @@ const char *PaletteSetProgram_vertexSource = {
     "in vec2 position;\n"
     "in vec2 texcoord_in;\n"
     "in int sprite_in;\n"
+    "in int palette_in;\n"
     "out vec2 texcoord;\n"
     "flat out int sprite;\n"
+    "flat out int palette;\n"
     "uniform vec2 screenSize;\n"
     "uniform bool flipY;\n"
     "void main() {\n"
     "  texcoord = texcoord_in;\n"
     "  sprite = sprite_in;\n"
+    "  palette = palette_in;\n"
     "  vec2 tmpPos = position;\n"
     "  tmpPos /= screenSize;\n"
     "  tmpPos -= vec2(0.5,0.5);\n"
@@ -317,6 +337,7 @@ const char *PaletteSetProgram_fragmentSource = {
     "#version 130\n"
     "in vec2 texcoord;\n"
     "flat in int sprite;\n"
+    "flat in int palette;\n"
     "uniform isampler2DArray tex;\n"
     "uniform sampler2D pal;\n"
     "uniform vec4 tint;\n"
@@ -324,7 +345,7 @@ const char *PaletteSetProgram_fragmentSource = {
     "void main() {\n"
     " int idx = texelFetch(tex, ivec3(texcoord.x, texcoord.y, sprite), 0).r;\n"
     " if (idx == 0) discard;\n"
-    " out_colour = tint * texelFetch(pal, ivec2(idx,0), 0);\n"
+    " out_colour = tint * texelFetch(pal, ivec2(idx,palette), 0);\n"
     "}\n"};
 class PaletteSetProgram : public Program
 {
@@ -339,6 +360,7 @@ class PaletteSetProgram : public Program
 	GLuint posLoc;
 	GLuint texcoordLoc;
 	GLuint spriteLoc;
+	GLuint paletteLoc;
 	GLuint screenSizeLoc;
 	GLuint texLoc;
 	GLuint palLoc;
@@ -352,6 +374,7 @@ class PaletteSetProgram : public Program
 		this->posLoc = gl::GetAttribLocation(this->prog, "position");
 		this->texcoordLoc = gl::GetAttribLocation(this->prog, "texcoord_in");
 		this->spriteLoc = gl::GetAttribLocation(this->prog, "sprite_in");
+		this->paletteLoc = gl::GetAttribLocation(this->prog, "palette_in");
 
 		this->screenSizeLoc = gl::GetUniformLocation(this->prog, "screenSize");
 		this->texLoc = gl::GetUniformLocation(this->prog, "tex");
@@ -525,12 +548,14 @@ class Quad
 		gl::EnableVertexAttribArray(texcoordAttribPos);
 		gl::VertexAttribPointer(texcoordAttribPos, 2, gl::FLOAT, gl::FALSE_, 0, &texcoords);
 		gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
+		drawCallCount.add();
 	}
 	void draw(GLuint vertexAttribPos)
 	{
 		gl::EnableVertexAttribArray(vertexAttribPos);
 		gl::VertexAttribPointer(vertexAttribPos, 2, gl::FLOAT, gl::FALSE_, 0, &vertices);
 		gl::DrawArrays(gl::TRIANGLE_STRIP, 0, 4);
+		drawCallCount.add();
 	}
 };
 class Line
@@ -548,6 +573,7 @@ class Line
 		gl::EnableVertexAttribArray(vertexAttribPos);
 		gl::VertexAttribPointer(vertexAttribPos, 2, gl::FLOAT, gl::FALSE_, 0, &vertices);
 		gl::DrawArrays(gl::LINES, 0, 2);
+		drawCallCount.add();
 	}
 };
 class ActiveTexture
@@ -738,13 +764,17 @@ class GLRGBImage : public RendererImageData
 	virtual ~GLRGBImage() { gl::DeleteTextures(1, &this->texID); }
 };
 
-class GLPalette : public RendererImageData
+// Every palette in use is uploaded to a row of one texture, so which palette a sprite is drawn
+// with is just an index. Sprites using different palettes can then share a batch.
+class PaletteTable
 {
   public:
+	static const int Width = 256;
+	static const int Rows = 256;
 	GLuint texID;
-	Vec2<float> size;
-	std::weak_ptr<Palette> parent;
-	GLPalette(sp<Palette> parent) : size(Vec2<float>(parent->colours.size(), 1)), parent(parent)
+	std::vector<GLint> freeRows;
+
+	PaletteTable()
 	{
 		TRACE_FN;
 		gl::GenTextures(1, &this->texID);
@@ -753,10 +783,54 @@ class GLPalette : public RendererImageData
 		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
 		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE);
 		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE);
-		gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA, parent->colours.size(), 1, 0, gl::RGBA,
-		               gl::UNSIGNED_BYTE, parent->colours.data());
+		gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA8, Width, Rows, 0, gl::RGBA, gl::UNSIGNED_BYTE,
+		               NULL);
+		for (GLint row = Rows - 1; row >= 0; row--)
+		{
+			freeRows.push_back(row);
+		}
+	}
+	~PaletteTable() { gl::DeleteTextures(1, &this->texID); }
+
+	// Returns -1 if every row is in use
+	GLint allocate(const Palette &palette)
+	{
+		if (freeRows.empty())
+		{
+			return -1;
+		}
+		GLint row = freeRows.back();
+		freeRows.pop_back();
+		BindTexture b(this->texID);
+		GLsizei count = std::min(static_cast<GLsizei>(palette.colours.size()), Width);
+		gl::TexSubImage2D(gl::TEXTURE_2D, 0, 0, row, count, 1, gl::RGBA, gl::UNSIGNED_BYTE,
+		                  palette.colours.data());
+		return row;
+	}
+	void release(GLint row) { freeRows.push_back(row); }
+};
+
+class GLPalette : public RendererImageData
+{
+  public:
+	sp<PaletteTable> table;
+	GLint row;
+	bool ownsRow;
+	std::weak_ptr<Palette> parent;
+	GLPalette(sp<PaletteTable> table, sp<Palette> parent)
+	    : table(table), row(table->allocate(*parent)), ownsRow(row >= 0), parent(parent)
+	{
+		if (!ownsRow)
+		{
+			LogError("Palette table full, drawing with the first palette instead");
+			row = 0;
+		}
+	}
+	virtual ~GLPalette()
+	{
+		if (ownsRow)
+			table->release(row);
 	}
-	virtual ~GLPalette() { gl::DeleteTextures(1, &this->texID); }
 };
 
 class GLPaletteImage : public RendererImageData
@@ -841,6 +915,20 @@ class OGL30Renderer : public Renderer
 
 	sp<Surface> currentSurface;
 	sp<Palette> currentPalette;
+	sp<PaletteTable> paletteTable;
+
+	// The palette table row for 'p', uploading it the first time it's used
+	GLint getPaletteRow(const sp<Palette> &p)
+	{
+		if (!p->rendererPrivateData)
+			p->rendererPrivateData.reset(new GLPalette(this->paletteTable, p));
+		return static_cast<GLPalette *>(p->rendererPrivateData.get())->row;
+	}
+	// Images bound to a palette are drawn with it regardless of the current one
+	GLint getPaletteRow(const PaletteImage &img)
+	{
+		return getPaletteRow(img.palette ? img.palette : this->currentPalette);
+	}
 
 	friend class RendererSurfaceBinding;
 	virtual void setSurface(sp<Surface> s) override
@@ -870,9 +958,8 @@ class OGL30Renderer : public Renderer
 	{
 		if (p == this->currentPalette)
 			return;
-		this->flush();
-		if (!p->rendererPrivateData)
-			p->rendererPrivateData.reset(new GLPalette(p));
+		// Batched sprites carry their own palette row, so nothing needs flushing
+		this->getPaletteRow(p);
 		this->currentPalette = p;
 	}
 	virtual sp<Palette> getPalette() override { return this->currentPalette; }
@@ -929,13 +1016,15 @@ class OGL30Renderer : public Renderer
 				img = new GLPaletteImage(paletteImage);
 				image->rendererPrivateData.reset(img);
 			}
-			if (scaler != Scaler::Nearest)
+			// Images bound to a palette used to be loaded as RGB, so callers may still ask for
+			// linear scaling. They're drawn nearest like any other paletted image.
+			if (scaler != Scaler::Nearest && !paletteImage->palette)
 			{
 				// blending indices doesn't make sense. You'll have to render
 				// it to an RGB surface then scale that
 				LogError("Only nearest scaler is supported on paletted images");
 			}
-			DrawPalette(*img, position, size);
+			DrawPalette(*img, position, size, getPaletteRow(*paletteImage));
 			return;
 		}
 
@@ -983,13 +1072,15 @@ class OGL30Renderer : public Renderer
 				img = new GLPaletteImage(paletteImage);
 				i->rendererPrivateData.reset(img);
 			}
-			if (scaler != Scaler::Nearest)
+			// Images bound to a palette used to be loaded as RGB, so callers may still ask for
+			// linear scaling. They're drawn nearest like any other paletted image.
+			if (scaler != Scaler::Nearest && !paletteImage->palette)
 			{
 				// blending indices doesn't make sense. You'll have to render
 				// it to an RGB surface then scale that
 				LogError("Only nearest scaler is supported on paletted images");
 			}
-			DrawPalette(*img, position, size, tint);
+			DrawPalette(*img, position, size, getPaletteRow(*paletteImage), tint);
 			return;
 		}
 
@@ -1127,7 +1218,7 @@ class OGL30Renderer : public Renderer
 		q.draw(rgbProgram->posLoc, rgbProgram->texcoordLoc);
 	}
 
-	void DrawPalette(GLPaletteImage &img, Vec2<float> offset, Vec2<float> size,
+	void DrawPalette(GLPaletteImage &img, Vec2<float> offset, Vec2<float> size, GLint paletteRow,
 	                 Colour tint = {255, 255, 255, 255})
 	{
 		BindProgram(paletteProgram);
@@ -1136,10 +1227,9 @@ class OGL30Renderer : public Renderer
 		if (currentBoundFBO == 0)
 			flipY = true;
 		paletteProgram->setUniforms(this->currentSurface->size, flipY, 0, 1, tint);
+		paletteProgram->setPaletteRow(paletteRow);
 		BindTexture t(img.texID, 0);
-
-		BindTexture p(
-		    static_cast<GLPalette *>(this->currentPalette->rendererPrivateData.get())->texID, 1);
+		BindTexture p(this->paletteTable->texID, 1);
 		Quad q(pos, Rect<float>{{0, 0}, {img.size}});
 		q.draw(paletteProgram->posLoc, paletteProgram->texcoordLoc);
 	}
@@ -1203,28 +1293,30 @@ class OGL30Renderer : public Renderer
 		Vec2<float> position;
 		Vec2<float> texCoord;
 		int spriteIdx;
+		int paletteRow;
 		BatchedVertex() {}
-		BatchedVertex(Vec2<float> p, Vec2<float> tc, int i)
-		    : position(p), texCoord(tc), spriteIdx(i)
+		BatchedVertex(Vec2<float> p, Vec2<float> tc, int i, int palette)
+		    : position(p), texCoord(tc), spriteIdx(i), paletteRow(palette)
 		{
 		}
 	};
-	static_assert(sizeof(BatchedVertex) == 20, "BatchedVertex unexpected size");
+	static_assert(sizeof(BatchedVertex) == 24, "BatchedVertex unexpected size");
 
 	class BatchedSprite
 	{
 	  public:
 		std::array<BatchedVertex, 4> vertices;
-		BatchedSprite(Vec2<float> screenPosition, Vec2<float> spriteSize, int spriteIdx)
+		BatchedSprite(Vec2<float> screenPosition, Vec2<float> spriteSize, int spriteIdx,
+		              int paletteRow)
 		{
 			Vec2<float> maxTexCoords = spriteSize;
 			Vec2<float> maxPosition = screenPosition + spriteSize;
-			vertices[0] = BatchedVertex{screenPosition, Vec2<float>{0, 0}, spriteIdx};
+			vertices[0] = BatchedVertex{screenPosition, Vec2<float>{0, 0}, spriteIdx, paletteRow};
 			vertices[1] = BatchedVertex{Vec2<float>{screenPosition.x, maxPosition.y},
-			                            Vec2<float>{0, maxTexCoords.y}, spriteIdx};
+			                            Vec2<float>{0, maxTexCoords.y}, spriteIdx, paletteRow};
 			vertices[2] = BatchedVertex{Vec2<float>{maxPosition.x, screenPosition.y},
-			                            Vec2<float>{maxTexCoords.x, 0}, spriteIdx};
-			vertices[3] = BatchedVertex{maxPosition, maxTexCoords, spriteIdx};
+			                            Vec2<float>{maxTexCoords.x, 0}, spriteIdx, paletteRow};
+			vertices[3] = BatchedVertex{maxPosition, maxTexCoords, spriteIdx, paletteRow};
 		}
 	};
 	static_assert(sizeof(BatchedSprite) == sizeof(BatchedVertex) * 4,
@@ -1234,6 +1326,8 @@ class OGL30Renderer : public Renderer
 	unsigned maxBatchedSprites;
 	unsigned maxSpritesheetSize;
 	sp<GLPaletteSpritesheet> boundSpritesheet;
+	// Keeps the palettes used by the batch (and so their table rows) alive until it's drawn
+	std::vector<sp<Palette>> batchedPalettes;
 
 	std::unique_ptr<GLint[]> firstList;
 	std::unique_ptr<GLsizei[]> countList;
@@ -1246,12 +1340,12 @@ class OGL30Renderer : public Renderer
 			flipY = true;
 		paletteSetProgram->setUniforms(this->currentSurface->size, flipY);
 		BindTexture t(this->boundSpritesheet->texID, 0, gl::TEXTURE_2D_ARRAY);
-		BindTexture p(
-		    static_cast<GLPalette *>(this->currentPalette->rendererPrivateData.get())->texID, 1);
+		BindTexture p(this->paletteTable->texID, 1);
 
 		gl::EnableVertexAttribArray(paletteSetProgram->posLoc);
 		gl::EnableVertexAttribArray(paletteSetProgram->texcoordLoc);
 		gl::EnableVertexAttribArray(paletteSetProgram->spriteLoc);
+		gl::EnableVertexAttribArray(paletteSetProgram->paletteLoc);
 
 		const char *vertexPtr = reinterpret_cast<const char *>(this->batchedSprites.data());
 
@@ -1263,11 +1357,15 @@ class OGL30Renderer : public Renderer
 		                        vertexPtr + offsetof(BatchedVertex, texCoord));
 		gl::VertexAttribIPointer(paletteSetProgram->spriteLoc, 1, gl::INT, sizeof(BatchedVertex),
 		                         vertexPtr + offsetof(BatchedVertex, spriteIdx));
+		gl::VertexAttribIPointer(paletteSetProgram->paletteLoc, 1, gl::INT, sizeof(BatchedVertex),
+		                         vertexPtr + offsetof(BatchedVertex, paletteRow));
 
 		gl::MultiDrawArrays(gl::TRIANGLE_STRIP, this->firstList.get(), this->countList.get(),
 		                    this->batchedSprites.size());
+		drawCallCount.add();
 
 		this->batchedSprites.clear();
+		this->batchedPalettes.clear();
 		this->state = RendererState::Idle;
 	}
 };
@@ -1284,6 +1382,7 @@ OGL30Renderer::OGL30Renderer()
 	this->defaultSurface = mksp<Surface>(Vec2<int>{viewport[2], viewport[3]});
 	this->defaultSurface->rendererPrivateData.reset(new FBOData(0));
 	this->currentSurface = this->defaultSurface;
+	this->paletteTable = mksp<PaletteTable>();
 
 	GLint maxTexArrayLayers;
 	gl::GetIntegerv(gl::MAX_ARRAY_TEXTURE_LAYERS, &maxTexArrayLayers);
@@ -1356,8 +1455,15 @@ void OGL30Renderer::draw(sp<Image> image, Vec2<float> position)
 			}
 			this->boundSpritesheet = ss;
 			this->state = RendererState::BatchingSpritesheet;
+			// Everything in a spritesheet is a PaletteImage
+			auto &paletteImage = static_cast<PaletteImage &>(*image);
+			auto &palette = paletteImage.palette ? paletteImage.palette : this->currentPalette;
+			if (this->batchedPalettes.empty() || this->batchedPalettes.back() != palette)
+			{
+				this->batchedPalettes.push_back(palette);
+			}
 			this->batchedSprites.emplace_back(position, Vec2<float>(image->size.x, image->size.y),
-			                                  image->indexInSet);
+			                                  image->indexInSet, getPaletteRow(palette));
 			return;
 		}
 	}
@@ -1376,6 +1482,7 @@ void OGL30Renderer::flush()
 		case RendererState::Idle:
 			break;
 		case RendererState::BatchingSpritesheet:
+			flushCount.add();
 			this->DrawBatchedSpritesheet();
 			break;
 	}
@@ -22,6 +22,7 @@ class Renderer
 {
   private:
 	friend class RendererSurfaceBinding;
+	friend class DeferredRenderer;
 	virtual void setSurface(sp<Surface> s) = 0;
 	virtual sp<Surface> getSurface() = 0;
 
@@ -0,0 +1,59 @@
+#include "framework/resourcecache.h"
+
+namespace OpenApoc
+{
+
+ResourceCache::ResourceCache(size_t budget) : budget(budget), used(0) {}
+
+void ResourceCache::evict(size_t required)
+{
+	while (!entries.empty() && used + required > budget)
+	{
+		auto &entry = entries.back();
+		used -= entry.bytes;
+		index.erase(entry.resource.get());
+		entries.pop_back();
+		stats.evictions++;
+	}
+}
+
+void ResourceCache::pin(sp<void> resource, size_t bytes)
+{
+	auto it = index.find(resource.get());
+	if (it != index.end())
+	{
+		used -= it->second->bytes;
+		entries.erase(it->second);
+		index.erase(it);
+	}
+	if (bytes > budget)
+		return;
+	evict(bytes);
+	entries.push_front(Entry{resource, bytes});
+	index[resource.get()] = entries.begin();
+	used += bytes;
+}
+
+bool ResourceCache::touch(const void *resource)
+{
+	auto it = index.find(resource);
+	if (it == index.end())
+		return false;
+	entries.splice(entries.begin(), entries, it->second);
+	return true;
+}
+
+void ResourceCache::setBudget(size_t newBudget)
+{
+	budget = newBudget;
+	evict(0);
+}
+
+void ResourceCache::clear()
+{
+	entries.clear();
+	index.clear();
+	used = 0;
+}
+
+} // namespace OpenApoc
@@ -0,0 +1,65 @@
+#pragma once
+#include "library/sp.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+namespace OpenApoc
+{
+
+// Keeps the most recently used resources alive, limited by their approximate memory footprint
+// rather than by a count. Anything evicted stays usable for as long as something else holds a
+// reference to it, this only controls what's kept around when nothing does.
+class ResourceCache
+{
+  public:
+	class Stats
+	{
+	  public:
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		// Expired weak entries dropped from the lookup maps
+		uint64_t pruned = 0;
+	};
+
+  private:
+	class Entry
+	{
+	  public:
+		sp<void> resource;
+		size_t bytes;
+	};
+	// Most recently used at the front
+	std::list<Entry> entries;
+	// Entries are looked up by the resource itself, so different resource types can't collide
+	std::unordered_map<const void *, std::list<Entry>::iterator> index;
+	size_t budget;
+	size_t used;
+	Stats stats;
+
+	void evict(size_t required);
+
+  public:
+	ResourceCache(size_t budget);
+
+	// Pin 'resource' as the most recently used entry, evicting older ones to fit it in the budget.
+	// Resources larger than the whole budget are never pinned.
+	void pin(sp<void> resource, size_t bytes);
+	// Mark an already-pinned resource as used, returns false if it's not pinned
+	bool touch(const void *resource);
+	void setBudget(size_t budget);
+	void clear();
+
+	void recordHit() { stats.hits++; }
+	void recordMiss() { stats.misses++; }
+	void recordPruned(uint64_t count) { stats.pruned += count; }
+
+	size_t getBudget() const { return budget; }
+	size_t getUsed() const { return used; }
+	size_t getCount() const { return entries.size(); }
+	const Stats &getStats() const { return stats; }
+};
+
+} // namespace OpenApoc
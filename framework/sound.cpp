@@ -5,48 +5,31 @@
 #include "framework/sound_interface.h"
 #include <map>
 #include <memory>
-#include <limits>
-#include <array>
 
 namespace OpenApoc
 {
-static const std::array<std::pair<float, float>, 3> positionalAudioLUT = {{
-    std::make_pair(20.0f, 1.0f),   // Anything within 20.0f units is at full volume
-    std::make_pair(100.0f, 0.25f), // That then scales linearly down to 25% over the next 100 units
-    std::make_pair(std::numeric_limits<float>::max(), 0.25f) // Which does not decrease any further
-}};
+// Sounds closer than this to the listener play at full volume
+static const float fullVolumeDistance = 10.0f;
+// Beyond this they're not played at all, in between the gain falls off linearly
+static const float audibleDistance = 50.0f;
+// How far to one side a sound has to be to play only from that side
+static const float fullPanDistance = 20.0f;
 
 // Position is assumed to be in 'map' units
 void SoundBackend::playSample(sp<Sample> sample, Vec3<float> position)
 {
+	Vec3<float> offset = position - this->listenerPosition;
+	float distance = glm::length(offset);
+	if (distance >= audibleDistance)
+		return;
 
-	float distance = glm::length(position - this->listenerPosition);
-
-	/*FIXME: Quick hack at trying to get scaling based on the 3d location of the sample being
-	 * played*/
 	float gain = 1.0f;
+	if (distance > fullVolumeDistance)
+		gain = 1.0f - (distance - fullVolumeDistance) / (audibleDistance - fullVolumeDistance);
+	// The city is drawn isometrically, so screen left/right runs along x - y
+	float pan = glm::clamp((offset.x - offset.y) / fullPanDistance, -1.0f, 1.0f);
 
-	for (auto &lutEntry : positionalAudioLUT)
-	{
-		float lutDistance = lutEntry.first;
-		float lutGain = lutEntry.second;
-		if (distance <= lutDistance)
-		{
-			float factor = distance / lutDistance;
-			float newGain = mix(gain, lutGain, factor);
-			gain = newGain;
-			break;
-		}
-		else
-		{
-			gain = lutGain;
-			distance -= lutDistance;
-		}
-	}
-	LogInfo("Playing sample at {%f,%f,%f} - distance to camera %f, gain %f", position.x, position.y,
-	        position.z, distance, gain);
-	// Anything within CLOSE_RANGE is at full volume
-	this->playSample(sample, gain);
+	this->playSample(sample, gain, pan);
 }
 void SoundBackend::setListenerPosition(Vec3<float> position) { this->listenerPosition = position; }
 }; // namespace OpenApoc
@@ -69,6 +69,11 @@ class SoundBackend
   public:
 	virtual ~SoundBackend() {}
 	virtual void playSample(sp<Sample> sample, float gain = 1.0f) = 0;
+	/* Pan is from -1.0 (left) to 1.0 (right), backends that can't pan just play it centred */
+	virtual void playSample(sp<Sample> sample, float gain, float /*pan*/)
+	{
+		this->playSample(sample, gain);
+	}
 	virtual void playMusic(std::function<void(void *)> finishedCallback,
 	                       void *callbackData = nullptr) = 0;
 	virtual void stopMusic() = 0;
@@ -96,8 +101,17 @@ class SoundBackend
 	/* Any values outside the range 0..1 will be clamped */
 	virtual void setGain(Gain g, float v) = 0;
 
+	/* The most samples mixed at once, past this the quietest (then oldest) is replaced. Backends
+	 * that don't mix themselves can ignore this */
+	virtual void setMaxVoices(unsigned int) {}
+
+	/* Called by the framework once per frame. Backends that aren't driven by a sound card use it
+	 * to keep their output in step with the game */
+	virtual void advanceFrame() {}
+
 	Vec3<float> listenerPosition;
-	/* A quick attempt at 'positional' audio */
+	/* Attenuated and panned by the position relative to the listener, anything out of earshot
+	 * is dropped before it reaches the backend */
 	virtual void playSample(sp<Sample> sample, Vec3<float> position);
 	virtual void setListenerPosition(Vec3<float> position);
 };
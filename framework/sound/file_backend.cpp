@@ -0,0 +1,232 @@
+#include "library/sp.h"
+#include "framework/sound_interface.h"
+#include "framework/sound/mixer.h"
+#include "framework/framework.h"
+#include "framework/logger.h"
+#include "framework/metrics.h"
+#include "framework/trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+
+using namespace OpenApoc;
+
+// Runs the normal mixer on a virtual clock and writes the output to a WAV file instead of a
+// sound card, for benchmarking and testing audio without a device. With 'Audio.File.Paced' set
+// buffers are produced in real time, otherwise each game frame adds 1/FRAMES_PER_SECOND of a
+// second of audio however long the frame took, so samples line up with game time.
+class FileSoundBackend : public SoundBackend
+{
+	static const int Frequency = 22050;
+	static const int Channels = 2;
+	static const unsigned int BufferFrames = 512;
+	static const size_t FrameBytes = Channels * sizeof(int16_t);
+	// The RIFF size fields are 32 bit
+	static const uint64_t MaxDataBytes = std::numeric_limits<uint32_t>::max() - 36;
+
+	AudioFormat preferredFormat;
+	std::unique_ptr<SoundMixer> mixer;
+	UString path;
+	std::ofstream output;
+	uint64_t dataBytes;
+	bool paced;
+
+	std::thread clockThread;
+	// Protects gameFrames and shutdown waking the unpaced clock
+	std::mutex clockMutex;
+	std::condition_variable clockCondition;
+	uint64_t gameFrames;
+	std::atomic<bool> shutdown;
+
+	void writeule16(uint16_t val)
+	{
+		char bytes[2] = {static_cast<char>(val), static_cast<char>(val >> 8)};
+		output.write(bytes, 2);
+	}
+	void writeule32(uint32_t val)
+	{
+		writeule16(static_cast<uint16_t>(val));
+		writeule16(static_cast<uint16_t>(val >> 16));
+	}
+
+	// The sizes are left as 0 until the file is closed
+	void writeWAVHeader()
+	{
+		output.seekp(0);
+		output.write("RIFF", 4);
+		writeule32(static_cast<uint32_t>(36 + dataBytes));
+		output.write("WAVEfmt ", 8);
+		writeule32(16);
+		writeule16(1); // PCM
+		writeule16(Channels);
+		writeule32(Frequency);
+		writeule32(Frequency * FrameBytes);
+		writeule16(FrameBytes);
+		writeule16(16);
+		output.write("data", 4);
+		writeule32(static_cast<uint32_t>(dataBytes));
+	}
+
+	void clockLoop()
+	{
+		Trace::setThreadName("FileAudio");
+		std::vector<int16_t> buffer(BufferFrames * Channels);
+		std::vector<char> bytes(buffer.size() * sizeof(int16_t));
+		auto bufferDuration =
+		    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		        std::chrono::duration<double>(static_cast<double>(BufferFrames) / Frequency));
+		auto nextBuffer = std::chrono::steady_clock::now();
+		uint64_t mixedFrames = 0;
+		static auto &writtenSeconds = Metrics::gauge("Audio.File.Seconds");
+
+		while (!shutdown)
+		{
+			if (paced)
+			{
+				std::this_thread::sleep_until(nextBuffer);
+				nextBuffer += bufferDuration;
+			}
+			else
+			{
+				// Only mix as much audio as the game has run for
+				{
+					std::unique_lock<std::mutex> lock(clockMutex);
+					clockCondition.wait(lock, [this, mixedFrames] {
+						return shutdown ||
+						       gameFrames * Frequency / FRAMES_PER_SECOND >=
+						           mixedFrames + BufferFrames;
+					});
+				}
+				if (shutdown)
+					break;
+				// Mixing as soon as the game allows could still outrun the music decoder and
+				// count the buffer as an underrun, so give it a chance to catch up first
+				for (int i = 0; i < 100 && !mixer->musicReady(buffer.size()); i++)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			mixer->mix(buffer.data(), buffer.size());
+			mixedFrames += BufferFrames;
+			if (dataBytes + bytes.size() > MaxDataBytes)
+			{
+				if (output.is_open())
+				{
+					LogWarning("\"%s\" reached the WAV size limit, no more audio will be written",
+					           path.c_str());
+					writeWAVHeader();
+					output.close();
+				}
+				continue;
+			}
+			// WAV data is little endian
+			for (size_t i = 0; i < buffer.size(); i++)
+			{
+				bytes[i * 2] = static_cast<char>(buffer[i]);
+				bytes[i * 2 + 1] = static_cast<char>(static_cast<uint16_t>(buffer[i]) >> 8);
+			}
+			output.write(bytes.data(), bytes.size());
+			dataBytes += bytes.size();
+			writtenSeconds.set(static_cast<double>(dataBytes) / (Frequency * FrameBytes));
+		}
+	}
+
+  public:
+	FileSoundBackend(const UString &path, bool paced)
+	    : path(path), output(path.str(), std::ios::binary), dataBytes(0), paced(paced),
+	      gameFrames(0), shutdown(false)
+	{
+		preferredFormat.channels = Channels;
+		preferredFormat.format = AudioFormat::SampleFormat::PCM_SINT16;
+		preferredFormat.frequency = Frequency;
+		writeWAVHeader();
+		mixer.reset(new SoundMixer(Frequency, Channels, BufferFrames));
+		clockThread = std::thread(&FileSoundBackend::clockLoop, this);
+		LogInfo("Writing audio to \"%s\" (%s)", path.c_str(), paced ? "paced" : "unpaced");
+	}
+
+	bool isOpen() const { return output.good(); }
+
+	virtual void playSample(sp<Sample> sample, float gain) override
+	{
+		mixer->playSample(sample, gain, 0.0f);
+	}
+	virtual void playSample(sp<Sample> sample, float gain, float pan) override
+	{
+		mixer->playSample(sample, gain, pan);
+	}
+
+	virtual void setMaxVoices(unsigned int count) override { mixer->setMaxVoices(count); }
+
+	virtual void playMusic(std::function<void(void *)> finishedCallback,
+	                       void *callbackData) override
+	{
+		mixer->playMusic(finishedCallback, callbackData);
+	}
+
+	virtual void setTrack(sp<MusicTrack> track) override { mixer->setTrack(track); }
+
+	virtual void stopMusic() override { mixer->stopMusic(); }
+
+	virtual void advanceFrame() override
+	{
+		if (paced)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(clockMutex);
+			gameFrames++;
+		}
+		clockCondition.notify_one();
+	}
+
+	virtual ~FileSoundBackend()
+	{
+		this->stopMusic();
+		{
+			std::lock_guard<std::mutex> lock(clockMutex);
+			shutdown = true;
+		}
+		clockCondition.notify_one();
+		clockThread.join();
+		if (output.is_open())
+			writeWAVHeader();
+		LogInfo("Wrote %.2fs of audio to \"%s\"",
+		        static_cast<double>(dataBytes) / (Frequency * FrameBytes), path.c_str());
+		mixer->logStats();
+	}
+
+	virtual const AudioFormat &getPreferredFormat() { return preferredFormat; }
+
+	virtual float getGain(Gain g) override { return mixer->getGain(g); }
+	virtual void setGain(Gain g, float f) override { mixer->setGain(g, f); }
+};
+
+class FileSoundBackendFactory : public SoundBackendFactory
+{
+  public:
+	virtual SoundBackend *create() override
+	{
+		auto &settings = *Framework::getInstance().Settings;
+		auto path = settings.getString("Audio.File.Path");
+		auto *backend = new FileSoundBackend(path, settings.getBool("Audio.File.Paced"));
+		if (!backend->isOpen())
+		{
+			LogWarning("Failed to open \"%s\" for writing", path.c_str());
+			delete backend;
+			return nullptr;
+		}
+		return backend;
+	}
+
+	virtual ~FileSoundBackendFactory() {}
+};
+
+SoundBackendRegister<FileSoundBackendFactory> load_at_init_file_sound("File");
+
+}; // anonymous namespace
@@ -0,0 +1,515 @@
+#include "framework/sound/mixer.h"
+#include "framework/logger.h"
+#include "framework/metrics.h"
+#include "framework/trace.h"
+#include <SDL_audio.h>
+
+#include <chrono>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+// The sample converted to the mixer's output format
+class MixerSampleData : public BackendSampleData
+{
+  public:
+	unsigned char *sampleStart;
+	int sampleLen;
+
+	SDL_AudioCVT cvt;
+
+	MixerSampleData(sp<Sample> sample, int frequency, int channels) : sampleStart(0), sampleLen(0)
+	{
+		cvt.buf = nullptr;
+		SDL_AudioFormat sdlFormat;
+		int smplSize;
+		switch (sample->format.format)
+		{
+			case AudioFormat::SampleFormat::PCM_SINT16:
+				sdlFormat = AUDIO_S16LSB;
+				smplSize = 2;
+				break;
+			case AudioFormat::SampleFormat::PCM_UINT8:
+				sdlFormat = AUDIO_U8;
+				smplSize = 1;
+				break;
+			default:
+				LogWarning("Unknown sample format: %d", sample->format.format);
+				return;
+		}
+		Uint8 srcChannels = sample->format.channels;
+		SDL_BuildAudioCVT(&cvt, sdlFormat, srcChannels, sample->format.frequency, AUDIO_S16SYS,
+		                  channels, frequency);
+
+		cvt.len = smplSize * srcChannels * sample->sampleCount;
+
+		cvt.buf = (Uint8 *)SDL_malloc(cvt.len * cvt.len_mult);
+		SDL_memcpy(cvt.buf, sample->data.get(), cvt.len);
+		SDL_ConvertAudio(&cvt);
+		sampleStart = cvt.buf;
+		sampleLen = cvt.len_cvt;
+	}
+
+	virtual ~MixerSampleData() { SDL_free(cvt.buf); }
+};
+
+// The mixing kernels work on a 32-bit accumulator so any number of voices can be summed before a
+// single clamp. They're kept as plain loops over fixed-width types so the compiler vectorizes them.
+// 'volume' is 0..128, like SDL_MixAudioFormat.
+void mixAccumulate(int32_t *acc, const int16_t *src, size_t count, int32_t volume)
+{
+	for (size_t i = 0; i < count; i++)
+		acc[i] += src[i] * volume;
+}
+
+// As mixAccumulate, but over 'frames' interleaved stereo frames with separate channel volumes
+void mixAccumulateStereo(int32_t *acc, const int16_t *src, size_t frames, int32_t leftVolume,
+                         int32_t rightVolume)
+{
+	for (size_t i = 0; i < frames; i++)
+	{
+		acc[i * 2] += src[i * 2] * leftVolume;
+		acc[i * 2 + 1] += src[i * 2 + 1] * rightVolume;
+	}
+}
+
+void mixClamp(int16_t *out, const int32_t *acc, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		int32_t val = acc[i] >> 7;
+		out[i] = static_cast<int16_t>(std::min(32767, std::max(-32768, val)));
+	}
+}
+
+template <typename T> void atomicMax(std::atomic<T> &target, T value)
+{
+	T current = target.load(std::memory_order_relaxed);
+	while (current < value && !target.compare_exchange_weak(current, value))
+	{
+	}
+}
+
+} // anonymous namespace
+
+const unsigned int SoundMixer::VoicePoolSize;
+
+MusicRingBuffer::MusicRingBuffer(size_t minCapacity) : readPos(0), writePos(0)
+{
+	size_t capacity = 1;
+	while (capacity < minCapacity)
+		capacity <<= 1;
+	buffer.resize(capacity);
+	mask = capacity - 1;
+}
+
+void MusicRingBuffer::write(const uint8_t *src, size_t len)
+{
+	size_t pos = writePos.load(std::memory_order_relaxed);
+	size_t offset = pos & mask;
+	size_t first = std::min(len, buffer.size() - offset);
+	memcpy(buffer.data() + offset, src, first);
+	memcpy(buffer.data(), src + first, len - first);
+	writePos.store(pos + len, std::memory_order_release);
+}
+
+void MusicRingBuffer::skipTo(size_t pos)
+{
+	size_t current = readPos.load(std::memory_order_relaxed);
+	// Positions wrap, so compare the distance rather than the values
+	size_t distance = pos - current;
+	if (distance != 0 && distance <= capacity())
+		readPos.store(pos, std::memory_order_release);
+}
+
+SoundMixer::SoundMixer(int frequency, int channels, unsigned int blockFrames)
+    : frequency(frequency), channels(channels), maxVoices(VoicePoolSize), voicesStarted(0),
+      musicCallbackData(nullptr), musicPaused(true), musicHasTrack(false), musicFlushPos(0),
+      musicShutdown(false), statBuffers(0), statUnderruns(0), statMixTimeNs(0),
+      statMaxMixTimeNs(0), statVoiceTotal(0), statPeakVoices(0), statStolenVoices(0),
+      statDroppedSamples(0)
+{
+	mixVolumes.musicVolume = 1.0f;
+	mixVolumes.soundVolume = 1.0f;
+	mixVolumes.overallVolume = 1.0f;
+	// Buffer up to a quarter of a second of music
+	musicRing.reset(new MusicRingBuffer(frequency * channels * sizeof(int16_t) / 4));
+	mixBuffer.resize(std::max(1u, blockFrames * channels));
+	musicThread = std::thread(&SoundMixer::musicDecodeLoop, this);
+}
+
+SoundMixer::~SoundMixer()
+{
+	this->stopMusic();
+	{
+		std::lock_guard<std::mutex> lock(musicMutex);
+		musicShutdown = true;
+	}
+	musicCondition.notify_one();
+	musicThread.join();
+	for (auto &voice : voices)
+		voice.sample.reset();
+	collectFinishedSamples();
+}
+
+void SoundMixer::musicDecodeLoop()
+{
+	Trace::setThreadName("Music");
+	std::vector<uint8_t> decodeBuffer;
+	SDL_AudioCVT cvt;
+	AudioFormat cvtFormat = {0, 0, AudioFormat::SampleFormat::PCM_UINT8};
+	sp<MusicTrack> decodingTrack;
+
+	std::unique_lock<std::mutex> lock(musicMutex);
+	while (!musicShutdown)
+	{
+		if (!track || musicPaused)
+		{
+			musicCondition.wait_for(lock, std::chrono::milliseconds(50));
+			continue;
+		}
+		if (track != decodingTrack)
+		{
+			decodingTrack = track;
+			if (decodingTrack->format != cvtFormat)
+			{
+				cvtFormat = decodingTrack->format;
+				SDL_AudioFormat sdlFormat =
+				    cvtFormat.format == AudioFormat::SampleFormat::PCM_SINT16 ? AUDIO_S16LSB
+				                                                             : AUDIO_U8;
+				if (SDL_BuildAudioCVT(&cvt, sdlFormat, cvtFormat.channels, cvtFormat.frequency,
+				                      AUDIO_S16SYS, channels, frequency) < 0)
+				{
+					LogError("Unable to convert music track \"%s\": %s",
+					         decodingTrack->getName().c_str(), SDL_GetError());
+					musicPaused = true;
+					cvtFormat = {0, 0, AudioFormat::SampleFormat::PCM_UINT8};
+					decodingTrack = nullptr;
+					continue;
+				}
+			}
+		}
+
+		int sampleSize = cvtFormat.format == AudioFormat::SampleFormat::PCM_SINT16 ? 2 : 1;
+		sampleSize *= cvtFormat.channels;
+		unsigned int chunkSamples = std::max(1u, decodingTrack->requestedSampleBufferSize);
+		// Keep each chunk small enough that there's always room for a couple in the ring
+		size_t maxChunkSamples = musicRing->capacity() / 2 / (sampleSize * cvt.len_mult);
+		chunkSamples = std::min<size_t>(chunkSamples, maxChunkSamples);
+		size_t chunkCapacity = chunkSamples * sampleSize * cvt.len_mult;
+		if (musicRing->space() < chunkCapacity)
+		{
+			// Wait for the mixer to drain some
+			musicCondition.wait_for(lock, std::chrono::milliseconds(10));
+			continue;
+		}
+		if (decodeBuffer.size() < chunkCapacity)
+			decodeBuffer.resize(chunkCapacity);
+
+		unsigned int returnedSamples = 0;
+		auto musReturn = decodingTrack->callback(decodingTrack, chunkSamples, decodeBuffer.data(),
+		                                         &returnedSamples);
+		cvt.buf = decodeBuffer.data();
+		cvt.len = returnedSamples * sampleSize;
+		SDL_ConvertAudio(&cvt);
+		musicRing->write(decodeBuffer.data(), cvt.len_cvt);
+
+		if (musReturn == MusicTrack::MusicCallbackReturn::End)
+		{
+			// The finished callback will usually set the next track, which takes the lock
+			auto finishedCallback = musicFinishedCallback;
+			auto callbackData = musicCallbackData;
+			lock.unlock();
+			finishedCallback(callbackData);
+			lock.lock();
+		}
+	}
+}
+
+void SoundMixer::releaseVoice(Voice &voice)
+{
+	// Moves the sample out, freeing the voice. finishedSamples can hold every sample that's in
+	// flight, so this never fails.
+	finishedSamples.push(voice.sample);
+}
+
+void SoundMixer::startVoices()
+{
+	static auto &droppedCounter = Metrics::counter("Audio.DroppedSamples");
+	static auto &stolenCounter = Metrics::counter("Audio.StolenVoices");
+	VoiceCommand command;
+	while (voiceCommands.pop(command))
+	{
+		Voice *freeVoice = nullptr;
+		Voice *victim = nullptr;
+		unsigned int active = 0;
+		for (auto &voice : voices)
+		{
+			if (!voice.sample)
+			{
+				if (!freeVoice)
+					freeVoice = &voice;
+				continue;
+			}
+			active++;
+			if (!victim || voice.gain < victim->gain ||
+			    (voice.gain == victim->gain && voice.age < victim->age))
+				victim = &voice;
+		}
+		if (active >= maxVoices || !freeVoice)
+		{
+			// Steal the quietest (then oldest) voice, unless the new sample is quieter still
+			if (!victim || command.gain < victim->gain)
+			{
+				statDroppedSamples++;
+				droppedCounter.add();
+				finishedSamples.push(command.sample);
+				continue;
+			}
+			statStolenVoices++;
+			stolenCounter.add();
+			releaseVoice(*victim);
+			freeVoice = victim;
+		}
+		auto *data = static_cast<MixerSampleData *>(command.sample->backendData.get());
+		freeVoice->pos = reinterpret_cast<const int16_t *>(data->sampleStart);
+		freeVoice->end = freeVoice->pos + data->sampleLen / sizeof(int16_t);
+		freeVoice->gain = command.gain;
+		freeVoice->pan = command.pan;
+		freeVoice->age = voicesStarted++;
+		freeVoice->sample = std::move(command.sample);
+	}
+}
+
+void SoundMixer::mix(int16_t *out, size_t count)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// Volumes are integers from 0-128, like SDL_MixAudioFormat
+	int musicVolume = lrint(mixVolumes.musicVolume * mixVolumes.overallVolume * 128.0f);
+	// globalSampleVolume needs to be attenuated by the per-sample gain before being scaled to
+	// 0..128
+	float globalSampleVolume = mixVolumes.soundVolume * mixVolumes.overallVolume;
+
+	startVoices();
+	unsigned int active = 0;
+	for (auto &voice : voices)
+	{
+		if (voice.sample)
+			active++;
+	}
+	musicRing->skipTo(musicFlushPos.load(std::memory_order_acquire));
+
+	bool musicPlaying = !musicPaused && musicHasTrack;
+	bool underrun = false;
+	size_t remaining = count;
+	while (remaining > 0)
+	{
+		size_t blockLen = std::min(remaining, mixBuffer.size());
+		int32_t *acc = mixBuffer.data();
+		std::fill(acc, acc + blockLen, 0);
+
+		if (musicPlaying)
+		{
+			// mix music first, if the decoder has fallen behind this just leaves a gap
+			int32_t *musicAcc = acc;
+			size_t musicBytes =
+			    musicRing->read(blockLen * sizeof(int16_t),
+			                    [&musicAcc, musicVolume](const uint8_t *data, size_t size) {
+				                    size_t samples = size / sizeof(int16_t);
+				                    mixAccumulate(musicAcc, reinterpret_cast<const int16_t *>(data),
+				                                  samples, musicVolume);
+				                    musicAcc += samples;
+				                });
+			if (musicBytes < blockLen * sizeof(int16_t))
+				underrun = true;
+		}
+
+		for (auto &voice : voices)
+		{
+			if (!voice.sample)
+				continue;
+			size_t samples = std::min<size_t>(blockLen, voice.end - voice.pos);
+			float sampleVolume = globalSampleVolume * voice.gain * 128.0f;
+			if (channels == 2)
+			{
+				// Full volume on the near side, fading out on the far side
+				int leftVolume = lrint(sampleVolume * std::min(1.0f, 1.0f - voice.pan));
+				int rightVolume = lrint(sampleVolume * std::min(1.0f, 1.0f + voice.pan));
+				mixAccumulateStereo(acc, voice.pos, samples / 2, leftVolume, rightVolume);
+			}
+			else
+			{
+				mixAccumulate(acc, voice.pos, samples, lrint(sampleVolume));
+			}
+			voice.pos += samples;
+			if (voice.pos == voice.end)
+				releaseVoice(voice);
+		}
+
+		mixClamp(out, acc, blockLen);
+		out += blockLen;
+		remaining -= blockLen;
+	}
+	if (musicPlaying)
+		musicCondition.notify_one();
+
+	uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	                       std::chrono::steady_clock::now() - start)
+	                       .count();
+	statBuffers++;
+	if (underrun)
+		statUnderruns++;
+	statMixTimeNs += elapsed;
+	atomicMax(statMaxMixTimeNs, elapsed);
+	statVoiceTotal += active;
+	atomicMax(statPeakVoices, active);
+
+	static auto &voicesGauge = Metrics::gauge("Audio.Voices");
+	static auto &mixTime = Metrics::histogram("Audio.MixTimeMs");
+	static auto &bufferCounter = Metrics::counter("Audio.Buffers");
+	static auto &underrunCounter = Metrics::counter("Audio.Underruns");
+	voicesGauge.set(active);
+	mixTime.record(elapsed / 1000000.0f);
+	bufferCounter.add();
+	if (underrun)
+		underrunCounter.add();
+}
+
+bool SoundMixer::musicReady(size_t count) const
+{
+	if (musicPaused || !musicHasTrack)
+		return true;
+	return musicRing->available() >= count * sizeof(int16_t);
+}
+
+void SoundMixer::collectFinishedSamples()
+{
+	sp<Sample> finished;
+	while (finishedSamples.pop(finished))
+		finished.reset();
+}
+
+void SoundMixer::playSample(sp<Sample> sample, float gain, float pan)
+{
+	// Clamp to 0..1 and -1..1
+	gain = std::min(1.0f, std::max(0.0f, gain));
+	pan = std::min(1.0f, std::max(-1.0f, pan));
+	std::lock_guard<std::mutex> lock(voiceCommandMutex);
+	this->collectFinishedSamples();
+	if (!sample->backendData)
+	{
+		sample->backendData.reset(new MixerSampleData(sample, frequency, channels));
+	}
+	VoiceCommand command{sample, gain, pan};
+	// If the mixer is this far behind there's no point queueing more
+	if (!voiceCommands.push(command))
+	{
+		static auto &droppedCounter = Metrics::counter("Audio.DroppedSamples");
+		statDroppedSamples++;
+		droppedCounter.add();
+	}
+}
+
+void SoundMixer::setMaxVoices(unsigned int count)
+{
+	maxVoices = std::max(1u, std::min(count, VoicePoolSize));
+	LogInfo("Mixing at most %u voices", maxVoices.load());
+}
+
+void SoundMixer::playMusic(std::function<void(void *)> finishedCallback, void *callbackData)
+{
+	{
+		std::lock_guard<std::mutex> lock(musicMutex);
+		musicFinishedCallback = finishedCallback;
+		musicCallbackData = callbackData;
+		musicPaused = false;
+	}
+	musicCondition.notify_one();
+}
+
+void SoundMixer::setTrack(sp<MusicTrack> track)
+{
+	std::lock_guard<std::mutex> lock(musicMutex);
+	LogInfo("Setting track to %p", track.get());
+	this->track = track;
+	musicHasTrack = track != nullptr;
+	// When called from the decoder's finished callback the new track carries straight on from the
+	// old one, otherwise drop whatever is still buffered from the previous track. The decoder only
+	// writes with musicMutex held, so everything up to the current position is the old track.
+	if (std::this_thread::get_id() != musicThread.get_id())
+		musicFlushPos.store(musicRing->writePosition(), std::memory_order_release);
+	musicCondition.notify_one();
+}
+
+void SoundMixer::stopMusic() { musicPaused = true; }
+
+float SoundMixer::getGain(SoundBackend::Gain g) const
+{
+	float reqGain = 0;
+	switch (g)
+	{
+		case SoundBackend::Gain::Global:
+			reqGain = mixVolumes.overallVolume;
+			break;
+		case SoundBackend::Gain::Sample:
+			reqGain = mixVolumes.soundVolume;
+			break;
+		case SoundBackend::Gain::Music:
+			reqGain = mixVolumes.musicVolume;
+			break;
+	}
+	return reqGain;
+}
+
+void SoundMixer::setGain(SoundBackend::Gain g, float f)
+{
+	// Clamp to 0..1
+	f = std::min(1.0f, std::max(0.0f, f));
+	switch (g)
+	{
+		case SoundBackend::Gain::Global:
+			mixVolumes.overallVolume = f;
+			break;
+		case SoundBackend::Gain::Sample:
+			mixVolumes.soundVolume = f;
+			break;
+		case SoundBackend::Gain::Music:
+			mixVolumes.musicVolume = f;
+			break;
+	}
+}
+
+SoundMixer::Stats SoundMixer::getStats() const
+{
+	Stats stats;
+	stats.buffers = statBuffers;
+	stats.underruns = statUnderruns;
+	stats.mixTimeNs = statMixTimeNs;
+	stats.maxMixTimeNs = statMaxMixTimeNs;
+	stats.voiceTotal = statVoiceTotal;
+	stats.peakVoices = statPeakVoices;
+	stats.stolenVoices = statStolenVoices;
+	stats.droppedSamples = statDroppedSamples;
+	return stats;
+}
+
+void SoundMixer::logStats() const
+{
+	auto stats = getStats();
+	if (stats.buffers == 0)
+		return;
+	LogInfo("Mixed %llu buffers: mean %.1fus max %.1fus per buffer, %llu underruns",
+	        static_cast<unsigned long long>(stats.buffers),
+	        stats.mixTimeNs / 1000.0 / stats.buffers, stats.maxMixTimeNs / 1000.0,
+	        static_cast<unsigned long long>(stats.underruns));
+	LogInfo("Voices: mean %.2f peak %u, %llu stolen, %llu dropped",
+	        static_cast<double>(stats.voiceTotal) / stats.buffers, stats.peakVoices,
+	        static_cast<unsigned long long>(stats.stolenVoices),
+	        static_cast<unsigned long long>(stats.droppedSamples));
+}
+
+} // namespace OpenApoc
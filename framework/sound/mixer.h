@@ -0,0 +1,222 @@
+#pragma once
+#include "library/sp.h"
+#include "framework/sound.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpenApoc
+{
+
+// Fixed-size single-producer single-consumer queue, used to pass samples between the game and
+// audio threads without locking
+template <typename T, size_t Capacity> class SPSCQueue
+{
+  private:
+	std::array<T, Capacity> items;
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+
+  public:
+	SPSCQueue() : head(0), tail(0) {}
+
+	// Producer only, returns false (leaving 'item' untouched) if the queue is full
+	bool push(T &item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+		items[t % Capacity] = std::move(item);
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only
+	bool pop(T &item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+		item = std::move(items[h % Capacity]);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+// Single-producer single-consumer byte queue. The music decoder thread writes converted audio and
+// the mixer reads it, neither side ever blocks or allocates.
+class MusicRingBuffer
+{
+  private:
+	std::vector<uint8_t> buffer;
+	// Capacity is a power of two so the positions can just keep counting up and wrap
+	size_t mask;
+	std::atomic<size_t> readPos;
+	std::atomic<size_t> writePos;
+
+  public:
+	MusicRingBuffer(size_t minCapacity);
+
+	size_t capacity() const { return buffer.size(); }
+	size_t available() const
+	{
+		return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+	}
+	size_t space() const { return capacity() - available(); }
+	size_t writePosition() const { return writePos.load(std::memory_order_acquire); }
+
+	// Producer only, 'len' must be <= space()
+	void write(const uint8_t *src, size_t len);
+
+	// Consumer only, calls fn(data, len) on up to two contiguous spans totalling at most 'maxLen'
+	// bytes and returns the number of bytes consumed
+	template <typename Fn> size_t read(size_t maxLen, Fn fn)
+	{
+		size_t pos = readPos.load(std::memory_order_relaxed);
+		size_t len = std::min(maxLen, writePos.load(std::memory_order_acquire) - pos);
+		size_t offset = pos & mask;
+		size_t first = std::min(len, buffer.size() - offset);
+		if (first)
+			fn(buffer.data() + offset, first);
+		if (len - first)
+			fn(buffer.data(), len - first);
+		readPos.store(pos + len, std::memory_order_release);
+		return len;
+	}
+
+	// Consumer only, drop everything before the producer position 'pos'
+	void skipTo(size_t pos);
+};
+
+// The software mixer shared by the sound backends. Samples are mixed through a fixed pool of
+// voices and music is decoded on a background thread, so mix() never blocks or allocates. The
+// output is always interleaved signed 16-bit at the frequency and channel count given.
+class SoundMixer
+{
+  public:
+	// The most voices that can ever play at once, setMaxVoices() can only lower this
+	static const unsigned int VoicePoolSize = 128;
+	// How many playSample() calls can be waiting for the mixer before more are dropped
+	static const unsigned int VoiceCommandCapacity = 256;
+
+	class Stats
+	{
+	  public:
+		uint64_t buffers = 0;
+		// Buffers where music was playing but the decoder hadn't kept up
+		uint64_t underruns = 0;
+		uint64_t mixTimeNs = 0;
+		uint64_t maxMixTimeNs = 0;
+		// Sum of the voices playing in each buffer, divide by 'buffers' for the mean
+		uint64_t voiceTotal = 0;
+		unsigned int peakVoices = 0;
+		uint64_t stolenVoices = 0;
+		uint64_t droppedSamples = 0;
+	};
+
+  private:
+	class VoiceCommand
+	{
+	  public:
+		sp<Sample> sample;
+		float gain;
+		float pan;
+	};
+
+	class Voice
+	{
+	  public:
+		// Null when the voice is free
+		sp<Sample> sample;
+		const int16_t *pos;
+		const int16_t *end;
+		float gain;
+		// -1.0 (left) to 1.0 (right), only used for stereo output
+		float pan;
+		// Order the voice was started in, the oldest of the quietest voices is stolen first
+		uint64_t age;
+	};
+
+	int frequency;
+	int channels;
+
+	struct
+	{
+		float overallVolume;
+		float musicVolume;
+		float soundVolume;
+	} mixVolumes;
+
+	// Sample voices are only touched by the mixing thread. New samples arrive through
+	// voiceCommands, and finished ones are handed back through finishedSamples so the last
+	// reference is never dropped (and the sample freed) while mixing. playSample() empties
+	// finishedSamples before queueing anything, so it never holds more than every voice and
+	// queued command at once and pushing to it can't fail.
+	std::array<Voice, VoicePoolSize> voices;
+	SPSCQueue<VoiceCommand, VoiceCommandCapacity> voiceCommands;
+	SPSCQueue<sp<Sample>, VoicePoolSize + VoiceCommandCapacity> finishedSamples;
+	// Serialises producers of voiceCommands, never taken while mixing
+	std::mutex voiceCommandMutex;
+	std::atomic<unsigned int> maxVoices;
+	uint64_t voicesStarted;
+	std::vector<int32_t> mixBuffer;
+
+	// Music is decoded and converted to the output format on its own thread, so mixing only has to
+	// copy what's already in the ring buffer.
+	std::unique_ptr<MusicRingBuffer> musicRing;
+	std::thread musicThread;
+	// Protects track, the finished callback and musicShutdown, held by the decoder while it decodes
+	std::mutex musicMutex;
+	std::condition_variable musicCondition;
+	sp<MusicTrack> track;
+	std::function<void(void *)> musicFinishedCallback;
+	void *musicCallbackData;
+	std::atomic<bool> musicPaused;
+	std::atomic<bool> musicHasTrack;
+	// Ring position the mixer should skip to, set when a new track replaces the buffered one
+	std::atomic<size_t> musicFlushPos;
+	bool musicShutdown;
+
+	std::atomic<uint64_t> statBuffers;
+	std::atomic<uint64_t> statUnderruns;
+	std::atomic<uint64_t> statMixTimeNs;
+	std::atomic<uint64_t> statMaxMixTimeNs;
+	std::atomic<uint64_t> statVoiceTotal;
+	std::atomic<unsigned int> statPeakVoices;
+	std::atomic<uint64_t> statStolenVoices;
+	std::atomic<uint64_t> statDroppedSamples;
+
+	void musicDecodeLoop();
+	void releaseVoice(Voice &voice);
+	void startVoices();
+	void collectFinishedSamples();
+
+  public:
+	SoundMixer(int frequency, int channels, unsigned int blockFrames);
+	~SoundMixer();
+
+	// Fill 'count' interleaved samples, only ever called from a single thread
+	void mix(int16_t *out, size_t count);
+	// True if at least 'count' samples of music are buffered, or no music is playing
+	bool musicReady(size_t count) const;
+
+	void playSample(sp<Sample> sample, float gain, float pan);
+	void setMaxVoices(unsigned int count);
+
+	void playMusic(std::function<void(void *)> finishedCallback, void *callbackData);
+	void setTrack(sp<MusicTrack> track);
+	void stopMusic();
+
+	float getGain(SoundBackend::Gain g) const;
+	void setGain(SoundBackend::Gain g, float f);
+
+	Stats getStats() const;
+	void logStats() const;
+};
+
+} // namespace OpenApoc
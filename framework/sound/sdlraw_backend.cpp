@@ -1,197 +1,32 @@
 #include "library/sp.h"
 #include "framework/sound_interface.h"
+#include "framework/sound/mixer.h"
 #include "framework/logger.h"
 #include <SDL_audio.h>
 #include <SDL.h>
 
-#include <list>
-
 namespace
 {
 
-SDL_AudioSpec outputFormat;
-
 using namespace OpenApoc;
 
-struct SampleData
-{
-	unsigned char *samplePos;
-	float gain;
-	SampleData(unsigned char *samplePos, float gain) : samplePos(samplePos), gain(gain){};
-};
-
-class SDLSampleData : public BackendSampleData
-{
-  public:
-	std::list<SampleData> playingInfo;
-	unsigned char *sampleStart;
-	int sampleLen;
-	bool isFinished;
-
-	SDL_AudioCVT cvt;
-
-	SDLSampleData(sp<Sample> sample) : sampleStart(0), sampleLen(0), isFinished(false)
-	{
-		SDL_AudioFormat sdlFormat;
-		int smplSize;
-		switch (sample->format.format)
-		{
-			case AudioFormat::SampleFormat::PCM_SINT16:
-				sdlFormat = AUDIO_S16LSB;
-				smplSize = 2;
-				break;
-			case AudioFormat::SampleFormat::PCM_UINT8:
-				sdlFormat = AUDIO_U8;
-				smplSize = 1;
-				break;
-			default:
-				LogWarning("Unknown sample format: %d", sample->format.format);
-				return;
-		}
-		Uint8 srcChannels = sample->format.channels;
-		SDL_BuildAudioCVT(&cvt, sdlFormat, srcChannels, sample->format.frequency,
-		                  outputFormat.format, outputFormat.channels, outputFormat.freq);
-
-		cvt.len = smplSize * srcChannels * sample->sampleCount;
-
-		cvt.buf = (Uint8 *)SDL_malloc(cvt.len * cvt.len_mult);
-		SDL_memcpy(cvt.buf, sample->data.get(), cvt.len);
-		SDL_ConvertAudio(&cvt);
-		sampleStart = cvt.buf;
-		sampleLen = cvt.len_cvt;
-	}
-
-	virtual ~SDLSampleData() { SDL_free(cvt.buf); }
-};
-
 class SDLRawBackend : public SoundBackend
 {
 	AudioFormat preferredFormat;
-
-	struct
-	{
-		float overallVolume;
-		float musicVolume;
-		float soundVolume;
-	} mixVolumes;
-
-	sp<MusicTrack> track;
-	sp<Sample> musicSample;
-
-	std::list<sp<Sample>> sampleQueue;
+	SDL_AudioSpec outputFormat;
 	SDL_AudioDeviceID devID;
-
-	std::function<void(void *)> musicFinishedCallback;
-	void *musicCallbackData;
-
-	bool musicPaused;
+	std::unique_ptr<SoundMixer> mixer;
 
 	static void mixingCallback(void *userdata, Uint8 *stream, int len)
 	{
 		// pass "this" pointer as a user data pointer - might be useful?
 		SDLRawBackend *_this = reinterpret_cast<SDLRawBackend *>(userdata);
-		// initialize stream buffer
-		SDL_memset(stream, 0, len); // FIXME: Calculate silence value for current output format?
-		MusicTrack::MusicCallbackReturn musReturn = MusicTrack::MusicCallbackReturn::Continue;
-
-		// SDL_MixAudioFormat takes a volume integer from 0-128
-		int musicVolume =
-		    lrint(_this->mixVolumes.musicVolume * _this->mixVolumes.overallVolume * 128.0f);
-		// globalSampleVolume needs to be attenuated by the per-sample gain before being scaled to
-		// 0..128
-		float globalSampleVolume = _this->mixVolumes.soundVolume * _this->mixVolumes.overallVolume;
-
-		if (!_this->musicPaused)
-		{
-			// mix music first
-			if (!_this->musicSample.get())
-			{
-				int sampleSize;
-				switch (_this->track->format.format)
-				{
-					case AudioFormat::SampleFormat::PCM_SINT16:
-						sampleSize = 2;
-						break;
-					default:
-						LogWarning("Unknown sample format! Treating as UINT8");
-					case AudioFormat::SampleFormat::PCM_UINT8:
-						sampleSize = 1;
-						break;
-				}
-				sampleSize *= _this->track->format.channels;
-				_this->musicSample.reset(new Sample());
-				_this->musicSample->format = _this->track->format;
-				_this->musicSample->sampleCount = _this->track->sampleCount;
-				_this->musicSample->data.reset(
-				    new unsigned char[_this->musicSample->sampleCount * sampleSize]);
-				musReturn = _this->track->callback(_this->track, _this->musicSample->sampleCount,
-				                                   _this->musicSample->data.get(),
-				                                   &(_this->musicSample->sampleCount));
-				_this->musicSample->backendData.reset(new SDLSampleData(_this->musicSample));
-				SDLSampleData *musicData =
-				    static_cast<SDLSampleData *>(_this->musicSample->backendData.get());
-				musicData->playingInfo.push_back(SampleData{musicData->sampleStart, 1.0f});
-			}
-
-			SDLSampleData *musicData =
-			    static_cast<SDLSampleData *>(_this->musicSample->backendData.get());
-			int smplLen = (musicData->sampleStart + musicData->sampleLen) -
-			              musicData->playingInfo.front().samplePos;
-			int musLen = std::min(len, smplLen);
-
-			SDL_MixAudioFormat(stream, (Uint8 *)musicData->playingInfo.front().samplePos,
-			                   musicData->cvt.dst_format, musLen, musicVolume);
-			musicData->playingInfo.front().samplePos += musLen;
-
-			if (musicData->playingInfo.front().samplePos ==
-			    (musicData->sampleStart + musicData->sampleLen))
-			{
-				if (musReturn == MusicTrack::MusicCallbackReturn::End)
-				{
-					_this->musicFinishedCallback(_this->musicCallbackData);
-				}
-				_this->musicSample.reset();
-			}
-		}
-
-		// mix pending samples
-		auto sndIt = _this->sampleQueue.begin();
-		while (sndIt != _this->sampleQueue.end())
-		{
-			SDLSampleData *smplData = static_cast<SDLSampleData *>((*sndIt)->backendData.get());
-			auto smplIt = smplData->playingInfo.begin();
-			while (smplIt != smplData->playingInfo.end())
-			{
-				int smplLen = (smplData->sampleStart + smplData->sampleLen) -
-				              smplIt->samplePos; // Remaining length of sample
-				int mixLen = std::min(len, smplLen);
-				int sampleVolume = lrint(globalSampleVolume * smplIt->gain * 128.0f);
-				SDL_MixAudioFormat(stream, (Uint8 *)smplIt->samplePos, smplData->cvt.dst_format,
-				                   mixLen, sampleVolume);
-				smplIt->samplePos += mixLen;
-				if (smplIt->samplePos == (smplData->sampleStart + smplData->sampleLen))
-				{
-					smplIt = smplData->playingInfo.erase(smplIt);
-				}
-				else
-				{
-					++smplIt;
-				}
-			}
-
-			if (smplData->playingInfo.size() == 0) // Remove played sound
-			{
-				sndIt = _this->sampleQueue.erase(sndIt);
-			}
-			else
-			{
-				++sndIt;
-			}
-		}
+		// The output is always signed 16-bit
+		_this->mixer->mix(reinterpret_cast<int16_t *>(stream), len / sizeof(int16_t));
 	}
 
   public:
-	SDLRawBackend() : musicPaused(true)
+	SDLRawBackend()
 	{
 		SDL_Init(SDL_INIT_AUDIO);
 		preferredFormat.channels = 2;
@@ -210,7 +45,8 @@ class SDLRawBackend : public SoundBackend
 		const char *deviceName = SDL_GetAudioDeviceName(0, 0);
 		SDL_AudioSpec wantFormat;
 		wantFormat.channels = 2;
-		wantFormat.format = AUDIO_S16LSB;
+		// The mixer only handles signed 16-bit output, SDL converts from that if the device can't
+		wantFormat.format = AUDIO_S16SYS;
 		wantFormat.freq = 22050;
 		wantFormat.samples = 512;
 		wantFormat.callback = mixingCallback;
@@ -220,91 +56,46 @@ class SDLRawBackend : public SoundBackend
 		             // available
 		    0,       // capturing is not supported
 		    &wantFormat, &outputFormat,
-		    SDL_AUDIO_ALLOW_ANY_CHANGE); // hopefully we'll get a sane output format
-		mixVolumes.musicVolume = 1.0f;
-		mixVolumes.soundVolume = 1.0f;
-		mixVolumes.overallVolume = 1.0f;
+		    SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+		mixer.reset(new SoundMixer(outputFormat.freq, outputFormat.channels, outputFormat.samples));
 		SDL_PauseAudioDevice(devID, 0); // Run at once?
 	}
 	virtual void playSample(sp<Sample> sample, float gain) override
 	{
-		// Clamp to 0..1
-		gain = std::min(1.0f, std::max(0.0f, gain));
-		SDL_LockAudioDevice(devID);
-		if (!sample->backendData)
-		{
-			sample->backendData.reset(new SDLSampleData(sample));
-		}
-		SDLSampleData *data = static_cast<SDLSampleData *>(sample->backendData.get());
-		data->playingInfo.push_back(SampleData{data->sampleStart, gain});
-		sampleQueue.push_back(sample);
-		LogInfo("Placed sound %p on queue", sample.get());
-		SDL_UnlockAudioDevice(devID);
+		mixer->playSample(sample, gain, 0.0f);
 	}
+	virtual void playSample(sp<Sample> sample, float gain, float pan) override
+	{
+		mixer->playSample(sample, gain, pan);
+	}
+
+	virtual void setMaxVoices(unsigned int count) override { mixer->setMaxVoices(count); }
 
 	virtual void playMusic(std::function<void(void *)> finishedCallback,
 	                       void *callbackData) override
 	{
-		musicFinishedCallback = finishedCallback;
-		musicCallbackData = callbackData;
-		musicPaused = false;
+		mixer->playMusic(finishedCallback, callbackData);
 		LogInfo("Playing music on SDL backend");
 	}
 
-	virtual void setTrack(sp<MusicTrack> track) override
-	{
-		SDL_LockAudioDevice(devID);
-		LogInfo("Setting track to %p", track.get());
-		this->track = track;
-		SDL_UnlockAudioDevice(devID);
-	}
+	virtual void setTrack(sp<MusicTrack> track) override { mixer->setTrack(track); }
 
-	virtual void stopMusic() override { musicPaused = true; }
+	virtual void stopMusic() override { mixer->stopMusic(); }
 
 	virtual ~SDLRawBackend()
 	{
 		this->stopMusic();
+		// Stop the callback before the mixer goes away
 		SDL_CloseAudioDevice(devID);
+		mixer->logStats();
+		mixer.reset();
 		SDL_QuitSubSystem(SDL_INIT_AUDIO);
 	}
 
 	virtual const AudioFormat &getPreferredFormat() { return preferredFormat; }
 
-	virtual float getGain(Gain g) override
-	{
-		float reqGain = 0;
-		switch (g)
-		{
-			case Gain::Global:
-				reqGain = mixVolumes.overallVolume;
-				break;
-			case Gain::Sample:
-				reqGain = mixVolumes.soundVolume;
-				break;
-			case Gain::Music:
-				reqGain = mixVolumes.musicVolume;
-				break;
-		}
-		return reqGain;
-	}
-	virtual void setGain(Gain g, float f) override
-	{
-		// Clamp to 0..1
-		f = std::min(1.0f, std::max(0.0f, f));
-		switch (g)
-		{
-			case Gain::Global:
-				mixVolumes.overallVolume = f;
-				break;
-			case Gain::Sample:
-				mixVolumes.soundVolume = f;
-				break;
-			case Gain::Music:
-				mixVolumes.musicVolume = f;
-				break;
-		}
-		return;
-	}
+	virtual float getGain(Gain g) override { return mixer->getGain(g); }
+	virtual void setGain(Gain g, float f) override { mixer->setGain(g, f); }
 };
 
 class SDLRawBackendFactory : public SoundBackendFactory
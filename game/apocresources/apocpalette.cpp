@@ -11,16 +11,16 @@ sp<Palette> loadApocPalette(Data &data, const UString fileName)
 	auto f = data.fs.open(fileName);
 	if (!f)
 		return nullptr;
-	auto numEntries = f.size() / 3;
+	auto view = f.map();
+	if (!view)
+		return nullptr;
+	auto numEntries = view.size() / 3;
 	auto p = mksp<Palette>(numEntries);
 	for (unsigned int i = 0; i < numEntries; i++)
 	{
-		uint8_t colour[3];
+		const uint8_t *colour = view.data() + i * 3;
 		Colour c;
 
-		f.read(reinterpret_cast<char *>(&colour), 3);
-		if (!f)
-			break;
 		if (i == 0)
 			c = {0, 0, 0, 0};
 		else
@@ -89,15 +89,16 @@ sp<Palette> loadPCXPalette(Data &data, const UString fileName)
 		return nullptr;
 	}
 
-	PcxHeader header;
-
-	file.read(reinterpret_cast<char *>(&header), sizeof(header));
-	if (!file)
+	auto view = file.map();
+	if (!view)
 	{
-		LogInfo("File \"%s\" failed to read PCX header", fileName.c_str());
+		LogInfo("File \"%s\" failed to be read", fileName.c_str());
 		return nullptr;
 	}
 
+	PcxHeader header;
+	memcpy(&header, view.data(), sizeof(header));
+
 	if (header.Identifier != PcxIdentifier)
 	{
 		LogInfo("File \"%s\" doesn't have PCX header magic", fileName.c_str());
@@ -110,21 +111,16 @@ sp<Palette> loadPCXPalette(Data &data, const UString fileName)
 		return nullptr;
 	}
 
-	file.seekg(file.size() - (256 * 3));
+	// The palette is always the last 768 bytes of the file
+	const uint8_t *paletteData = view.data() + view.size() - (256 * 3);
 
 	auto p = mksp<Palette>(256);
 
 	for (unsigned int i = 0; i < 256; i++)
 	{
-		uint8_t colour[3];
+		const uint8_t *colour = paletteData + i * 3;
 		Colour c;
 
-		file.read(reinterpret_cast<char *>(&colour), 3);
-		if (!file)
-		{
-			LogWarning("Unexpected EOF at index %u", i);
-			return nullptr;
-		}
 		if (i == 0)
 			c = {0, 0, 0, 0};
 		else
@@ -20,24 +20,28 @@ LOFTemps::LOFTemps(IFile &datFile, IFile &tabFile)
 		return;
 	}
 
+	auto datView = datFile.map();
+	auto tabView = tabFile.map();
+	IFileCursor dat(datView);
+	IFileCursor tab(tabView);
+
 	uint32_t offset;
-	while (tabFile.readule32(offset))
+	while (tab.readule32(offset))
 	{
-		datFile.seekg(offset * 4, std::ios::beg);
-		if (!datFile)
+		if (!dat.seek(offset * 4))
 		{
 			LogError("Seeking beyond end of file reading offset %u", offset * 4);
 			return;
 		}
 
 		uint32_t width;
-		if (!datFile.readule32(width))
+		if (!dat.readule32(width))
 		{
 			LogError("Failed to read width");
 			return;
 		}
 		uint32_t height;
-		if (!datFile.readule32(height))
+		if (!dat.readule32(height))
 		{
 			LogError("Failed to read height");
 			return;
@@ -58,7 +62,7 @@ LOFTemps::LOFTemps(IFile &datFile, IFile &tabFile)
 			for (unsigned int x = 0; x < width; x += 32)
 			{
 				uint32_t bitmask;
-				if (!datFile.readule32(bitmask))
+				if (!dat.readule32(bitmask))
 				{
 					LogError("Failed to read bitmask at {%u,%u}", x, y);
 					return;
@@ -82,6 +86,8 @@ LOFTemps::LOFTemps(IFile &datFile, IFile &tabFile)
 	}
 }
 
+LOFTemps::LOFTemps(std::vector<sp<VoxelSlice>> slices) : slices(slices) {}
+
 sp<VoxelSlice> LOFTemps::getSlice(unsigned int idx)
 {
 	if (idx >= this->slices.size())
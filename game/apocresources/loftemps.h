@@ -14,6 +14,8 @@ class LOFTemps
 
   public:
 	LOFTemps(IFile &datFile, IFile &tabFile);
+	LOFTemps(std::vector<sp<VoxelSlice>> slices);
 	sp<VoxelSlice> getSlice(unsigned int idx);
+	unsigned int getSliceCount() const { return this->slices.size(); }
 };
 }; // namespace OpenApoc
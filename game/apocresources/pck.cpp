@@ -12,343 +12,326 @@ namespace OpenApoc
 namespace
 {
 
-typedef struct PCKCompression1ImageHeader
-{
-	uint8_t Reserved1;
-	uint8_t Reserved2;
-	uint16_t LeftMostPixel;
-	uint16_t RightMostPixel;
-	uint16_t TopMostPixel;
-	uint16_t BottomMostPixel;
-} PCKImageHeader;
-
-typedef struct PCKCompression1RowHeader
-{
-	// int16_t SkipPixels; -- Read seperately to get eof record
-	uint8_t ColumnToStartAt;
-	uint8_t PixelsInRow;
-	uint8_t BytesInRow;
-	uint8_t PaddingInRow;
-} PCKCompression1Header;
-
-class PCK
+// PCK and TAB files are mapped whole and decoded straight out of memory. Every image in a set is
+// decoded into a single contiguous index arena, with the bounds calculated as the rows are copied
+
+// The RLE data is stored as offsets into a 640-pixel wide buffer
+static const unsigned int PCK_STRIDE = 640;
+
+struct PCKRecord
 {
+	// Offset of the first row in the PCK
+	size_t offset;
+	Vec2<unsigned int> size;
+	// Only used by compression 1 (Left/Right/Bottom are the image header values)
+	unsigned int leftMostPixel;
+};
 
+class PCKDecoder
+{
   private:
-	void ProcessFile(Data &d, UString PckFilename, UString TabFilename, int Index);
-	void LoadVersion1Format(IFile &pck, IFile &tab, int Index);
-	void LoadVersion2Format(IFile &pck, IFile &tab, int Index);
+	IFileCursor pck;
+	IFileCursor tab;
+	const UString &name;
 
-  public:
-	PCK(Data &d, UString PckFilename, UString TabFilename);
-	~PCK();
+	std::vector<PCKRecord> records;
+	sp<std::vector<uint8_t>> arena;
 
-	std::vector<sp<PaletteImage>> images;
-};
-PCK::PCK(Data &d, UString PckFilename, UString TabFilename)
-{
-	ProcessFile(d, PckFilename, TabFilename, -1);
-}
+	size_t arenaOffset;
+	unsigned int minX, minY, maxX, maxY;
 
-PCK::~PCK() {}
+	bool scanVersion1Format();
+	bool scanVersion2Format();
+	bool decodeVersion1Format(const PCKRecord &record, uint8_t *dst);
+	bool decodeVersion2Format(const PCKRecord &record, uint8_t *dst);
 
-void PCK::ProcessFile(Data &d, UString PckFilename, UString TabFilename, int Index)
-{
-	auto pck = d.fs.open(PckFilename);
-	if (!pck)
-	{
-		LogError("Failed to open PCK file \"%s\"", PckFilename.c_str());
-		return;
-	}
-	auto tab = d.fs.open(TabFilename);
-	if (!tab)
+	// Copy 'count' indices to {x,y} in 'dst', clipped to the image width, and update the bounds
+	void copyRow(const PCKRecord &record, uint8_t *dst, unsigned int x, unsigned int y,
+	             const uint8_t *src, unsigned int count)
 	{
-		LogError("Failed to open TAB file \"%s\"", TabFilename.c_str());
-		return;
-	}
+		if (x >= record.size.x || y >= record.size.y)
+			return;
+		count = std::min(count, record.size.x - x);
+		memcpy(dst + y * record.size.x + x, src, count);
 
-	uint16_t version;
-	if (!pck.readule16(version))
-	{
-		LogError("Failed to read version from \"%s\"", PckFilename.c_str());
-		return;
+		unsigned int first = 0;
+		while (first < count && src[first] == 0)
+			first++;
+		if (first == count)
+			return;
+		unsigned int last = count - 1;
+		while (src[last] == 0)
+			last--;
+
+		minX = std::min(minX, x + first);
+		maxX = std::max(maxX, x + last);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
 	}
-	pck.seekg(0, std::ios::beg);
-	switch (version)
+
+  public:
+	PCKDecoder(IFileCursor pck, IFileCursor tab, const UString &name)
+	    : pck(pck), tab(tab), name(name), arenaOffset(0)
 	{
-		case 0:
-			LoadVersion1Format(pck, tab, Index);
-			break;
-		case 1:
-			LoadVersion2Format(pck, tab, Index);
-			break;
 	}
-}
 
-void PCK::LoadVersion1Format(IFile &pck, IFile &tab, int Index)
+	std::vector<sp<PaletteImage>> decode();
+};
+
+// Version 1 files have no compression header, each row is stored as
+// {uint16_t pixel offset, uint16_t width, uint8_t indices[width]} terminated by an offset of 0xffff
+//
+// Each row is placed at its offset, and the image is as wide as the furthest any row reaches. The
+// old stream decoder made the image as wide as the widest row and read the rows back as if they
+// all had that width and no offset, which cut off the end of offset rows and sheared the image if
+// the widths differed. Images whose rows all start at 0 and have the same width (the only ones it
+// got right) decode identically.
+bool PCKDecoder::scanVersion1Format()
 {
-	sp<PaletteImage> img;
-
-	uint16_t c0_offset;
-	uint16_t c0_maxwidth;
-	uint16_t c0_height;
-	std::unique_ptr<Memory> c0_imagedata;
-	size_t c0_bufferptr;
-	int c0_idx;
-	std::vector<int16_t> c0_rowwidths;
-
-	int minrec = (Index < 0 ? 0 : Index);
-	int maxrec = (Index < 0 ? tab.size() / 4 : Index + 1);
-	for (int i = minrec; i < maxrec; i++)
+	uint32_t offset;
+	for (unsigned int i = 0; tab.readule32(offset); i++)
 	{
-		if (!tab.seekg(i * 4, std::ios::beg))
-		{
-			LogError("Failed to seek to record %d in \"%s\"", i, tab.fileName().c_str());
-			return;
-		}
-		unsigned int offset;
-		if (!tab.readule32(offset))
-		{
-			LogError("Failed to read offset %d from tab \"%s\"", i, tab.fileName().c_str());
-			return;
-		}
-
-		if (!pck.seekg(offset, std::ios::beg))
-		{
-			LogError("Failed to seek to offset %u for PCK \"%s\" id %s", offset,
-			         pck.fileName().c_str(), i);
-			return;
-		}
+		PCKRecord record;
+		record.offset = offset;
+		record.size = {0, 0};
+		record.leftMostPixel = 0;
 
-		// Raw Data
-		if (!pck.readule16(c0_offset))
+		uint16_t rowOffset;
+		if (!pck.seek(offset) || !pck.readule16(rowOffset))
 		{
-			LogError("Failed to read offset header in PCK \"%s\" id %d", pck.fileName().c_str(), i);
-			return;
+			LogError("Failed to read offset header in PCK \"%s\" id %u", name.c_str(), i);
+			return false;
 		}
-		c0_imagedata.reset(new Memory(0));
-		c0_rowwidths.clear();
-		c0_maxwidth = 0;
-		c0_height = 0;
-
-		while (c0_offset != 0xffff)
+		while (rowOffset != 0xffff)
 		{
-			uint16_t c0_width;
-			if (!pck.readule16(c0_width))
+			uint16_t rowWidth;
+			if (!pck.readule16(rowWidth))
 			{
-				LogError("Failed to read width header in PCK \"%s\" id %d", pck.fileName().c_str(),
-				         i);
-				return;
+				LogError("Failed to read width header in PCK \"%s\" id %u", name.c_str(), i);
+				return false;
 			}
-			c0_rowwidths.push_back(c0_width);
-			if (c0_maxwidth < c0_width)
+			if (!pck.skip(rowWidth))
 			{
-				c0_maxwidth = c0_width;
+				LogError("Failed to read pixel data in PCK \"%s\" id %u", name.c_str(), i);
+				return false;
 			}
-
-			c0_bufferptr = c0_imagedata->GetSize();
-			c0_imagedata->Resize(c0_bufferptr + c0_width + (c0_offset % 640));
-			memset(c0_imagedata->GetDataOffset(c0_bufferptr), 0, c0_width + (c0_offset % 640));
-			if (!pck.read(reinterpret_cast<char *>(
-			                  c0_imagedata->GetDataOffset(c0_bufferptr + (c0_offset % 640))),
-			              c0_width))
+			record.size.x = std::max(record.size.x, (rowOffset % PCK_STRIDE) + rowWidth);
+			record.size.y++;
+			if (!pck.readule16(rowOffset))
 			{
-				LogError("Failed to read pixel data in PCK \"%s\" id %d", pck.fileName().c_str(),
-				         i);
-				return;
+				LogError("Failed to read row offset in PCK \"%s\" id %u", name.c_str(), i);
+				return false;
 			}
-			c0_height++;
+		}
+		records.push_back(record);
+	}
+	return true;
+}
 
-			if (!pck.readule16(c0_offset))
-			{
-				LogError("Failed to read offset after %d from tab \"%s\"", i,
-				         tab.fileName().c_str());
-				return;
-			}
+bool PCKDecoder::decodeVersion1Format(const PCKRecord &record, uint8_t *dst)
+{
+	// All bounds were checked in scanVersion1Format()
+	uint16_t rowOffset, rowWidth;
+	pck.seek(record.offset);
+	for (unsigned int y = 0; y < record.size.y; y++)
+	{
+		pck.readule16(rowOffset);
+		pck.readule16(rowWidth);
+		copyRow(record, dst, rowOffset % PCK_STRIDE, y, pck.readSpan(rowWidth), rowWidth);
+	}
+	return true;
+}
+
+// Version 2 files have a per-image compression header, only compression 1 (RLE) is supported
+bool PCKDecoder::scanVersion2Format()
+{
+	uint32_t offset;
+	for (unsigned int i = 0; tab.readule32(offset); i++)
+	{
+		// Version 2 TAB files store the offset in 4-byte units
+		uint16_t compressionMethod;
+		if (!pck.seek(static_cast<size_t>(offset) * 4) || !pck.readule16(compressionMethod))
+		{
+			LogError("Failed to read compression header for PCK \"%s\" id %u", name.c_str(), i);
+			return false;
 		}
-		img = mksp<PaletteImage>(Vec2<int>{c0_maxwidth, c0_height});
-		PaletteImageLock region(img);
-		c0_idx = 0;
-		for (int c0_y = 0; c0_y < c0_height; c0_y++)
+		switch (compressionMethod)
 		{
-			for (int c0_x = 0; c0_x < c0_maxwidth; c0_x++)
+			case 0:
+				// FIXME: Uncompressed images are skipped (and don't get an entry in the set)
+				break;
+			case 1:
 			{
-				if (c0_x < c0_rowwidths.at(c0_y))
-				{
-					region.set(Vec2<int>{c0_x, c0_y},
-					           (reinterpret_cast<char *>(c0_imagedata->GetDataOffset(c0_idx)))[0]);
-				}
-				else
+				// Image header is {uint8_t reserved[2], uint16_t left, right, top, bottom}
+				uint16_t leftMostPixel, rightMostPixel, topMostPixel, bottomMostPixel;
+				if (!pck.skip(2) || !pck.readule16(leftMostPixel) ||
+				    !pck.readule16(rightMostPixel) || !pck.readule16(topMostPixel) ||
+				    !pck.readule16(bottomMostPixel))
 				{
-					region.set(Vec2<int>{c0_x, c0_y}, 0);
+					LogError("Failed to read header for PCK \"%s\" id %u", name.c_str(), i);
+					return false;
 				}
-				c0_idx++;
+				PCKRecord record;
+				record.offset = pck.tell();
+				record.size = {rightMostPixel, bottomMostPixel};
+				record.leftMostPixel = leftMostPixel;
+				records.push_back(record);
+				break;
 			}
+			default:
+				LogError("Unsupported compression method %d", compressionMethod);
+				break;
 		}
-		images.push_back(img);
 	}
+	return true;
 }
 
-void PCK::LoadVersion2Format(IFile &pck, IFile &tab, int Index)
+bool PCKDecoder::decodeVersion2Format(const PCKRecord &record, uint8_t *dst)
 {
-	uint16_t compressionmethod;
-
-	sp<PaletteImage> img;
-
-	PCKCompression1ImageHeader c1_imgheader;
-	uint32_t c1_pixelstoskip;
-	PCKCompression1RowHeader c1_header;
-
-	int minrec = (Index < 0 ? 0 : Index);
-	int maxrec = (Index < 0 ? tab.size() / 4 : Index + 1);
-	for (int i = minrec; i < maxrec; i++)
+	uint32_t pixelsToSkip;
+	if (!pck.seek(record.offset) || !pck.readule32(pixelsToSkip))
 	{
-		if (!tab.seekg(i * 4, std::ios::beg))
-		{
-			LogError("Failed to seek to record %d in \"%s\"", i, tab.fileName().c_str());
-			return;
-		}
-		unsigned int offset;
-		if (!tab.readule32(offset))
+		LogError("Failed to read pixel skip for PCK \"%s\"", name.c_str());
+		return false;
+	}
+	while (pixelsToSkip != 0xFFFFFFFF)
+	{
+		// Row header is {uint8_t column, uint8_t pixels, uint8_t bytes, uint8_t padding}
+		const uint8_t *rowHeader = pck.readSpan(4);
+		if (!rowHeader)
 		{
-			LogError("Failed to read offset %d from tab \"%s\"", i, tab.fileName().c_str());
-			return;
+			LogError("Failed to read RLE header for PCK \"%s\"", name.c_str());
+			return false;
 		}
-		offset *= 4;
+		unsigned int columnToStartAt = rowHeader[0];
+		unsigned int pixelsInRow = rowHeader[1];
+		unsigned int bytesInRow = rowHeader[2];
 
-		if (!pck.seekg(offset, std::ios::beg))
+		unsigned int y = pixelsToSkip / PCK_STRIDE;
+		if (y < record.size.y)
 		{
-			LogError("Failed to seek to offset %u for PCK \"%s\" id %s", offset,
-			         pck.fileName().c_str(), i);
-			return;
+			unsigned int x = columnToStartAt;
+			unsigned int count = pixelsInRow;
+			if (bytesInRow != 0)
+			{
+				// No idea what this is
+				pck.skip(4);
+				x = record.leftMostPixel;
+				count = bytesInRow > record.leftMostPixel ? bytesInRow - record.leftMostPixel : 0;
+			}
+			const uint8_t *src = pck.readSpan(count);
+			if (!src)
+			{
+				LogError("Failed to read pixel data for PCK \"%s\"", name.c_str());
+				return false;
+			}
+			copyRow(record, dst, x, y, src, count);
 		}
-
-		if (!pck.readule16(compressionmethod))
+		if (!pck.readule32(pixelsToSkip))
 		{
-			LogError("Failed to read compression header for PCK \"%s\" id %d",
-			         pck.fileName().c_str(), i);
-			return;
+			LogError("Failed to read pixel skip after PCK \"%s\"", name.c_str());
+			return false;
 		}
-		switch (compressionmethod)
-		{
-			case 0:
+	}
+	return true;
+}
 
-				break;
+std::vector<sp<PaletteImage>> PCKDecoder::decode()
+{
+	std::vector<sp<PaletteImage>> images;
 
-			case 1:
-			{
-				// Raw Data with RLE
-				if (!pck.read(reinterpret_cast<char *>(&c1_imgheader), sizeof(c1_imgheader)))
-				{
-					LogError("Failed to read header for PCK \"%s\" id %d", pck.fileName().c_str(),
-					         i);
-					return;
-				}
-				img = mksp<PaletteImage>(
-				    Vec2<int>{c1_imgheader.RightMostPixel, c1_imgheader.BottomMostPixel});
+	uint16_t version;
+	if (!pck.readule16(version))
+	{
+		LogError("Failed to read version from \"%s\"", name.c_str());
+		return images;
+	}
+	// A failed scan still leaves all the records before the failure intact
+	switch (version)
+	{
+		case 0:
+			scanVersion1Format();
+			break;
+		case 1:
+			scanVersion2Format();
+			break;
+		default:
+			LogError("Unknown PCK version %u in \"%s\"", version, name.c_str());
+			return images;
+	}
 
-				PaletteImageLock lock(img);
-				if (!pck.readule32(c1_pixelstoskip))
-				{
-					LogError("Failed to read pixel skip for PCK \"%s\" id %d",
-					         pck.fileName().c_str(), i);
-					return;
-				}
-				while (c1_pixelstoskip != 0xFFFFFFFF)
-				{
-					if (!pck.read(reinterpret_cast<char *>(&c1_header), sizeof(c1_header)))
-					{
-						LogError("Failed to read RLE header for PCK \"%s\" id %d",
-						         pck.fileName().c_str(), i);
-						return;
-					}
-					uint32_t c1_y = (c1_pixelstoskip / 640);
+	size_t arenaSize = 0;
+	for (auto &record : records)
+		arenaSize += record.size.x * record.size.y;
+	arena = mksp<std::vector<uint8_t>>(arenaSize, 0);
 
-					if (c1_y < c1_imgheader.BottomMostPixel)
-					{
-						if (c1_header.BytesInRow != 0)
-						{
-							// No idea what this is
-							uint32_t chunk;
-							pck.readule32(chunk);
-
-							for (uint32_t c1_x = c1_imgheader.LeftMostPixel;
-							     c1_x < c1_header.BytesInRow; c1_x++)
-							{
-								if (c1_x < c1_imgheader.RightMostPixel)
-								{
-									char idx;
-									if (!pck.read(&idx, 1))
-									{
-										LogError("Failed to read pixel data for PCK \"%s\" id %d",
-										         pck.fileName().c_str(), i);
-										return;
-									}
-									lock.set(Vec2<int>{c1_x, c1_y}, idx);
-								}
-								else
-								{
-									// Pretend to process data
-									char dummy;
-									pck.read(&dummy, 1);
-								}
-							}
-						}
-						else
-						{
-							for (uint32_t c1_x = 0; c1_x < c1_header.PixelsInRow; c1_x++)
-							{
-								if ((c1_header.ColumnToStartAt + c1_x) <
-								    c1_imgheader.RightMostPixel)
-								{
-									char idx;
-									if (!pck.read(&idx, 1))
-									{
-										LogError("Failed to read pixel data for PCK \"%s\" id %d",
-										         pck.fileName().c_str(), i);
-										return;
-									}
-									lock.set(Vec2<int>{c1_header.ColumnToStartAt + c1_x, c1_y},
-									         idx);
-								}
-								else
-								{
-									// Pretend to process data
-									char dummy;
-									pck.read(&dummy, 1);
-								}
-							}
-						}
-					}
-					if (!pck.readule32(c1_pixelstoskip))
-					{
-						LogError("Failed to read pixel skip after PCK \"%s\" id %d",
-						         pck.fileName().c_str(), i);
-						return;
-					}
-				}
-				images.push_back(img);
-				break;
-			}
+	for (auto &record : records)
+	{
+		uint8_t *dst = arena->data() + arenaOffset;
+		minX = record.size.x;
+		minY = record.size.y;
+		maxX = 0;
+		maxY = 0;
+
+		bool ok = (version == 0) ? decodeVersion1Format(record, dst)
+		                         : decodeVersion2Format(record, dst);
+		if (!ok)
+			break;
 
-			default:
-				LogError("Unsupported compression method %d", compressionmethod);
-				break;
-		}
+		auto img = mksp<PaletteImage>(record.size, arena, arenaOffset);
+		img->bounds = {minX, minY, maxX, maxY};
+		images.push_back(img);
+		arenaOffset += record.size.x * record.size.y;
 	}
+	return images;
 }
+
 }; // anonymous namespace
 
 sp<ImageSet> PCKLoader::load(Data &data, UString PckFilename, UString TabFilename)
 {
-	PCK *p = new PCK(data, PckFilename, TabFilename);
+	auto pck = data.fs.open(PckFilename);
+	if (!pck)
+	{
+		LogError("Failed to open PCK file \"%s\"", PckFilename.c_str());
+		return nullptr;
+	}
+	auto tab = data.fs.open(TabFilename);
+	if (!tab)
+	{
+		LogError("Failed to open TAB file \"%s\"", TabFilename.c_str());
+		return nullptr;
+	}
+	auto pckView = pck.map();
+	auto tabView = tab.map();
+	if (!pckView || !tabView)
+	{
+		LogError("Failed to read PCK \"%s\"", PckFilename.c_str());
+		return nullptr;
+	}
+
+	auto imageSet = decode(pckView.data(), pckView.size(), tabView.data(), tabView.size(),
+	                       PckFilename);
+
+	LogInfo("Loaded \"%s\" - %u images, max size {%d,%d}", PckFilename.c_str(),
+	        static_cast<unsigned int>(imageSet->images.size()), imageSet->maxSize.x,
+	        imageSet->maxSize.y);
+
+	return imageSet;
+}
+
+sp<ImageSet> PCKLoader::decode(const uint8_t *pckData, size_t pckSize, const uint8_t *tabData,
+                               size_t tabSize, const UString &name)
+{
+	PCKDecoder decoder({pckData, pckSize}, {tabData, tabSize}, name);
+	auto images = decoder.decode();
+
 	auto imageSet = mksp<ImageSet>();
 	imageSet->maxSize = Vec2<int>{0, 0};
-	imageSet->images.resize(p->images.size());
-	for (unsigned int i = 0; i < p->images.size(); i++)
+	imageSet->images.resize(images.size());
+	for (unsigned int i = 0; i < images.size(); i++)
 	{
-		p->images[i]->CalculateBounds();
-		imageSet->images[i] = p->images[i];
+		imageSet->images[i] = images[i];
 		imageSet->images[i]->owningSet = imageSet;
 		imageSet->images[i]->indexInSet = i;
 		if (imageSet->images[i]->size.x > imageSet->maxSize.x)
@@ -356,12 +339,6 @@ sp<ImageSet> PCKLoader::load(Data &data, UString PckFilename, UString TabFilenam
 		if (imageSet->images[i]->size.y > imageSet->maxSize.y)
 			imageSet->maxSize.y = imageSet->images[i]->size.y;
 	}
-	delete p;
-
-	LogInfo("Loaded \"%s\" - %u images, max size {%d,%d}", PckFilename.c_str(),
-	        static_cast<unsigned int>(imageSet->images.size()), imageSet->maxSize.x,
-	        imageSet->maxSize.y);
-
 	return imageSet;
 }
 
@@ -14,6 +14,9 @@ class PCKLoader
 {
   public:
 	static sp<ImageSet> load(Data &data, UString PckFilename, UString TabFilename);
+	// Decode an already-read PCK/TAB pair, 'name' is only used for error messages
+	static sp<ImageSet> decode(const uint8_t *pckData, size_t pckSize, const uint8_t *tabData,
+	                           size_t tabSize, const UString &name = "");
 	static sp<ImageSet> load_strat(Data &data, UString PckFilename, UString TabFilename);
 	static sp<ImageSet> load_shadow(Data &data, UString PckFilename, UString TabFilename,
 	                                uint8_t shadedIdx = 244);
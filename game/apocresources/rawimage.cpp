@@ -27,25 +27,18 @@ sp<PaletteImage> RawImage::load(Data &data, const UString &filename, const Vec2<
 		           size.x, size.y);
 	}
 
-	auto image = mksp<PaletteImage>(size);
-
-	PaletteImageLock l(image, ImageLockUse::Write);
-
-	for (int y = 0; y < size.y; y++)
+	auto view = infile.map();
+	size_t imageBytes = size.x * size.y;
+	if (view.size() < imageBytes)
 	{
-		for (int x = 0; x < size.x; x++)
-		{
-			// TODO: can read a stride at a time? Or just the whole chunk as it's tightly packed?
-			uint8_t idx;
-			if (!infile.read(reinterpret_cast<char *>(&idx), 1))
-			{
-				LogError("Unexpected EOF in file \"%s\" at {%d,%d}", filename.c_str(), x, y);
-				return nullptr;
-			}
-			l.set(Vec2<unsigned int>{x, y}, idx);
-		}
+		LogError("Unexpected EOF in file \"%s\"", filename.c_str());
+		return nullptr;
 	}
 
+	auto image = mksp<PaletteImage>(size);
+	PaletteImageLock l(image, ImageLockUse::Write);
+	memcpy(l.getData(), view.data(), imageBytes);
+
 	return image;
 }
 
@@ -74,28 +67,19 @@ sp<ImageSet> RawImage::load_set(Data &data, const UString &filename, const Vec2<
 	imageSet->maxSize = size;
 	imageSet->images.resize(numImages);
 
+	auto view = infile.map();
+	size_t imageBytes = size.x * size.y;
+	if (view.size() < numImages * imageBytes)
+	{
+		LogError("Unexpected EOF in file \"%s\"", filename.c_str());
+		return nullptr;
+	}
+
 	for (size_t i = 0; i < numImages; i++)
 	{
 		auto image = mksp<PaletteImage>(size);
-
 		PaletteImageLock l(image, ImageLockUse::Write);
-
-		for (int y = 0; y < size.y; y++)
-		{
-			for (int x = 0; x < size.x; x++)
-			{
-				// TODO: can read a stride at a time? Or just the whole chunk as it's tightly
-				// packed?
-				uint8_t idx;
-				if (!infile.read(reinterpret_cast<char *>(&idx), 1))
-				{
-					LogError("Unexpected EOF in file \"%s\" at {%d:%d,%d}", filename.c_str(), i, x,
-					         y);
-					return nullptr;
-				}
-				l.set(Vec2<unsigned int>{x, y}, idx);
-			}
-		}
+		memcpy(l.getData(), view.data() + i * imageBytes, imageBytes);
 
 		imageSet->images[i] = image;
 		imageSet->images[i]->owningSet = imageSet;
@@ -271,7 +271,7 @@ void VEquipScreen::Render()
 	std::vector<sp<Label>> statsValues;
 	for (int i = 0; i < 9; i++)
 	{
-		auto labelName = UString::format("LABEL_%d", i + 1);
+		auto labelName = "LABEL_" + Strings::FromInteger(i + 1);
 		auto label = form->FindControlTyped<Label>(labelName);
 		if (!label)
 		{
@@ -280,7 +280,7 @@ void VEquipScreen::Render()
 		label->SetText("");
 		statsLabels.push_back(label);
 
-		auto valueName = UString::format("VALUE_%d", i + 1);
+		auto valueName = "VALUE_" + Strings::FromInteger(i + 1);
 		auto value = form->FindControlTyped<Label>(valueName);
 		if (!value)
 		{
@@ -304,7 +304,7 @@ void VEquipScreen::Render()
 
 		// All equipment has a weight
 		statsLabels[statsCount]->SetText(tr("Weight"));
-		statsValues[statsCount]->SetText(UString::format("%d", highlightedEquipment->weight));
+		statsValues[statsCount]->SetText(Strings::FromInteger(highlightedEquipment->weight));
 		statsCount++;
 
 		// Draw equipment stats
@@ -314,23 +314,23 @@ void VEquipScreen::Render()
 			{
 				auto &engineType = static_cast<const VEngineType &>(*highlightedEquipment);
 				statsLabels[statsCount]->SetText(tr("Top Speed"));
-				statsValues[statsCount]->SetText(UString::format("%d", engineType.top_speed));
+				statsValues[statsCount]->SetText(Strings::FromInteger(engineType.top_speed));
 				statsCount++;
 				statsLabels[statsCount]->SetText(tr("Power"));
-				statsValues[statsCount]->SetText(UString::format("%d", engineType.power));
+				statsValues[statsCount]->SetText(Strings::FromInteger(engineType.power));
 				break;
 			}
 			case VEquipmentType::Type::Weapon:
 			{
 				auto &weaponType = static_cast<const VWeaponType &>(*highlightedEquipment);
 				statsLabels[statsCount]->SetText(tr("Damage"));
-				statsValues[statsCount]->SetText(UString::format("%d", weaponType.damage));
+				statsValues[statsCount]->SetText(Strings::FromInteger(weaponType.damage));
 				statsCount++;
 				statsLabels[statsCount]->SetText(tr("Range"));
-				statsValues[statsCount]->SetText(UString::format("%d", weaponType.range));
+				statsValues[statsCount]->SetText(Strings::FromInteger(weaponType.range));
 				statsCount++;
 				statsLabels[statsCount]->SetText(tr("Accuracy"));
-				statsValues[statsCount]->SetText(UString::format("%d", weaponType.accuracy));
+				statsValues[statsCount]->SetText(Strings::FromInteger(weaponType.accuracy));
 				statsCount++;
 
 				// Only show rounds if non-zero (IE not infinite ammo)
@@ -338,7 +338,7 @@ void VEquipScreen::Render()
 				{
 					statsLabels[statsCount]->SetText(tr("Rounds"));
 					statsValues[statsCount]->SetText(
-					    UString::format("%d", highlightedEquipment->max_ammo));
+					    Strings::FromInteger(highlightedEquipment->max_ammo));
 					statsCount++;
 				}
 				break;
@@ -351,40 +351,40 @@ void VEquipScreen::Render()
 				{
 					statsLabels[statsCount]->SetText(tr("Accuracy"));
 					statsValues[statsCount]->SetText(
-					    UString::format("%d", generalType.accuracy_modifier));
+					    Strings::FromInteger(generalType.accuracy_modifier));
 					statsCount++;
 				}
 				if (generalType.cargo_space)
 				{
 					statsLabels[statsCount]->SetText(tr("Cargo"));
 					statsValues[statsCount]->SetText(
-					    UString::format("%d", generalType.cargo_space));
+					    Strings::FromInteger(generalType.cargo_space));
 					statsCount++;
 				}
 				if (generalType.passengers)
 				{
 					statsLabels[statsCount]->SetText(tr("Passengers"));
-					statsValues[statsCount]->SetText(UString::format("%d", generalType.passengers));
+					statsValues[statsCount]->SetText(Strings::FromInteger(generalType.passengers));
 					statsCount++;
 				}
 				if (generalType.alien_space)
 				{
 					statsLabels[statsCount]->SetText(tr("Aliens Held"));
 					statsValues[statsCount]->SetText(
-					    UString::format("%d", generalType.alien_space));
+					    Strings::FromInteger(generalType.alien_space));
 					statsCount++;
 				}
 				if (generalType.missile_jamming)
 				{
 					statsLabels[statsCount]->SetText(tr("Jamming"));
 					statsValues[statsCount]->SetText(
-					    UString::format("%d", generalType.missile_jamming));
+					    Strings::FromInteger(generalType.missile_jamming));
 					statsCount++;
 				}
 				if (generalType.shielding)
 				{
 					statsLabels[statsCount]->SetText(tr("Shielding"));
-					statsValues[statsCount]->SetText(UString::format("%d", generalType.shielding));
+					statsValues[statsCount]->SetText(Strings::FromInteger(generalType.shielding));
 					statsCount++;
 				}
 				if (generalType.cloaking)
@@ -414,40 +414,40 @@ void VEquipScreen::Render()
 		statsLabels[0]->SetText(tr("Constitution"));
 		if (vehicle->getConstitution() == vehicle->getMaxConstitution())
 		{
-			statsValues[0]->SetText(UString::format("%d", vehicle->getConstitution()));
+			statsValues[0]->SetText(Strings::FromInteger(vehicle->getConstitution()));
 		}
 		else
 		{
-			statsValues[0]->SetText(UString::format("%d/%d", vehicle->getConstitution(),
-			                                        vehicle->getMaxConstitution()));
+			statsValues[0]->SetText(Strings::FromInteger(vehicle->getConstitution()) + "/" +
+			                        Strings::FromInteger(vehicle->getMaxConstitution()));
 		}
 
 		statsLabels[1]->SetText(tr("Armor"));
-		statsValues[1]->SetText(UString::format("%d", vehicle->getArmor()));
+		statsValues[1]->SetText(Strings::FromInteger(vehicle->getArmor()));
 
 		// FIXME: This value doesn't seem to be the same as the %age shown in the ui?
 		statsLabels[2]->SetText(tr("Accuracy"));
-		statsValues[2]->SetText(UString::format("%d", vehicle->getAccuracy()));
+		statsValues[2]->SetText(Strings::FromInteger(vehicle->getAccuracy()));
 
 		statsLabels[3]->SetText(tr("Top Speed"));
-		statsValues[3]->SetText(UString::format("%d", vehicle->getTopSpeed()));
+		statsValues[3]->SetText(Strings::FromInteger(vehicle->getTopSpeed()));
 
 		statsLabels[4]->SetText(tr("Acceleration"));
-		statsValues[4]->SetText(UString::format("%d", vehicle->getAcceleration()));
+		statsValues[4]->SetText(Strings::FromInteger(vehicle->getAcceleration()));
 
 		statsLabels[5]->SetText(tr("Weight"));
-		statsValues[5]->SetText(UString::format("%d", vehicle->getWeight()));
+		statsValues[5]->SetText(Strings::FromInteger(vehicle->getWeight()));
 
 		statsLabels[6]->SetText(tr("Fuel"));
-		statsValues[6]->SetText(UString::format("%d", vehicle->getFuel()));
+		statsValues[6]->SetText(Strings::FromInteger(vehicle->getFuel()));
 
 		statsLabels[7]->SetText(tr("Passengers"));
-		statsValues[7]->SetText(
-		    UString::format("%d/%d", vehicle->getPassengers(), vehicle->getMaxPassengers()));
+		statsValues[7]->SetText(Strings::FromInteger(vehicle->getPassengers()) + "/" +
+		                        Strings::FromInteger(vehicle->getMaxPassengers()));
 
 		statsLabels[8]->SetText(tr("Cargo"));
-		statsValues[8]->SetText(
-		    UString::format("%d/%d", vehicle->getCargo(), vehicle->getMaxCargo()));
+		statsValues[8]->SetText(Strings::FromInteger(vehicle->getCargo()) + "/" +
+		                        Strings::FromInteger(vehicle->getMaxCargo()));
 
 		iconGraphic->SetImage(vehicle->type.equip_icon_small);
 	}
@@ -627,7 +627,7 @@ void VEquipScreen::Render()
 				// Not in stock
 				continue;
 			}
-			auto countImage = labelFont->getString(UString::format("%d", count));
+			auto countImage = labelFont->getString(Strings::FromInteger(count));
 			auto &equipmentImage = equipmentType.equipscreen_sprite;
 			fw().renderer->draw(equipmentImage, inventoryPosition);
 
@@ -1,6 +1,7 @@
 
 #include "game/boot.h"
 #include "framework/framework.h"
+#include "framework/metricsoverlay.h"
 #include "framework/trace.h"
 #include "game/general/mainmenu.h"
 #include "game/resources/gamecore.h"
@@ -53,9 +54,14 @@ void BootUp::Update(StageCmd *const cmd)
 	loadtime++;
 	loadingimageangle.Add(5);
 
+	// A recording can only be replayed if boot takes the same number of frames each time
+	if (fw().isInputFrameLocked())
+		asyncGamecoreLoad.wait();
+
 	if (gamecoreLoadComplete)
 	{
 		asyncGamecoreLoad.wait();
+		fw().getMetricsOverlay().setFont(fw().gamecore->GetFont("SMALFONT"));
 		cmd->cmd = StageCmd::Command::REPLACE;
 		cmd->nextStage = mksp<MainMenu>();
 	}
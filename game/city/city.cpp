@@ -8,6 +8,7 @@
 #include "game/city/vequipment.h"
 #include "game/rules/vequipment.h"
 #include "framework/framework.h"
+#include "framework/metrics.h"
 #include "framework/trace.h"
 #include "game/city/projectile.h"
 #include "game/tileview/tileobject_vehicle.h"
@@ -30,7 +31,9 @@ static std::vector<std::set<TileObject::Type>> layerMap = {
     {TileObject::Type::Projectile, TileObject::Type::Vehicle, TileObject::Type::Shadow},
 };
 
-City::City(GameState &state) : map(state.getRules().getCitySize(), layerMap)
+City::City(GameState &state)
+    : map(state.getRules().getCitySize(), layerMap), projectiles(this->map),
+      sceneryPool(1024), staticDoodads(1024)
 {
 	Trace::start("City::buildings");
 	for (auto &def : state.getRules().getBuildingDefs())
@@ -41,6 +44,7 @@ City::City(GameState &state) : map(state.getRules().getCitySize(), layerMap)
 	Trace::end("City::buildings");
 
 	Trace::start("City::scenery");
+	std::vector<Scenery *> sceneryNodes;
 	for (int z = 0; z < this->map.size.z; z++)
 	{
 		for (int y = 0; y < this->map.size.y; y++)
@@ -75,16 +79,19 @@ City::City(GameState &state) : map(state.getRules().getCitySize(), layerMap)
 				}
 
 				auto &cityTileDef = state.getRules().getSceneryTileDef(tileID);
-				auto scenery = mksp<Scenery>(cityTileDef, Vec3<int>{x, y, z}, bld);
-				map.addObjectToMap(scenery);
+				auto scenery = this->sceneryPool.create(cityTileDef, Vec3<int>{x, y, z}, bld);
+				scenery->graphIndex = sceneryNodes.size();
+				sceneryNodes.push_back(scenery.get());
+				map.addObjectToMap(this->sceneryPool.getHandle(scenery.get()));
 				if (cityTileDef.getOverlaySprite())
 				{
 					// FIXME: Bit of a hack to make the overlay always be at the 'top' of the tile -
 					// as getPosition() returns the /center/ add half a tile
-					scenery->overlayDoodad =
-					    mksp<StaticDoodad>(cityTileDef.getOverlaySprite(), scenery->getPosition(),
-					                       cityTileDef.getImageOffset());
-					map.addObjectToMap(scenery->overlayDoodad);
+					scenery->overlayDoodad = this->staticDoodads.create(
+					    cityTileDef.getOverlaySprite(), scenery->getPosition(),
+					    cityTileDef.getImageOffset());
+					map.addObjectToMap(
+					    this->staticDoodads.getHandle(scenery->overlayDoodad.get()));
 				}
 				this->scenery.insert(scenery);
 			}
@@ -93,78 +100,7 @@ City::City(GameState &state) : map(state.getRules().getCitySize(), layerMap)
 	Trace::end("City::scenery");
 
 	Trace::start("City::scenery::support");
-	for (auto &s : this->scenery)
-	{
-		if (s->pos.z == 0)
-		{
-			continue;
-		}
-		auto pos = s->pos;
-		pos.z -= 1;
-
-		bool supported = false;
-
-		auto *t = map.getTile(pos);
-		for (auto &obj : t->ownedObjects)
-		{
-			switch (obj->getType())
-			{
-				case TileObject::Type::Scenery:
-				{
-					auto supportingSceneryTile = std::static_pointer_cast<TileObjectScenery>(obj);
-					auto supportingSceneryObject = supportingSceneryTile->getOwner();
-					supportingSceneryObject->supports.insert(s);
-					s->supportedBy.insert(supportingSceneryObject);
-					supported = true;
-					break;
-				}
-				default:
-					break;
-			}
-		}
-
-		if (!supported)
-		{
-
-			std::vector<Vec3<int>> dirs = {
-			    {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0},
-			};
-			for (auto &d : dirs)
-			{
-				pos = s->pos;
-				pos += d;
-
-				if (pos.x < 0 || pos.x >= map.size.x || pos.y < 0 || pos.y >= map.size.y)
-				{
-					continue;
-				}
-
-				auto *t = map.getTile(pos);
-				for (auto &obj : t->ownedObjects)
-				{
-					switch (obj->getType())
-					{
-						case TileObject::Type::Scenery:
-						{
-							auto supportingSceneryTile =
-							    std::static_pointer_cast<TileObjectScenery>(obj);
-							auto supportingSceneryObject = supportingSceneryTile->getOwner();
-							supportingSceneryObject->supports.insert(s);
-							s->supportedBy.insert(supportingSceneryObject);
-							supported = true;
-							break;
-						}
-						default:
-							break;
-					}
-				}
-			}
-		}
-		if (!supported)
-		{
-			LogWarning("Scenery tile at {%d,%d,%d} has no support", s->pos.x, s->pos.y, s->pos.z);
-		}
-	}
+	this->supportGraph.build(std::move(sceneryNodes), this->map.size, *fw().threadPool);
 	Trace::end("City::scenery::support");
 
 	/* Sanity check - all buildings should at have least one landing pad */
@@ -192,6 +128,14 @@ City::City(GameState &state) : map(state.getRules().getCitySize(), layerMap)
 City::~City()
 {
 	TRACE_FN;
+	for (auto &pool : this->getPoolStats())
+	{
+		LogInfo("%s pool: %llu allocations, %llu from the system allocator, %u of %u live",
+		        pool.first.c_str(), static_cast<unsigned long long>(pool.second.allocations),
+		        static_cast<unsigned long long>(pool.second.heapAllocations),
+		        static_cast<unsigned>(pool.second.live),
+		        static_cast<unsigned>(pool.second.capacity));
+	}
 	// Note due to backrefs to Tile*s etc. we need to destroy all tile objects
 	// before the TileMap
 	for (auto &v : this->vehicles)
@@ -200,24 +144,12 @@ City::~City()
 			v->tileObject->removeFromMap();
 	}
 	this->vehicles.clear();
-	for (auto &p : this->projectiles)
-	{
-		if (p->tileObject)
-			p->tileObject->removeFromMap();
-	}
 	this->projectiles.clear();
 	for (auto &s : this->scenery)
 	{
 		if (s->tileObject)
 			s->tileObject->removeFromMap();
 	}
-	// FIXME: Due to tiles possibly being cross-supported we need to clear that sp<> to avoid leaks
-	// Should this be pushed into a weak_ptr<> or some other ref?
-	for (auto s : this->scenery)
-	{
-		s->supports.clear();
-		s->supportedBy.clear();
-	}
 	this->scenery.clear();
 	this->buildings.clear();
 	this->baseBuildings.clear();
@@ -231,6 +163,14 @@ void City::update(GameState &state, unsigned int ticks)
 	 * some activity in the city*/
 	std::uniform_int_distribution<int> bld_distribution(0, this->buildings.size() - 1);
 
+	static auto &buildingsTime = Metrics::histogram("City.Update.BuildingsMs");
+	static auto &vehiclesTime = Metrics::histogram("City.Update.VehiclesMs");
+	static auto &projectilesTime = Metrics::histogram("City.Update.ProjectilesMs");
+	static auto &fallingSceneryTime = Metrics::histogram("City.Update.FallingSceneryMs");
+	static auto &doodadsTime = Metrics::histogram("City.Update.DoodadsMs");
+	static auto &projectileCountGauge = Metrics::gauge("City.Projectiles");
+	MetricStopwatch phaseTimer;
+
 	// Need to use a 'safe' iterator method (IE keep the next it before calling ->update)
 	// as update() calls can erase it's object from the lists
 
@@ -258,6 +198,7 @@ void City::update(GameState &state, unsigned int ticks)
 		}
 	}
 	Trace::end("City::update::buildings->landed_vehicles");
+	phaseTimer.lap(buildingsTime);
 	Trace::start("City::update::vehices->update");
 	for (auto it = this->vehicles.begin(); it != this->vehicles.end();)
 	{
@@ -265,32 +206,35 @@ void City::update(GameState &state, unsigned int ticks)
 		v->update(state, ticks);
 	}
 	Trace::end("City::update::vehices->update");
+	phaseTimer.lap(vehiclesTime);
 	Trace::start("City::update::projectiles->update");
-	std::list<std::future<Collision>> collisions;
-	for (auto it = this->projectiles.begin(); it != this->projectiles.end();)
-	{
-		auto p = *it++;
-		p->update(state, ticks);
-	}
-	for (auto &p : this->projectiles)
+	this->projectiles.update(ticks);
+	// Check collisions in batches, a task per projectile costs more than most of the checks
+	const unsigned int collisionBatchSize = 64;
+	unsigned int projectileCount = this->projectiles.getCount();
+	projectileCountGauge.set(projectileCount);
+	std::vector<Collision> collisions(projectileCount);
+	std::vector<std::future<void>> collisionBatches;
+	for (unsigned int start = 0; start < projectileCount; start += collisionBatchSize)
 	{
-		auto func = std::bind(&Projectile::checkProjectileCollision, p, std::placeholders::_1);
-		collisions.emplace_back(fw().threadPool->enqueue(func, std::ref(map)));
+		unsigned int end = std::min(start + collisionBatchSize, projectileCount);
+		collisionBatches.emplace_back(fw().threadPool->enqueue([this, &collisions, start, end]() {
+			for (unsigned int i = start; i < end; i++)
+				collisions[i] = this->projectiles.checkCollision(i);
+		}));
 	}
-	for (auto &future : collisions)
+	for (auto &future : collisionBatches)
 	{
 		// Make sure every user of the TileMap is finished before processing (as the tileobject/map
 		// lists are not locked, so probably OK for read-only...)
 		future.wait();
 	}
-	for (auto &future : collisions)
+	for (auto &c : collisions)
 	{
-
-		auto c = future.get();
 		if (c)
 		{
 			// FIXME: Handle collision
-			this->projectiles.erase(c.projectile);
+			this->projectiles.remove(c.projectile);
 			// FIXME: Get doodad from weapon definition?
 			auto doodad =
 			    this->placeDoodad(state.getRules().getDoodadDef("DOODAD_EXPLOSION_0"), c.position);
@@ -319,14 +263,13 @@ void City::update(GameState &state, unsigned int ticks)
 			}
 		}
 	}
+	this->processCollapses();
 	Trace::end("City::update::projectiles->update");
+	phaseTimer.lap(projectilesTime);
 	Trace::start("City::update::fallingScenery->update");
-	for (auto it = this->fallingScenery.begin(); it != this->fallingScenery.end();)
-	{
-		auto s = *it++;
-		s->update(state, ticks);
-	}
+	this->updateFallingScenery(state, ticks);
 	Trace::end("City::update::fallingScenery->update");
+	phaseTimer.lap(fallingSceneryTime);
 	Trace::start("City::update::doodads->update");
 	for (auto it = this->doodads.begin(); it != this->doodads.end();)
 	{
@@ -334,6 +277,7 @@ void City::update(GameState &state, unsigned int ticks)
 		d->update(state, ticks);
 	}
 	Trace::end("City::update::doodads->update");
+	phaseTimer.lap(doodadsTime);
 
 	// Cleanup any now-dead vehicle references:
 	for (auto org : state.organisations)
@@ -346,12 +290,137 @@ void City::update(GameState &state, unsigned int ticks)
 			                       }),
 		            vList.end());
 	}
+
+	this->updatePoolMetrics();
+}
+
+std::map<UString, PoolStats> City::getPoolStats() const
+{
+	auto stats = this->map.getPoolStats();
+	stats["Scenery"] = this->sceneryPool.getStats();
+	stats["AnimatedDoodad"] = this->animatedDoodads.getStats();
+	stats["StaticDoodad"] = this->staticDoodads.getStats();
+	return stats;
+}
+
+void City::updatePoolMetrics()
+{
+	for (auto &pool : this->getPoolStats())
+	{
+		auto &metrics = this->poolMetrics[pool.first];
+		if (!metrics.allocations)
+		{
+			UString prefix = "City.Pool." + pool.first;
+			metrics.allocations = &Metrics::gauge(prefix + ".Allocations");
+			metrics.heapAllocations = &Metrics::gauge(prefix + ".HeapAllocations");
+			metrics.live = &Metrics::gauge(prefix + ".Live");
+		}
+		// The stats are running totals, the gauges show what this tick added
+		metrics.allocations->set(pool.second.allocations - metrics.last.allocations);
+		metrics.heapAllocations->set(pool.second.heapAllocations -
+		                             metrics.last.heapAllocations);
+		metrics.live->set(pool.second.live);
+		metrics.last = pool.second;
+	}
+}
+
+void City::collapseSupported(const Scenery &scenery)
+{
+	for (auto s : this->supportGraph.getSupports(scenery.graphIndex))
+		this->pendingCollapse.push_back(s);
+}
+
+void City::processCollapses()
+{
+	if (this->pendingCollapse.empty())
+		return;
+	TRACE_FN;
+	// Breadth first through everything resting on the queued tiles. Tiles that are already falling
+	// or destroyed stop the spread, which also stops anything being visited twice.
+	this->collapseQueue.swap(this->pendingCollapse);
+	for (size_t i = 0; i < this->collapseQueue.size(); i++)
+	{
+		auto *s = this->supportGraph.getNode(this->collapseQueue[i]);
+		if (s->falling || !s->tileObject)
+			continue;
+		// Landing pads can't collapse, and may magically float, otherwise it screws up pathing
+		// (same reason why they can't be destroyed when hit)
+		if (s->tileDef.getIsLandingPad())
+			continue;
+		s->falling = true;
+
+		auto ret = this->fallingScenery.insert(s->shared_from_this());
+		if (ret.second == false)
+		{
+			LogError("Scenery object already in fallingSenery list?");
+		}
+		for (auto supported : this->supportGraph.getSupports(s->graphIndex))
+			this->collapseQueue.push_back(supported);
+	}
+	this->collapseQueue.clear();
+}
+
+void City::updateFallingScenery(GameState &state, unsigned int ticks)
+{
+	if (this->fallingScenery.empty())
+		return;
+	// FIXME: gravity acceleration?
+	float fallDistance = static_cast<float>(ticks) / 16.0f;
+	for (auto &s : this->fallingScenery)
+	{
+		if (!s->tileObject)
+		{
+			LogError("Falling scenery with no object?");
+			continue;
+		}
+		auto currentPos = s->tileObject->getPosition();
+		auto newPos = currentPos;
+		newPos.z -= fallDistance;
+
+		// Anything falling lands on the first standing scenery in its column, or the ground (which
+		// is treated as a solid tile at z = -1)
+		Vec3<int> column = {static_cast<int>(currentPos.x), static_cast<int>(currentPos.y), 0};
+		int landingZ = -1;
+		for (int z = std::min(static_cast<int>(currentPos.z), this->map.size.z - 1); z >= 0; z--)
+		{
+			column.z = z;
+			auto *below = this->supportGraph.getNodeAt(column);
+			if (below && !below->falling && below->tileObject)
+			{
+				landingZ = z;
+				break;
+			}
+		}
+
+		if (newPos.z >= landingZ + 1)
+		{
+			// Still falling, this only changes the tiles it's in when it crosses a boundary
+			s->tileObject->setPosition(newPos);
+			if (s->overlayDoodad)
+				s->overlayDoodad->setPosition(newPos);
+			continue;
+		}
+
+		// FIXME: Cause damage to scenery we hit?
+		newPos.z = std::max(newPos.z, static_cast<float>(std::max(landingZ, 0)));
+		s->falling = false;
+		this->placeDoodad(state.getRules().getDoodadDef("DOODAD_EXPLOSION_3"), newPos);
+		s->tileObject->removeFromMap();
+		s->tileObject.reset();
+		if (s->overlayDoodad)
+			s->overlayDoodad->remove(state);
+		s->overlayDoodad = nullptr;
+		this->landedScenery.push_back(s);
+	}
+	for (auto &s : this->landedScenery)
+		this->fallingScenery.erase(s);
+	this->landedScenery.clear();
 }
 
 sp<Doodad> City::placeDoodad(const DoodadDef &def, Vec3<float> position)
 {
-	auto doodad = mksp<AnimatedDoodad>(def, position);
-	map.addObjectToMap(doodad);
+	auto doodad = this->animatedDoodads.create(def, position);
+	map.addObjectToMap(this->animatedDoodads.getHandle(doodad.get()));
 	this->doodads.insert(doodad);
 	return doodad;
 }
@@ -4,6 +4,8 @@
 #include "framework/includes.h"
 
 #include "game/tileview/tile.h"
+#include "game/city/projectile.h"
+#include "game/city/scenerygraph.h"
 
 namespace OpenApoc
 {
@@ -18,10 +20,12 @@ namespace OpenApoc
 class Vehicle;
 class GameState;
 class Building;
-class Projectile;
 class Scenery;
 class Doodad;
+class AnimatedDoodad;
+class StaticDoodad;
 class DoodadDef;
+class MetricGauge;
 
 class City
 {
@@ -29,18 +33,55 @@ class City
 	City(GameState &state);
 	~City();
 	std::vector<sp<Vehicle>> vehicles;
-	std::set<sp<Projectile>> projectiles;
 	std::vector<sp<Building>> buildings;
 	std::vector<sp<Building>> baseBuildings;
 	std::set<sp<Scenery>> scenery;
 	std::set<sp<Scenery>> fallingScenery;
+	ScenerySupportGraph supportGraph;
 	std::set<sp<Doodad>> doodads;
 
 	TileMap map;
+	// Declared after the map, as removing projectiles removes their tile objects from it
+	ProjectileManager projectiles;
+	// Tile objects refer back to these through handles. Explosions are placed on every hit and
+	// scenery overlays replaced on every repair.
+	ObjectPool<Scenery> sceneryPool;
+	ObjectPool<AnimatedDoodad> animatedDoodads;
+	ObjectPool<StaticDoodad> staticDoodads;
 
 	void update(GameState &state, unsigned int ticks);
 
 	sp<Doodad> placeDoodad(const DoodadDef &def, Vec3<float> position);
+
+	// Allocation counts for every pooled object in the city, by pool name. update() publishes what
+	// each tick added as "City.Pool.<name>.*" metrics, HeapAllocations should stay at 0.
+	std::map<UString, PoolStats> getPoolStats() const;
+
+	// Queue everything resting on 'scenery' to collapse once this tick's collisions are done
+	void collapseSupported(const Scenery &scenery);
+
+  private:
+	// Graph nodes waiting to collapse, and the working queue used to spread it
+	std::vector<unsigned int> pendingCollapse;
+	std::vector<unsigned int> collapseQueue;
+
+	// Falling scenery that hit something this tick
+	std::vector<sp<Scenery>> landedScenery;
+
+	// Per-tick gauges for each pool, and its totals at the end of the last tick
+	class PoolMetrics
+	{
+	  public:
+		PoolStats last;
+		MetricGauge *allocations = nullptr;
+		MetricGauge *heapAllocations = nullptr;
+		MetricGauge *live = nullptr;
+	};
+	std::map<UString, PoolMetrics> poolMetrics;
+
+	void processCollapses();
+	void updateFallingScenery(GameState &state, unsigned int ticks);
+	void updatePoolMetrics();
 };
 
 }; // namespace OpenApoc
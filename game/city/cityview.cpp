@@ -450,8 +450,9 @@ void CityView::Update(StageCmd *const cmd)
 	unsigned minutesClamped = minutes % 60;
 	unsigned hoursClamped = hours % 24;
 
-	auto timeString =
-	    UString::format("%02u:%02u:%02u", hoursClamped, minutesClamped, secondsClamped);
+	auto timeString = Strings::FromInteger(hoursClamped, 2) + ":" +
+	                  Strings::FromInteger(minutesClamped, 2) + ":" +
+	                  Strings::FromInteger(secondsClamped, 2);
 	clockControl->SetText(timeString);
 
 	*cmd = stageCmd;
@@ -459,8 +460,6 @@ void CityView::Update(StageCmd *const cmd)
 
 	state->city->update(*state, ticks);
 
-	// FIXME: Possibly more efficient ways than re-generating all controls every frame?
-
 	// Setup owned vehicle list controls
 	auto ownedVehicleList = uiTabs[1]->FindControlTyped<ListBox>("OWNED_VEHICLE_LIST");
 	if (!ownedVehicleList)
@@ -468,49 +467,11 @@ void CityView::Update(StageCmd *const cmd)
 		LogError("Failed to find \"OWNED_VEHICLE_LIST\" control on city tab \"%s\"",
 		         TAB_FORM_NAMES[1].c_str());
 	}
-
-	ownedVehicleList->ItemSpacing = 0;
-
-	auto selected = this->selectedVehicle.lock();
-	std::map<sp<Vehicle>, std::pair<VehicleTileInfo, sp<Control>>> newVehicleListControls;
-
-	ownedVehicleList->Clear();
-
-	if (activeTab == uiTabs[1])
+	else
 	{
-		for (auto &v : state->getPlayer()->vehicles)
-		{
-			auto vehicle = v.lock();
-			if (!vehicle)
-			{
-				continue;
-			}
-			auto info = this->createVehicleInfo(vehicle);
-			auto it = this->vehicleListControls.find(vehicle);
-			sp<Control> control;
-			if (it != this->vehicleListControls.end() && it->second.first == info)
-			{
-				// Control unchanged, don't regenerate
-				control = it->second.second;
-			}
-			else
-			{
-				control = createVehicleInfoControl(info);
-			}
-			newVehicleListControls[vehicle] = std::make_pair(info, control);
-			ownedVehicleList->AddItem(control);
-
-			control->addCallback(FormEventType::MouseDown, [this, vehicle](Event *e) -> void
-			                     {
-				                     this->selectedVehicle = vehicle;
-				                 });
-		}
+		this->updateVehicleList(*ownedVehicleList);
 	}
 
-	// Clear the old list and reset to the new one (May be empty is not on a vehicle-displaying tab
-	this->vehicleListControls.clear();
-	this->vehicleListControls = std::move(newVehicleListControls);
-
 	activeTab->Update();
 	baseForm->Update();
 
@@ -554,7 +515,7 @@ void CityView::EventOccurred(Event *e)
 		std::set<sp<Scenery>> stuffToRepair;
 		for (auto &s : state->city->scenery)
 		{
-			if (s->canRepair())
+			if (s->canRepair(*state->city))
 			{
 				stuffToRepair.insert(s);
 			}
@@ -717,71 +678,170 @@ VehicleTileInfo CityView::createVehicleInfo(sp<Vehicle> v)
 	return t;
 }
 
-sp<Control> CityView::createVehicleInfoControl(const VehicleTileInfo &info)
+void CityView::updateVehicleList(ListBox &list)
 {
-	LogInfo("Creating city info control for vehicle \"%s\"", info.vehicle->name.c_str());
+	if (!this->vehicleListSource)
+	{
+		list.ItemSpacing = 0;
+		this->vehicleListSource = mksp<VehicleListSource>(*this);
+		list.SetDataSource(this->vehicleListSource);
+	}
 
-	auto frame = info.selected ? this->icons[CityIcon::SelectedFrame]
-	                           : this->icons[CityIcon::UnselectedFrame];
+	// The info is cheap to work out for every vehicle, only the rows in view get controls
+	std::vector<VehicleTileInfo> newInfos;
+	if (activeTab == uiTabs[1])
+	{
+		for (auto &v : state->getPlayer()->vehicles)
+		{
+			auto vehicle = v.lock();
+			if (vehicle)
+			{
+				newInfos.push_back(this->createVehicleInfo(vehicle));
+			}
+		}
+	}
+
+	// Vehicles come and go from the middle of the list rarely, so just replace whatever's between
+	// the unchanged start and end
+	auto &oldInfos = this->vehicleListSource->infos;
+	size_t prefix = 0;
+	while (prefix < oldInfos.size() && prefix < newInfos.size() &&
+	       oldInfos[prefix].vehicle == newInfos[prefix].vehicle)
+	{
+		prefix++;
+	}
+	size_t suffix = 0;
+	while (suffix < oldInfos.size() - prefix && suffix < newInfos.size() - prefix &&
+	       oldInfos[oldInfos.size() - 1 - suffix].vehicle ==
+	           newInfos[newInfos.size() - 1 - suffix].vehicle)
+	{
+		suffix++;
+	}
+	size_t removed = oldInfos.size() - prefix - suffix;
+	size_t inserted = newInfos.size() - prefix - suffix;
+	if (removed)
+	{
+		list.ItemsRemoved(prefix, removed);
+	}
+	if (inserted)
+	{
+		list.ItemsInserted(prefix, inserted);
+	}
+	for (size_t i = 0; i < newInfos.size(); i++)
+	{
+		bool kept = i < prefix || i >= prefix + inserted;
+		size_t oldIndex = i < prefix ? i : i - inserted + removed;
+		if (kept && !(oldInfos[oldIndex] == newInfos[i]))
+		{
+			list.ItemsChanged(i, 1);
+		}
+	}
+	oldInfos = std::move(newInfos);
+}
+
+sp<Control> VehicleListSource::BindRow(unsigned int index, sp<Control> recycled)
+{
+	auto row = recycled;
+	if (!row)
+	{
+		row = this->view.createVehicleInfoControl();
+	}
+	this->view.bindVehicleInfoControl(row, this->infos[index]);
+	return row;
+}
+
+sp<Control> CityView::createVehicleInfoControl()
+{
+	auto frame = this->icons[CityIcon::UnselectedFrame];
 	auto baseControl = mksp<GraphicButton>(frame, frame);
 	baseControl->Size = frame->size;
 	// FIXME: There's an extra 1 pixel here that's annoying
 	baseControl->Size.x -= 1;
-	baseControl->Name = "OWNED_VEHICLE_FRAME_" + info.vehicle->name;
 
-	auto vehicleIcon = baseControl->createChild<Graphic>(info.vehicle->type.icon);
+	// The row's vehicle changes as it's rebound, so it's looked up when clicked
+	wp<Control> weakControl = baseControl;
+	baseControl->addCallback(FormEventType::MouseDown, [this, weakControl](Event *e) -> void
+	                         {
+		                         auto control = weakControl.lock();
+		                         if (control)
+		                         {
+			                         this->selectedVehicle = control->GetData<Vehicle>();
+		                         }
+		                     });
+
+	auto vehicleIcon = baseControl->createChild<Graphic>();
 	vehicleIcon->AutoSize = true;
 	vehicleIcon->Location = {1, 1};
+
+	auto healthGraphic = baseControl->createChild<Graphic>();
+	healthGraphic->ImagePosition = FillMethod::Stretch;
+
+	auto stateGraphic = vehicleIcon->createChild<Graphic>();
+	stateGraphic->AutoSize = true;
+	stateGraphic->Location = {0, 0};
+
+	auto passengerGraphic = vehicleIcon->createChild<Graphic>();
+	passengerGraphic->AutoSize = true;
+	passengerGraphic->Location = {0, 0};
+
+	return baseControl;
+}
+
+void CityView::bindVehicleInfoControl(sp<Control> control, const VehicleTileInfo &info)
+{
+	// The parts are in the order createVehicleInfoControl() made them
+	auto baseControl = std::static_pointer_cast<GraphicButton>(control);
+	auto vehicleIcon = std::static_pointer_cast<Graphic>(baseControl->Controls[0]);
+	auto healthGraphic = std::static_pointer_cast<Graphic>(baseControl->Controls[1]);
+	auto stateGraphic = std::static_pointer_cast<Graphic>(vehicleIcon->Controls[0]);
+	auto passengerGraphic = std::static_pointer_cast<Graphic>(vehicleIcon->Controls[1]);
+
+	baseControl->SetData(info.vehicle);
+	auto frame = info.selected ? this->icons[CityIcon::SelectedFrame]
+	                           : this->icons[CityIcon::UnselectedFrame];
+	baseControl->SetImage(frame);
+	baseControl->SetDepressedImage(frame);
+	baseControl->Name = "OWNED_VEHICLE_FRAME_" + info.vehicle->name;
+
+	vehicleIcon->SetImage(info.vehicle->type.icon);
 	vehicleIcon->Name = "OWNED_VEHICLE_ICON_" + info.vehicle->name;
 
 	// FIXME: Put these somewhere slightly less magic?
 	Vec2<int> healthBarOffset = {27, 2};
 	Vec2<int> healthBarSize = {3, 20};
 
-	auto healthImg = info.shield ? this->shieldImage : this->healthImage;
-
-	auto healthGraphic = baseControl->createChild<Graphic>(healthImg);
 	// This is a bit annoying as the health bar starts at the bottom, but the coord origin is
 	// top-left, so fix that up a bit
 	int healthBarHeight = (float)healthBarSize.y * info.healthProportion;
 	healthBarOffset.y = healthBarOffset.y + (healthBarSize.y - healthBarHeight);
 	healthBarSize.y = healthBarHeight;
+	healthGraphic->SetImage(info.shield ? this->shieldImage : this->healthImage);
 	healthGraphic->Location = healthBarOffset;
 	healthGraphic->Size = healthBarSize;
-	healthGraphic->ImagePosition = FillMethod::Stretch;
-
-	sp<Graphic> stateGraphic;
 
 	switch (info.state)
 	{
 		case CityUnitState::InBase:
-			stateGraphic = vehicleIcon->createChild<Graphic>(this->icons[CityIcon::InBase]);
+			stateGraphic->SetImage(this->icons[CityIcon::InBase]);
 			break;
 		case CityUnitState::InVehicle:
-			stateGraphic = vehicleIcon->createChild<Graphic>(this->icons[CityIcon::InVehicle]);
+			stateGraphic->SetImage(this->icons[CityIcon::InVehicle]);
 			break;
 		case CityUnitState::InBuilding:
-			stateGraphic = vehicleIcon->createChild<Graphic>(this->icons[CityIcon::InBuilding]);
+			stateGraphic->SetImage(this->icons[CityIcon::InBuilding]);
 			break;
 		case CityUnitState::InMotion:
-			stateGraphic = vehicleIcon->createChild<Graphic>(this->icons[CityIcon::InMotion]);
+			stateGraphic->SetImage(this->icons[CityIcon::InMotion]);
 			break;
 	}
-
-	stateGraphic->AutoSize = true;
-	stateGraphic->Location = {0, 0};
 	stateGraphic->Name = "OWNED_VEHICLE_STATE_" + info.vehicle->name;
 
+	passengerGraphic->Visible = info.passengers != 0;
 	if (info.passengers)
 	{
-		auto passengerGraphic =
-		    vehicleIcon->createChild<Graphic>(this->vehiclePassengerCountIcons[info.passengers]);
-		passengerGraphic->AutoSize = true;
-		passengerGraphic->Location = {0, 0};
-		passengerGraphic->Name = "OWNED_VEHICLE_PASSENGERS_" + info.vehicle->name;
+		passengerGraphic->SetImage(this->vehiclePassengerCountIcons[info.passengers]);
 	}
-
-	return baseControl;
+	passengerGraphic->Name = "OWNED_VEHICLE_PASSENGERS_" + info.vehicle->name;
 }
 
 bool VehicleTileInfo::operator==(const VehicleTileInfo &other) const
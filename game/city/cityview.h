@@ -2,6 +2,7 @@
 #include "library/sp.h"
 
 #include "game/tileview/tileview.h"
+#include "forms/list.h"
 
 namespace OpenApoc
 {
@@ -64,9 +65,25 @@ class VehicleTileInfo
 	bool operator==(const VehicleTileInfo &other) const;
 };
 
+class CityView;
+
+// Feeds the owned vehicle list, only the rows in view get controls
+class VehicleListSource : public ListBoxDataSource
+{
+  public:
+	CityView &view;
+	std::vector<VehicleTileInfo> infos;
+
+	VehicleListSource(CityView &view) : view(view) {}
+	unsigned int GetItemCount() override { return infos.size(); }
+	sp<Control> BindRow(unsigned int index, sp<Control> recycled) override;
+};
+
 class CityView : public TileView
 {
   private:
+	friend class VehicleListSource;
+
 	sp<Form> activeTab, baseForm;
 	std::vector<sp<Form>> uiTabs;
 	UpdateSpeed updateSpeed;
@@ -76,7 +93,7 @@ class CityView : public TileView
 
 	std::vector<sp<Image>> vehiclePassengerCountIcons;
 
-	std::map<sp<Vehicle>, std::pair<VehicleTileInfo, sp<Control>>> vehicleListControls;
+	sp<VehicleListSource> vehicleListSource;
 
 	wp<Vehicle> selectedVehicle;
 
@@ -87,7 +104,10 @@ class CityView : public TileView
 	bool followVehicle;
 
 	VehicleTileInfo createVehicleInfo(sp<Vehicle> v);
-	sp<Control> createVehicleInfoControl(const VehicleTileInfo &info);
+	// Rows of the vehicle list all have the same parts, so a row can be rebound to any vehicle
+	sp<Control> createVehicleInfoControl();
+	void bindVehicleInfoControl(sp<Control> control, const VehicleTileInfo &info);
+	void updateVehicleList(ListBox &list);
 
 	SelectionState selectionState;
 
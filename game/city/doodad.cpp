@@ -39,26 +39,28 @@ void Doodad::setPosition(Vec3<float> position)
 	this->tileObject->setPosition(position);
 }
 
-sp<Image> AnimatedDoodad::getSprite()
+void AnimatedDoodad::update(GameState &state, int ticks)
 {
-	int animTime = 0;
-	sp<Image> sprite;
-	for (auto &f : def.frames)
-	{
-		sprite = f.image;
-		animTime += f.time;
-		if (animTime >= age)
-			return sprite;
-	}
-	LogWarning("Doodad \"%s\" reached age %d with no frame", def.ID.c_str(), age);
-	return sprite;
+	Doodad::update(state, ticks);
+	if (this->age > this->frameEnd && this->frame + 1 < this->def.frames.size())
+		this->setFrame(this->def.getFrameIndex(this->age));
+}
+
+void AnimatedDoodad::setFrame(unsigned int frame)
+{
+	this->frame = frame;
+	this->frameEnd = this->def.getFrameEnd(frame);
+	this->sprite = this->def.frames[frame].image;
 }
 
-sp<Image> StaticDoodad::getSprite() { return this->sprite; }
+const sp<Image> &AnimatedDoodad::getSprite() { return this->sprite; }
+
+const sp<Image> &StaticDoodad::getSprite() { return this->sprite; }
 
 AnimatedDoodad::AnimatedDoodad(const DoodadDef &def, Vec3<float> position)
-    : Doodad(position, def.imageOffset, true, def.lifetime), def(def)
+    : Doodad(position, def.imageOffset, true, def.lifetime), def(def), frame(0), frameEnd(0)
 {
+	this->setFrame(0);
 }
 
 StaticDoodad::StaticDoodad(sp<Image> sprite, Vec3<float> position, Vec2<int> imageOffset,
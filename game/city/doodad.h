@@ -15,7 +15,7 @@ class GameState;
 class Doodad : public std::enable_shared_from_this<Doodad>
 {
   public:
-	virtual sp<Image> getSprite() = 0;
+	virtual const sp<Image> &getSprite() = 0;
 	const Vec2<int> &getImageOffset() const { return this->imageOffset; }
 	virtual void update(GameState &state, int ticks);
 	const Vec3<float> &getPosition() const { return this->position; }
@@ -41,10 +41,17 @@ class AnimatedDoodad : public Doodad
   public:
 	AnimatedDoodad(const DoodadDef &def, Vec3<float> position);
 	virtual ~AnimatedDoodad() = default;
-	virtual sp<Image> getSprite() override;
+	virtual const sp<Image> &getSprite() override;
+	virtual void update(GameState &state, int ticks) override;
 
   private:
 	const DoodadDef &def;
+	unsigned int frame;
+	// The sprite only changes once 'age' passes this
+	int frameEnd;
+	sp<Image> sprite;
+
+	void setFrame(unsigned int frame);
 };
 
 class StaticDoodad : public Doodad
@@ -53,7 +60,7 @@ class StaticDoodad : public Doodad
 	StaticDoodad(sp<Image> sprite, Vec3<float> position, Vec2<int> imageOffset,
 	             bool temporary = false, int lifetime = 0);
 	virtual ~StaticDoodad() = default;
-	virtual sp<Image> getSprite() override;
+	virtual const sp<Image> &getSprite() override;
 
   private:
 	sp<Image> sprite;
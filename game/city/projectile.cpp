@@ -1,68 +1,208 @@
 #include "library/sp.h"
 #include "game/city/projectile.h"
 #include "framework/logger.h"
-#include "game/gamestate.h"
-#include "game/city/city.h"
+#include "game/tileview/tile.h"
 #include "game/tileview/tileobject_projectile.h"
 #include "game/tileview/voxel.h"
 
 namespace OpenApoc
 {
 
-Projectile::Projectile(sp<Vehicle> firer, Vec3<float> position, Vec3<float> velocity,
-                       unsigned int lifetime, const Colour &colour, float beamLength,
-                       float beamWidth)
-    : type(Type::Beam), position(position), velocity(velocity), age(0), lifetime(lifetime),
-      firer(firer), previousPosition(position), colour(colour), beamLength(beamLength),
-      beamWidth(beamWidth)
-{
-}
+ProjectileManager::ProjectileManager(TileMap &map) : map(map), count(0) {}
 
-void Projectile::update(GameState &state, unsigned int ticks)
+ProjectileManager::~ProjectileManager() { this->clear(); }
+
+ProjectileHandle ProjectileManager::spawn(sp<Vehicle> firer, Vec3<float> position,
+                                          Vec3<float> velocity, unsigned int lifetime,
+                                          const Colour &colour, float beamLength,
+                                          float beamWidth)
 {
-	this->age += ticks;
-	this->previousPosition = this->position;
-	auto newPosition = this->position +
-	                   ((static_cast<float>(ticks) / TICK_SCALE) * this->velocity) / VELOCITY_SCALE;
+	ProjectileHandle handle;
+	if (!this->freeSlots.empty())
+	{
+		handle.slot = this->freeSlots.back();
+		this->freeSlots.pop_back();
+	}
+	else
+	{
+		handle.slot = this->slotIndex.size();
+		this->slotIndex.push_back(0);
+		this->slotGeneration.push_back(0);
+	}
+	handle.generation = this->slotGeneration[handle.slot];
 
-	auto mapSize = this->tileObject->map.size;
+	unsigned int index = this->count++;
+	if (index == this->positionX.size())
+	{
+		unsigned int size = index + 1;
+		this->positionX.resize(size);
+		this->positionY.resize(size);
+		this->positionZ.resize(size);
+		this->previousX.resize(size);
+		this->previousY.resize(size);
+		this->previousZ.resize(size);
+		this->velocityX.resize(size);
+		this->velocityY.resize(size);
+		this->velocityZ.resize(size);
+		this->age.resize(size);
+		this->lifetime.resize(size);
+		this->type.resize(size);
+		this->colour.resize(size);
+		this->beamLength.resize(size);
+		this->beamWidth.resize(size);
+		this->firer.resize(size);
+		this->tileObject.resize(size);
+		this->slotOf.resize(size);
+	}
+	this->slotIndex[handle.slot] = index;
+	this->slotOf[index] = handle.slot;
 
-	// Remove projectile if it's ran out of life or fell off the end of the world
-	if (newPosition.x < 0 || newPosition.x >= mapSize.x || newPosition.y < 0 ||
-	    newPosition.y >= mapSize.y || newPosition.z < 0 || newPosition.z >= mapSize.z ||
-	    this->age >= this->lifetime)
+	this->positionX[index] = this->previousX[index] = position.x;
+	this->positionY[index] = this->previousY[index] = position.y;
+	this->positionZ[index] = this->previousZ[index] = position.z;
+	this->velocityX[index] = velocity.x;
+	this->velocityY[index] = velocity.y;
+	this->velocityZ[index] = velocity.z;
+	this->age[index] = 0;
+	this->lifetime[index] = lifetime;
+	this->type[index] = Type::Beam;
+	this->colour[index] = colour;
+	this->beamLength[index] = beamLength;
+	this->beamWidth[index] = beamWidth;
+	this->firer[index] = firer;
+
+	sp<TileObjectProjectile> obj;
+	if (!this->spareTileObjects.empty())
 	{
-		auto this_shared = shared_from_this();
-		state.city->projectiles.erase(std::dynamic_pointer_cast<Projectile>(this_shared));
-		this->tileObject->removeFromMap();
-		this->tileObject.reset();
+		obj = std::move(this->spareTileObjects.back());
+		this->spareTileObjects.pop_back();
+		obj->handle = handle;
 	}
 	else
 	{
-		this->position = newPosition;
-		this->tileObject->setPosition(newPosition);
+		// FIXME: mksp<> doesn't work for private (but accessible due to friend)
+		// constructors?
+		obj.reset(new TileObjectProjectile(this->map, *this, handle, position));
 	}
+	obj->setPosition(position);
+	this->tileObject[index] = obj;
+	return handle;
 }
 
-Collision Projectile::checkProjectileCollision(TileMap &map)
+void ProjectileManager::update(unsigned int ticks)
 {
-	if (!this->tileObject)
+	float scale = static_cast<float>(ticks) / TICK_SCALE;
+	auto step = Vec3<float>{scale, scale, scale} / VELOCITY_SCALE;
+	const float stepX = step.x, stepY = step.y, stepZ = step.z;
+	const unsigned int n = this->count;
+
+	// Kept as plain arrays so this loop vectorises
+	float *__restrict px = this->positionX.data();
+	float *__restrict py = this->positionY.data();
+	float *__restrict pz = this->positionZ.data();
+	float *__restrict ox = this->previousX.data();
+	float *__restrict oy = this->previousY.data();
+	float *__restrict oz = this->previousZ.data();
+	const float *__restrict vx = this->velocityX.data();
+	const float *__restrict vy = this->velocityY.data();
+	const float *__restrict vz = this->velocityZ.data();
+	unsigned int *__restrict a = this->age.data();
+	for (unsigned int i = 0; i < n; i++)
+	{
+		ox[i] = px[i];
+		oy[i] = py[i];
+		oz[i] = pz[i];
+		px[i] += vx[i] * stepX;
+		py[i] += vy[i] * stepY;
+		pz[i] += vz[i] * stepZ;
+		a[i] += ticks;
+	}
+
+	// Remove projectiles that ran out of life or fell off the end of the world
+	auto mapSize = this->map.size;
+	this->expired.clear();
+	for (unsigned int i = 0; i < n; i++)
 	{
-		// It's possible the projectile reached the end of it's lifetime this frame
-		// so ignore stuff without a tile
-		return {};
+		if (px[i] < 0 || px[i] >= mapSize.x || py[i] < 0 || py[i] >= mapSize.y || pz[i] < 0 ||
+		    pz[i] >= mapSize.z || a[i] >= this->lifetime[i])
+			this->expired.push_back(i);
 	}
-	Collision c = map.findCollision(this->previousPosition, this->position);
-	c.projectile = shared_from_this();
+	// Removing moves the last projectile into the gap, so go backwards to never move one that's
+	// still waiting to be removed
+	for (auto it = this->expired.rbegin(); it != this->expired.rend(); ++it)
+		this->removeIndex(*it);
+
+	for (unsigned int i = 0; i < this->count; i++)
+		this->tileObject[i]->setPosition(this->getPosition(i));
+}
+
+Collision ProjectileManager::checkCollision(unsigned int index) const
+{
+	Collision c = this->map.findCollision(
+	    {this->previousX[index], this->previousY[index], this->previousZ[index]},
+	    this->getPosition(index));
+	c.projectile = this->getHandle(index);
 	return c;
 }
 
-Projectile::~Projectile()
+void ProjectileManager::removeIndex(unsigned int index)
+{
+	auto slot = this->slotOf[index];
+	this->tileObject[index]->removeFromMap();
+	this->spareTileObjects.push_back(std::move(this->tileObject[index]));
+	this->firer[index].reset();
+	this->slotGeneration[slot]++;
+	this->freeSlots.push_back(slot);
+
+	unsigned int last = --this->count;
+	if (index == last)
+		return;
+	this->positionX[index] = this->positionX[last];
+	this->positionY[index] = this->positionY[last];
+	this->positionZ[index] = this->positionZ[last];
+	this->previousX[index] = this->previousX[last];
+	this->previousY[index] = this->previousY[last];
+	this->previousZ[index] = this->previousZ[last];
+	this->velocityX[index] = this->velocityX[last];
+	this->velocityY[index] = this->velocityY[last];
+	this->velocityZ[index] = this->velocityZ[last];
+	this->age[index] = this->age[last];
+	this->lifetime[index] = this->lifetime[last];
+	this->type[index] = this->type[last];
+	this->colour[index] = this->colour[last];
+	this->beamLength[index] = this->beamLength[last];
+	this->beamWidth[index] = this->beamWidth[last];
+	this->firer[index] = std::move(this->firer[last]);
+	this->tileObject[index] = std::move(this->tileObject[last]);
+	this->slotOf[index] = this->slotOf[last];
+	this->slotIndex[this->slotOf[index]] = index;
+}
+
+void ProjectileManager::remove(ProjectileHandle handle)
 {
-	if (this->tileObject)
+	if (!this->isLive(handle))
 	{
-		this->tileObject->removeFromMap();
+		// It's possible the projectile was already removed this frame (e.g. it hit two things)
+		return;
 	}
+	this->removeIndex(this->slotIndex[handle.slot]);
+}
+
+void ProjectileManager::clear()
+{
+	while (this->count)
+		this->removeIndex(this->count - 1);
+	this->spareTileObjects.clear();
+}
+
+bool ProjectileManager::isLive(ProjectileHandle handle) const
+{
+	if (handle.slot >= this->slotGeneration.size())
+		return false;
+	if (this->slotGeneration[handle.slot] != handle.generation)
+		return false;
+	auto index = this->slotIndex[handle.slot];
+	return index < this->count && this->slotOf[index] == handle.slot;
 }
 
 }; // namespace OpenApoc
@@ -3,17 +3,39 @@
 #include "library/vec.h"
 #include "library/colour.h"
 
+#include <vector>
+
 namespace OpenApoc
 {
 
 class Vehicle;
-class Weapon;
-class GameState;
 class TileObjectProjectile;
 class TileMap;
 class Collision;
 
-class Projectile : public std::enable_shared_from_this<Projectile>
+// Refers to a projectile owned by a ProjectileManager. Slots are reused, so the generation makes
+// sure a handle to a projectile that's since been removed doesn't pick up whatever replaced it.
+class ProjectileHandle
+{
+  public:
+	static const unsigned int InvalidSlot = ~0u;
+	unsigned int slot = InvalidSlot;
+	unsigned int generation = 0;
+
+	explicit operator bool() const { return slot != InvalidSlot; }
+	bool operator==(const ProjectileHandle &other) const
+	{
+		return slot == other.slot && generation == other.generation;
+	}
+	bool operator!=(const ProjectileHandle &other) const { return !(*this == other); }
+};
+
+// Owns every projectile in the city. Rather than each shot being its own object, the per-frame
+// state lives in tightly packed arrays (live projectiles are always [0, getCount()), a removed
+// projectile is replaced by the last one) so moving them all is a single loop with no virtual
+// calls or pointer chasing. Slots, their tile objects and the array storage are all reused, so
+// sustained fire doesn't allocate once the high water mark has been reached.
+class ProjectileManager
 {
   public:
 	enum class Type
@@ -22,38 +44,85 @@ class Projectile : public std::enable_shared_from_this<Projectile>
 		Missile,
 	};
 
+  private:
+	TileMap &map;
+
+	// Hot data, indexed by position in the packed arrays
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> previousX, previousY, previousZ;
+	std::vector<float> velocityX, velocityY, velocityZ;
+	std::vector<unsigned int> age;
+	std::vector<unsigned int> lifetime;
+
+	// Cold data, only touched when drawing or on collision
+	std::vector<Type> type;
+	std::vector<Colour> colour;
 	// Beams have a width & tail length
 	// FIXME: Make this a non-constant colour?
 	// FIXME: Width is currently just used for drawing - TODO What is "collision" size of beams?
-	Projectile(sp<Vehicle> firer, Vec3<float> position, Vec3<float> velocity, unsigned int lifetime,
-	           const Colour &colour, float beamLength, float beamWidth);
-	virtual void update(GameState &state, unsigned int ticks);
+	std::vector<float> beamLength;
+	std::vector<float> beamWidth;
+	std::vector<sp<Vehicle>> firer;
+	std::vector<sp<TileObjectProjectile>> tileObject;
+	// The slot each packed entry belongs to
+	std::vector<unsigned int> slotOf;
 
-	Vec3<float> getVelocity() const { return this->velocity; }
-	unsigned int getLifetime() const { return this->lifetime; }
-	unsigned int getAge() const { return this->age; }
-	sp<Vehicle> getFiredBy() const { return this->firer; }
-	Vec3<float> getPosition() const { return this->position; }
+	// Indexed by slot
+	std::vector<unsigned int> slotIndex;
+	std::vector<unsigned int> slotGeneration;
+	std::vector<unsigned int> freeSlots;
 
-	Collision checkProjectileCollision(TileMap &map);
+	// Tile objects of removed projectiles, kept to be handed to new ones
+	std::vector<sp<TileObjectProjectile>> spareTileObjects;
 
-	virtual ~Projectile();
+	unsigned int count;
+	// Packed entries that have expired or left the map during the last update
+	std::vector<unsigned int> expired;
 
-	sp<TileObjectProjectile> tileObject;
+	void removeIndex(unsigned int index);
 
-  private:
-	Type type;
-	Vec3<float> position;
-	Vec3<float> velocity;
-	unsigned int age;
-	unsigned int lifetime;
-	sp<Vehicle> firer;
-	Vec3<float> previousPosition;
-	Colour colour;
-	float beamLength;
-	float beamWidth;
-
-	friend class Weapon;
-	friend class TileObjectProjectile;
+  public:
+	ProjectileManager(TileMap &map);
+	~ProjectileManager();
+
+	ProjectileHandle spawn(sp<Vehicle> firer, Vec3<float> position, Vec3<float> velocity,
+	                       unsigned int lifetime, const Colour &colour, float beamLength,
+	                       float beamWidth);
+	// Moves every projectile and removes the ones that ran out of life or left the map
+	void update(unsigned int ticks);
+	// Check the path the projectile at 'index' took in the last update against the map. This only
+	// reads the map and this index, so different indices can be checked from different threads.
+	Collision checkCollision(unsigned int index) const;
+	void remove(ProjectileHandle handle);
+	// Removes everything, must be done before the TileMap is destroyed
+	void clear();
+
+	bool isLive(ProjectileHandle handle) const;
+	// The packed index of a live projectile, only valid until the next update or remove
+	unsigned int getIndex(ProjectileHandle handle) const { return slotIndex[handle.slot]; }
+	unsigned int getCount() const { return count; }
+	ProjectileHandle getHandle(unsigned int index) const
+	{
+		ProjectileHandle handle;
+		handle.slot = slotOf[index];
+		handle.generation = slotGeneration[handle.slot];
+		return handle;
+	}
+
+	Vec3<float> getPosition(unsigned int index) const
+	{
+		return {positionX[index], positionY[index], positionZ[index]};
+	}
+	Vec3<float> getVelocity(unsigned int index) const
+	{
+		return {velocityX[index], velocityY[index], velocityZ[index]};
+	}
+	unsigned int getAge(unsigned int index) const { return age[index]; }
+	unsigned int getLifetime(unsigned int index) const { return lifetime[index]; }
+	Type getType(unsigned int index) const { return type[index]; }
+	const Colour &getColour(unsigned int index) const { return colour[index]; }
+	float getBeamLength(unsigned int index) const { return beamLength[index]; }
+	float getBeamWidth(unsigned int index) const { return beamWidth[index]; }
+	sp<Vehicle> getFiredBy(unsigned int index) const { return firer[index]; }
 };
 }; // namespace OpenApoc
@@ -11,7 +11,7 @@
 namespace OpenApoc
 {
 Scenery::Scenery(const SceneryTileDef &tileDef, Vec3<int> pos, sp<Building> bld)
-    : tileDef(tileDef), pos(pos), building(bld), damaged(false), falling(false)
+    : tileDef(tileDef), pos(pos), building(bld), graphIndex(0), damaged(false), falling(false)
 {
 }
 
@@ -54,87 +54,10 @@ void Scenery::handleCollision(GameState &state, Collision &c)
 	if (this->overlayDoodad)
 		this->overlayDoodad->remove(state);
 	this->overlayDoodad = nullptr;
-	for (auto &s : this->supports)
-		s->collapse(state);
+	state.city->collapseSupported(*this);
 }
 
-void Scenery::collapse(GameState &state)
-{
-	// IF it's already falling or destroyed do nothing
-	if (this->falling || !this->tileObject)
-		return;
-	// Landing pads can't collapse, and may magically float, otherwise it screws up pathing (same
-	// reason why they can't be destroyed when hit)
-	if (this->tileDef.getIsLandingPad())
-		return;
-	this->falling = true;
-
-	auto ret = state.city->fallingScenery.insert(shared_from_this());
-	if (ret.second == false)
-	{
-		LogError("Scenery object already in fallingSenery list?");
-	}
-
-	for (auto &s : this->supports)
-		s->collapse(state);
-}
-
-void Scenery::update(GameState &state, unsigned int ticks)
-{
-	if (!this->falling)
-		LogError("Not falling?");
-	if (!this->tileObject)
-	{
-		LogError("Falling scenery with no object?");
-	}
-
-	auto currentPos = this->tileObject->getPosition();
-	// FIXME: gravity acceleration?
-	currentPos.z -= static_cast<float>(ticks) / 16.0f;
-	this->tileObject->setPosition(currentPos);
-	if (this->overlayDoodad)
-		this->overlayDoodad->setPosition(this->tileObject->getPosition());
-
-	for (auto &obj : this->tileObject->getOwningTile()->ownedObjects)
-	{
-		switch (obj->getType())
-		{
-			case TileObject::Type::Scenery:
-			{
-				auto sceneryTile = std::static_pointer_cast<TileObjectScenery>(obj);
-				// Skip stuff already falling (wil include this)
-				if (sceneryTile->getOwner()->falling)
-					continue;
-				// Any other scenery
-				// FIXME: Cause damage to scenery we hit?
-				this->falling = false;
-				auto doodad = state.city->placeDoodad(
-				    state.getRules().getDoodadDef("DOODAD_EXPLOSION_3"), currentPos);
-				this->tileObject->removeFromMap();
-				this->tileObject.reset();
-				if (this->overlayDoodad)
-					this->overlayDoodad->remove(state);
-				this->overlayDoodad = nullptr;
-				auto count = state.city->fallingScenery.erase(shared_from_this());
-				if (count != 1)
-				{
-					LogError("Removed %u objects from fallingScenery list?",
-					         static_cast<unsigned>(count));
-				}
-				// return as we can't be destroyed more than once
-				return;
-			}
-			case TileObject::Type::Vehicle:
-				// FIXME: Cause damage to vehicles we hit?
-				break;
-			default:
-				// Ignore other object types?
-				break;
-		}
-	}
-}
-
-bool Scenery::canRepair() const
+bool Scenery::canRepair(const City &city) const
 {
 	// Don't fix it if it ain't broken
 
@@ -143,7 +66,8 @@ bool Scenery::canRepair() const
 	// FIXME: Check how apoc repairs stuff, for now allow repair if at least one support is
 	// available
 	//(IE it's attached to /something/)
-	if (this->supportedBy.size() == 0)
+	auto supportedBy = city.supportGraph.getSupportedBy(this->graphIndex);
+	if (supportedBy.empty())
 	{
 		/* Tiles at z == 0 can get damaged (But not destroyed!) but have no support */
 		if (this->damaged)
@@ -151,9 +75,9 @@ bool Scenery::canRepair() const
 		LogWarning("Scenery not supported but destroyed?");
 		return true;
 	}
-	for (auto &s : this->supportedBy)
+	for (auto s : supportedBy)
 	{
-		if (s->isAlive())
+		if (city.supportGraph.getNode(s)->isAlive())
 			return true;
 	}
 	return false;
@@ -173,12 +97,12 @@ void Scenery::repair(GameState &state)
 	if (this->overlayDoodad)
 		this->overlayDoodad->remove(state);
 	this->overlayDoodad = nullptr;
-	map.addObjectToMap(shared_from_this());
+	map.addObjectToMap(state.city->sceneryPool.getHandle(this));
 	if (tileDef.getOverlaySprite())
 	{
-		this->overlayDoodad = mksp<StaticDoodad>(tileDef.getOverlaySprite(), this->getPosition(),
-		                                         tileDef.getImageOffset());
-		map.addObjectToMap(this->overlayDoodad);
+		this->overlayDoodad = state.city->staticDoodads.create(
+		    tileDef.getOverlaySprite(), this->getPosition(), tileDef.getImageOffset());
+		map.addObjectToMap(state.city->staticDoodads.getHandle(this->overlayDoodad.get()));
 	}
 }
 
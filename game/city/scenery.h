@@ -14,6 +14,7 @@ class Collision;
 class GameState;
 class TileMap;
 class StaticDoodad;
+class City;
 
 class Scenery : public std::enable_shared_from_this<Scenery>
 {
@@ -33,18 +34,15 @@ class Scenery : public std::enable_shared_from_this<Scenery>
 	sp<Building> building;
 	sp<TileObjectScenery> tileObject;
 
-	std::set<sp<Scenery>> supports;
-	std::set<sp<Scenery>> supportedBy;
+	// This tile's node in City::supportGraph
+	unsigned int graphIndex;
 
 	void handleCollision(GameState &state, Collision &c);
 
 	bool damaged;
 	bool falling;
 
-	void update(GameState &state, unsigned int ticks);
-	void collapse(GameState &state);
-
-	bool canRepair() const;
+	bool canRepair(const City &city) const;
 	void repair(GameState &state);
 
 	bool isAlive() const;
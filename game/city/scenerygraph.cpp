@@ -0,0 +1,126 @@
+#include "game/city/scenerygraph.h"
+#include "game/city/scenery.h"
+#include "framework/logger.h"
+#include "framework/trace.h"
+#include "framework/ThreadPool/ThreadPool.h"
+
+#include <future>
+
+namespace OpenApoc
+{
+
+namespace
+{
+
+class SliceEdges
+{
+  public:
+	// Pairs of (supporter, supported)
+	std::vector<std::pair<unsigned int, unsigned int>> edges;
+	std::vector<Vec3<int>> unsupported;
+};
+
+void buildOffsets(std::vector<unsigned int> &offsets, const std::vector<unsigned int> &counts)
+{
+	offsets.resize(counts.size() + 1);
+	offsets[0] = 0;
+	for (size_t i = 0; i < counts.size(); i++)
+		offsets[i + 1] = offsets[i] + counts[i];
+}
+
+} // anonymous namespace
+
+void ScenerySupportGraph::build(std::vector<Scenery *> sceneryNodes, Vec3<int> mapSize,
+                                ThreadPool &pool)
+{
+	TRACE_FN;
+	this->nodes = std::move(sceneryNodes);
+	this->mapSize = mapSize;
+
+	// Find the scenery in each tile directly rather than through each tile's object set
+	const int noScenery = -1;
+	auto &nodeAt = this->nodeAt;
+	nodeAt.assign(mapSize.x * mapSize.y * mapSize.z, noScenery);
+	auto tileIndex = [mapSize](int x, int y, int z) { return (z * mapSize.y + y) * mapSize.x + x; };
+	for (auto *s : this->nodes)
+		nodeAt[tileIndex(s->pos.x, s->pos.y, s->pos.z)] = s->graphIndex;
+
+	// Each slice only reads the one below it, so they can all be linked up at once
+	std::vector<SliceEdges> slices(mapSize.z);
+	std::vector<std::future<void>> tasks;
+	for (int z = 1; z < mapSize.z; z++)
+	{
+		tasks.emplace_back(pool.enqueue([&, z]() {
+			auto &slice = slices[z];
+			static const Vec2<int> dirs[] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+			for (int y = 0; y < mapSize.y; y++)
+			{
+				for (int x = 0; x < mapSize.x; x++)
+				{
+					int node = nodeAt[tileIndex(x, y, z)];
+					if (node == noScenery)
+						continue;
+					int below = nodeAt[tileIndex(x, y, z - 1)];
+					if (below != noScenery)
+					{
+						slice.edges.emplace_back(below, node);
+						continue;
+					}
+					bool supported = false;
+					for (auto &d : dirs)
+					{
+						int nx = x + d.x;
+						int ny = y + d.y;
+						if (nx < 0 || nx >= mapSize.x || ny < 0 || ny >= mapSize.y)
+							continue;
+						int beside = nodeAt[tileIndex(nx, ny, z)];
+						if (beside == noScenery)
+							continue;
+						slice.edges.emplace_back(beside, node);
+						supported = true;
+					}
+					if (!supported)
+						slice.unsupported.emplace_back(x, y, z);
+				}
+			}
+		}));
+	}
+	for (auto &task : tasks)
+		task.wait();
+
+	std::vector<unsigned int> supportsCount(this->nodes.size(), 0);
+	std::vector<unsigned int> supportedByCount(this->nodes.size(), 0);
+	for (auto &slice : slices)
+	{
+		for (auto &edge : slice.edges)
+		{
+			supportsCount[edge.first]++;
+			supportedByCount[edge.second]++;
+		}
+		for (auto &pos : slice.unsupported)
+			LogWarning("Scenery tile at {%d,%d,%d} has no support", pos.x, pos.y, pos.z);
+	}
+	buildOffsets(this->supportsOffsets, supportsCount);
+	buildOffsets(this->supportedByOffsets, supportedByCount);
+
+	// Reuse the counts as each node's fill position
+	this->supportsEdges.resize(this->supportsOffsets.back());
+	this->supportedByEdges.resize(this->supportedByOffsets.back());
+	for (size_t i = 0; i < this->nodes.size(); i++)
+	{
+		supportsCount[i] = this->supportsOffsets[i];
+		supportedByCount[i] = this->supportedByOffsets[i];
+	}
+	for (auto &slice : slices)
+	{
+		for (auto &edge : slice.edges)
+		{
+			this->supportsEdges[supportsCount[edge.first]++] = edge.second;
+			this->supportedByEdges[supportedByCount[edge.second]++] = edge.first;
+		}
+	}
+	LogInfo("Built scenery support graph with %u tiles and %u supports",
+	        static_cast<unsigned>(this->nodes.size()), static_cast<unsigned>(this->getEdgeCount()));
+}
+
+} // namespace OpenApoc
@@ -0,0 +1,74 @@
+#pragma once
+#include "library/vec.h"
+
+#include <vector>
+
+class ThreadPool;
+
+namespace OpenApoc
+{
+
+class Scenery;
+
+// Which scenery tiles hold up which, stored as compressed adjacency arrays indexed by
+// Scenery::graphIndex. A tile is supported by whatever is directly below it or, if nothing is,
+// by the tiles beside it. The city never adds or removes scenery objects (destroyed ones just
+// lose their tile object), so the graph is built once.
+class ScenerySupportGraph
+{
+  public:
+	class Range
+	{
+	  private:
+		const unsigned int *first;
+		const unsigned int *last;
+
+	  public:
+		Range(const unsigned int *first, const unsigned int *last) : first(first), last(last) {}
+		const unsigned int *begin() const { return first; }
+		const unsigned int *end() const { return last; }
+		bool empty() const { return first == last; }
+		size_t size() const { return last - first; }
+	};
+
+  private:
+	std::vector<Scenery *> nodes;
+	// The node whose home is each tile, or -1
+	std::vector<int> nodeAt;
+	Vec3<int> mapSize;
+	// The edges of node i are [offsets[i], offsets[i + 1]) in the matching edge array
+	std::vector<unsigned int> supportsOffsets;
+	std::vector<unsigned int> supportsEdges;
+	std::vector<unsigned int> supportedByOffsets;
+	std::vector<unsigned int> supportedByEdges;
+
+  public:
+	// 'nodes' must already have their graphIndex set to their position in the vector. Each z
+	// slice is linked up as a separate task on 'pool'.
+	void build(std::vector<Scenery *> nodes, Vec3<int> mapSize, ThreadPool &pool);
+
+	Scenery *getNode(unsigned int index) const { return nodes[index]; }
+	// The scenery that belongs in the tile at 'pos' (whether or not it's still there), or null
+	Scenery *getNodeAt(Vec3<int> pos) const
+	{
+		int node = nodeAt[(pos.z * mapSize.y + pos.y) * mapSize.x + pos.x];
+		return node < 0 ? nullptr : nodes[node];
+	}
+	size_t getNodeCount() const { return nodes.size(); }
+	size_t getEdgeCount() const { return supportsEdges.size(); }
+
+	// The tiles that rest on 'index'
+	Range getSupports(unsigned int index) const
+	{
+		return {supportsEdges.data() + supportsOffsets[index],
+		        supportsEdges.data() + supportsOffsets[index + 1]};
+	}
+	// The tiles 'index' rests on
+	Range getSupportedBy(unsigned int index) const
+	{
+		return {supportedByEdges.data() + supportedByOffsets[index],
+		        supportedByEdges.data() + supportedByOffsets[index + 1]};
+	}
+};
+
+} // namespace OpenApoc
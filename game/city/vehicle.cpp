@@ -227,13 +227,8 @@ void Vehicle::update(GameState &state, unsigned int ticks)
 					// and fire at the center of the tile
 					auto target = closestEnemy->getPosition();
 					target += Vec3<float>{0.5, 0.5, 0.5};
-					auto projectile = weapon->fire(target);
-					if (projectile)
-					{
-						vehicleTile->map.addObjectToMap(projectile);
-						state.city->projectiles.insert(projectile);
-					}
-					else
+					auto projectile = weapon->fire(state.city->projectiles, target);
+					if (!projectile)
 					{
 						LogWarning("Fire() produced no object");
 					}
@@ -55,7 +55,7 @@ class FlyingVehicleCanEnterTileHelper : public CanEnterTileHelper
 			if (obj->getType() == TileObject::Type::Scenery)
 			{
 				auto sceneryTile = std::static_pointer_cast<TileObjectScenery>(obj);
-				if (sceneryTile->scenery.lock()->tileDef.getIsLandingPad())
+				if (sceneryTile->scenery.get()->tileDef.getIsLandingPad())
 				{
 					continue;
 				}
@@ -10,7 +10,8 @@ class VGeneralEquipmentType;
 class VWeaponType;
 class VEngineType;
 class Vehicle;
-class Projectile;
+class ProjectileManager;
+class ProjectileHandle;
 
 class VEquipment
 {
@@ -67,6 +68,6 @@ class VWeapon : public VEquipment
 	// Reload uses up to 'ammoAvailable' to reload the weapon. It returns the amount
 	// actually used.
 	int reload(int ammoAvailable);
-	sp<Projectile> fire(Vec3<float> target);
+	ProjectileHandle fire(ProjectileManager &projectiles, Vec3<float> target);
 };
 } // namespace OpenApoc
@@ -14,7 +14,7 @@ VWeapon::VWeapon(const VWeaponType &type, sp<Vehicle> owner, int initialAmmo, St
     : VEquipment(type), state(initialState), owner(owner), ammo(initialAmmo), reloadTime(0)
 {
 }
-sp<Projectile> VWeapon::fire(Vec3<float> target)
+ProjectileHandle VWeapon::fire(ProjectileManager &projectiles, Vec3<float> target)
 {
 	auto &weaponType = static_cast<const VWeaponType &>(this->type);
 	auto owner = this->owner.lock();
@@ -30,12 +30,12 @@ sp<Projectile> VWeapon::fire(Vec3<float> target)
 	if (this->state != State::Ready)
 	{
 		LogWarning("Trying to fire weapon in state %d", this->state);
-		return nullptr;
+		return {};
 	}
 	if (this->ammo <= 0 && this->type.max_ammo != 0)
 	{
 		LogWarning("Trying to fire weapon with no ammo");
-		return nullptr;
+		return {};
 	}
 	this->reloadTime = weaponType.fire_delay * TICK_SCALE;
 	this->state = State::Reloading;
@@ -93,9 +93,9 @@ sp<Projectile> VWeapon::fire(Vec3<float> target)
 			         weaponType.id.c_str());
 	}
 
-	return mksp<Projectile>(owner, vehicleTile->getPosition(), velocity,
-	                        static_cast<int>(this->getRange() / weaponType.speed * TICK_SCALE), c,
-	                        weaponType.tail_size, 2.0f);
+	return projectiles.spawn(owner, vehicleTile->getPosition(), velocity,
+	                         static_cast<int>(this->getRange() / weaponType.speed * TICK_SCALE), c,
+	                         weaponType.tail_size, 2.0f);
 }
 
 void VWeapon::update(int ticks)
@@ -4,6 +4,8 @@
 #include "framework/logger.h"
 #include "framework/framework.h"
 
+#include <algorithm>
+
 namespace OpenApoc
 {
 
@@ -78,6 +80,21 @@ bool RulesLoader::ParseDoodadDefinition(Rules &rules, tinyxml2::XMLElement *root
 		LogError("Doodad \"%s\" has no frames?", d.ID.c_str());
 		return false;
 	}
+	// Each frame is shown up to and including the age its time adds up to
+	int animTime = 0;
+	for (unsigned int i = 0; i < d.frames.size(); i++)
+	{
+		animTime += std::max(0, d.frames[i].time);
+		while (d.frameAtAge.size() <= static_cast<size_t>(animTime))
+			d.frameAtAge.push_back(i);
+		d.frameEnd.push_back(animTime);
+	}
+	if (d.lifetime > animTime)
+	{
+		LogWarning("Doodad \"%s\" lifetime %d is longer than its frames (%d), holding the last "
+		           "frame",
+		           d.ID.c_str(), d.lifetime, animTime);
+	}
 
 	if (rules.doodads.find(d.ID) != rules.doodads.end())
 	{
@@ -26,6 +26,24 @@ class DoodadDef
 	int lifetime;
 	Vec2<int> imageOffset;
 	std::vector<DoodadFrame> frames;
+	// The index into 'frames' to show at each age, up to the end of the last frame. Built when the
+	// rules are loaded so doodads never have to walk the frame list.
+	std::vector<unsigned int> frameAtAge;
+
+	// After the last frame ends that frame is held
+	unsigned int getFrameIndex(int age) const
+	{
+		if (age < 0)
+			return 0;
+		if (static_cast<size_t>(age) >= frameAtAge.size())
+			return frames.size() - 1;
+		return frameAtAge[age];
+	}
+	// The last age 'frame' is shown at
+	int getFrameEnd(unsigned int frame) const { return frameEnd[frame]; }
+
+  private:
+	std::vector<int> frameEnd;
 };
 
 } // namespace OpenApoc
@@ -1,8 +1,7 @@
 #include "library/sp.h"
 #include "game/tileview/tile.h"
+#include "framework/metrics.h"
 #include "framework/trace.h"
-#include "game/tileview/tileobject_projectile.h"
-#include "game/city/projectile.h"
 #include "game/tileview/tileobject_vehicle.h"
 #include "game/tileview/tileobject_shadow.h"
 #include "game/city/vehicle.h"
@@ -11,14 +10,17 @@
 #include "game/tileview/tileobject_doodad.h"
 #include "game/city/doodad.h"
 
+#include <algorithm>
 #include <unordered_map>
 
 namespace OpenApoc
 {
 
 TileMap::TileMap(Vec3<int> size, std::vector<std::set<TileObject::Type>> layerMap)
-    : layerMap(layerMap), size(size)
+    : layerMap(layerMap), occupancyRowWords((size.x + 63) / 64), sceneryObjects(1024),
+      doodadObjects(1024), size(size)
 {
+	occupancy.resize(this->getLayerCount() * size.z * size.y * occupancyRowWords);
 	tiles.reserve(size.z * size.y * size.z);
 	for (int z = 0; z < size.z; z++)
 	{
@@ -137,6 +139,9 @@ std::list<Tile *> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> destinat
                                             const CanEnterTileHelper &canEnterTile)
 {
 	TRACE_FN;
+	static auto &searches = Metrics::counter("Pathfinding.Searches");
+	static auto &expansions = Metrics::counter("Pathfinding.Expansions");
+	searches.add();
 	PathNodeComparer c;
 	std::unordered_map<Tile *, PathNode> visitedTiles;
 	std::set<PathNode, PathNodeComparer> fringe(c);
@@ -197,6 +202,7 @@ std::list<Tile *> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> destinat
 		}
 		auto nodeToExpand = *first;
 		fringe.erase(first);
+		expansions.add();
 
 		// Make it so we always try to move at least one tile
 		if (closestNodeSoFar.parentTile == nullptr)
@@ -258,19 +264,6 @@ std::list<Tile *> TileMap::findShortestPath(Vec3<int> origin, Vec3<int> destinat
 	return getPathToNode(visitedTiles, closestNodeSoFar);
 }
 
-void TileMap::addObjectToMap(sp<Projectile> projectile)
-{
-	if (projectile->tileObject)
-	{
-		LogError("Projectile already has tile object");
-	}
-	// FIXME: mksp<> doesn't work for private (but accessible due to friend)
-	// constructors?
-	sp<TileObjectProjectile> obj(new TileObjectProjectile(*this, projectile));
-	obj->setPosition(projectile->getPosition());
-	projectile->tileObject = obj;
-}
-
 void TileMap::addObjectToMap(sp<Vehicle> vehicle)
 {
 	if (vehicle->tileObject)
@@ -292,28 +285,26 @@ void TileMap::addObjectToMap(sp<Vehicle> vehicle)
 	vehicle->shadowObject = shadow;
 }
 
-void TileMap::addObjectToMap(sp<Scenery> scenery)
+void TileMap::addObjectToMap(PoolHandle<Scenery> handle)
 {
+	auto *scenery = handle.get();
 	if (scenery->tileObject)
 	{
 		LogError("Scenery already has tile object");
 	}
-	// FIXME: mksp<> doesn't work for private (but accessible due to friend)
-	// constructors?
-	sp<TileObjectScenery> obj(new TileObjectScenery(*this, scenery));
+	auto obj = this->sceneryObjects.create(*this, handle);
 	obj->setPosition(scenery->getPosition());
 	scenery->tileObject = obj;
 }
 
-void TileMap::addObjectToMap(sp<Doodad> doodad)
+void TileMap::addObjectToMap(PoolHandle<Doodad> handle)
 {
+	auto *doodad = handle.get();
 	if (doodad->tileObject)
 	{
 		LogError("Doodad already has tile object");
 	}
-	// FIXME: mksp<> doesn't work for private (but accessible due to friend)
-	// constructors?
-	sp<TileObjectDoodad> obj(new TileObjectDoodad(*this, doodad));
+	auto obj = this->doodadObjects.create(*this, handle);
 	obj->setPosition(doodad->getPosition());
 	doodad->tileObject = obj;
 }
@@ -333,4 +324,47 @@ int TileMap::getLayer(TileObject::Type type) const
 
 int TileMap::getLayerCount() const { return this->layerMap.size(); }
 
+void TileMap::updateOccupancy(const Tile &tile, int layer)
+{
+	auto &pos = tile.position;
+	auto &word = this->occupancy[((layer * size.z + pos.z) * size.y + pos.y) * occupancyRowWords +
+	                             pos.x / 64];
+	uint64_t bit = uint64_t(1) << (pos.x % 64);
+	if (tile.drawnObjects[layer].empty())
+		word &= ~bit;
+	else
+		word |= bit;
+}
+
+int TileMap::nextOccupied(int layer, int y, int z, int x, int endX) const
+{
+	if (x >= endX)
+		return endX;
+	const uint64_t *row =
+	    &this->occupancy[((layer * size.z + z) * size.y + y) * occupancyRowWords];
+	int word = x / 64;
+	int lastWord = (endX - 1) / 64;
+	uint64_t bits = row[word] & (~uint64_t(0) << (x % 64));
+	// Skip empty stretches a whole word at a time
+	while (!bits)
+	{
+		if (++word > lastWord)
+			return endX;
+		bits = row[word];
+	}
+	int found = word * 64;
+	while (!(bits & 1))
+	{
+		bits >>= 1;
+		found++;
+	}
+	return std::min(found, endX);
+}
+
+std::map<UString, PoolStats> TileMap::getPoolStats() const
+{
+	return {{"TileObjectScenery", this->sceneryObjects.getStats()},
+	        {"TileObjectDoodad", this->doodadObjects.getStats()}};
+}
+
 }; // namespace OpenApoc
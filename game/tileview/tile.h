@@ -2,10 +2,12 @@
 #include "library/sp.h"
 
 #include "framework/includes.h"
+#include "library/objectpool.h"
 #include "game/tileview/tileobject.h"
 #include <set>
 #include <functional>
 #include <vector>
+#include <cstdint>
 
 // DANGER WILL ROBINSON - MADE UP VALUES AHEAD
 // I suspect quantities of distance/velocity are stored in units of {32,32,16} (same as the voxel
@@ -24,8 +26,6 @@ class Collision;
 class VoxelMap;
 class Renderer;
 class TileView;
-class Projectile;
-class TileObjectProjectile;
 class Vehicle;
 class TileObjectVehicle;
 class Scenery;
@@ -64,6 +64,16 @@ class TileMap
 	std::vector<Tile> tiles;
 	std::vector<std::set<TileObject::Type>> layerMap;
 
+	// One bit per tile for each layer, set if the tile has anything drawn in that layer. Every
+	// row of tiles starts a new word so rows can be scanned on their own.
+	std::vector<uint64_t> occupancy;
+	int occupancyRowWords;
+
+	// Scenery and doodad tile objects come and go constantly as things are destroyed, repaired
+	// and explode, so are pooled
+	ObjectPool<TileObjectScenery> sceneryObjects;
+	ObjectPool<TileObjectDoodad> doodadObjects;
+
   public:
 	Tile *getTile(int x, int y, int z);
 	Tile *getTile(Vec3<int> pos);
@@ -80,12 +90,20 @@ class TileMap
 
 	Collision findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegmentEnd);
 
-	void addObjectToMap(sp<Projectile>);
 	void addObjectToMap(sp<Vehicle>);
-	void addObjectToMap(sp<Scenery>);
-	void addObjectToMap(sp<Doodad>);
+	// Scenery and doodads are referred to by their tile objects through handles, so must be pooled
+	void addObjectToMap(PoolHandle<Scenery>);
+	void addObjectToMap(PoolHandle<Doodad>);
 
 	int getLayer(TileObject::Type type) const;
 	int getLayerCount() const;
+
+	// Must be called whenever the drawn objects in 'layer' of 'tile' change
+	void updateOccupancy(const Tile &tile, int layer);
+	// The first x in [x, endX) on row {y, z} with something drawn in 'layer', or endX if none
+	int nextOccupied(int layer, int y, int z, int x, int endX) const;
+
+	// Allocation counts for the pooled tile objects, by pool name
+	std::map<UString, PoolStats> getPoolStats() const;
 };
 }; // namespace OpenApoc
@@ -10,7 +10,8 @@ namespace OpenApoc
 {
 
 TileObject::TileObject(TileMap &map, Type type, Vec3<float> position, Vec3<float> bounds)
-    : map(map), type(type), owningTile(nullptr), position(position), bounds(bounds)
+    : map(map), type(type), owningTile(nullptr), intersectingMin(0, 0, 0),
+      intersectingMax(0, 0, 0), position(position), bounds(bounds)
 {
 }
 
@@ -32,6 +33,7 @@ void TileObject::removeFromMap()
 		    std::remove(this->owningTile->drawnObjects[layer].begin(),
 		                this->owningTile->drawnObjects[layer].end(), thisPtr),
 		    this->owningTile->drawnObjects[layer].end());
+		map.updateOccupancy(*this->owningTile, layer);
 		this->owningTile = nullptr;
 	}
 	for (auto *tile : this->intersectingTiles)
@@ -80,6 +82,24 @@ void TileObject::setPosition(Vec3<float> newPosition)
 		LogError("Trying to place object at {%f,%f,%f} in map of size {%d,%d,%d}", newPosition.x,
 		         newPosition.y, newPosition.z, map.size.x, map.size.y, map.size.z);
 	}
+
+	Vec3<int> minBounds = {floorf(newPosition.x - this->bounds.x / 2.0f),
+	                       floorf(newPosition.y - this->bounds.y / 2.0f),
+	                       floorf(newPosition.z - this->bounds.z / 2.0f)};
+	Vec3<int> maxBounds = {ceilf(newPosition.x + this->bounds.x / 2.0f),
+	                       ceilf(newPosition.y + this->bounds.y / 2.0f),
+	                       ceilf(newPosition.z + this->bounds.z / 2.0f)};
+
+	if (this->owningTile && this->owningTile == map.getTile(newPosition) &&
+	    minBounds == this->intersectingMin && maxBounds == this->intersectingMax)
+	{
+		// Still in the same tiles, so only the draw order within the owning tile can change
+		this->position = newPosition;
+		auto &drawnObjects = this->owningTile->drawnObjects[map.getLayer(this->type)];
+		std::sort(drawnObjects.begin(), drawnObjects.end(), TileObjectZComparer{});
+		return;
+	}
+
 	this->removeFromMap();
 
 	this->owningTile = map.getTile(newPosition);
@@ -100,14 +120,10 @@ void TileObject::setPosition(Vec3<float> newPosition)
 	this->owningTile->drawnObjects[layer].push_back(thisPtr);
 	std::sort(this->owningTile->drawnObjects[layer].begin(),
 	          this->owningTile->drawnObjects[layer].end(), TileObjectZComparer{});
+	map.updateOccupancy(*this->owningTile, layer);
 
-	Vec3<int> minBounds = {floorf(newPosition.x - this->bounds.x / 2.0f),
-	                       floorf(newPosition.y - this->bounds.y / 2.0f),
-	                       floorf(newPosition.z - this->bounds.z / 2.0f)};
-	Vec3<int> maxBounds = {ceilf(newPosition.x + this->bounds.x / 2.0f),
-	                       ceilf(newPosition.y + this->bounds.y / 2.0f),
-	                       ceilf(newPosition.z + this->bounds.z / 2.0f)};
-
+	this->intersectingMin = minBounds;
+	this->intersectingMax = maxBounds;
 	for (int x = minBounds.x; x < maxBounds.x; x++)
 	{
 		for (int y = minBounds.y; y < maxBounds.y; y++)
@@ -51,6 +51,10 @@ class TileObject : public std::enable_shared_from_this<TileObject>
 
 	Tile *owningTile;
 	std::vector<Tile *> intersectingTiles;
+	// The range of tiles last found in intersectingTiles, so moves that stay within the same
+	// tiles can skip re-inserting the object everywhere
+	Vec3<int> intersectingMin;
+	Vec3<int> intersectingMax;
 
 	TileObject(TileMap &map, Type type, Vec3<float> initialPosition, Vec3<float> bounds);
 
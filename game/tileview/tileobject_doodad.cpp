@@ -9,7 +9,7 @@ void TileObjectDoodad::draw(Renderer &r, TileView &view, Vec2<float> screenPosit
 {
 	std::ignore = view;
 	// Mode isn't used as TileView::tileToScreenCoords already transforms according to the mode
-	auto doodad = this->doodad.lock();
+	auto *doodad = this->doodad.get();
 	if (!doodad)
 	{
 		LogError("Called with no owning doodad object");
@@ -34,8 +34,9 @@ void TileObjectDoodad::draw(Renderer &r, TileView &view, Vec2<float> screenPosit
 
 TileObjectDoodad::~TileObjectDoodad() {}
 
-TileObjectDoodad::TileObjectDoodad(TileMap &map, sp<Doodad> doodad)
-    : TileObject(map, TileObject::Type::Doodad, doodad->getPosition(), Vec3<float>{0, 0, 0}),
+TileObjectDoodad::TileObjectDoodad(TileMap &map, PoolHandle<Doodad> doodad)
+    : TileObject(map, TileObject::Type::Doodad, doodad.get()->getPosition(),
+                 Vec3<float>{0, 0, 0}),
       doodad(doodad)
 {
 }
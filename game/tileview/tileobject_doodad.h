@@ -2,6 +2,7 @@
 
 #include "game/city/doodad.h"
 #include "game/tileview/tileobject.h"
+#include "library/objectpool.h"
 
 namespace OpenApoc
 {
@@ -12,13 +13,14 @@ class TileObjectDoodad : public TileObject
 	void draw(Renderer &r, TileView &view, Vec2<float> screenPosition, TileViewMode mode) override;
 	virtual ~TileObjectDoodad();
 
-	std::weak_ptr<Doodad> doodad;
+	PoolHandle<Doodad> doodad;
 
 	sp<VoxelMap> getVoxelMap() override { return nullptr; }
 
   private:
 	friend class TileMap;
-	TileObjectDoodad(TileMap &map, sp<Doodad> doodad);
+	friend class ObjectPool<TileObjectDoodad>;
+	TileObjectDoodad(TileMap &map, PoolHandle<Doodad> doodad);
 };
 
 } // namespace OpenApoc
@@ -9,24 +9,24 @@ void TileObjectProjectile::draw(Renderer &r, TileView &view, Vec2<float> screenP
 {
 	// Mode isn't used as TileView::tileToScreenCoords already transforms according to the mode
 	std::ignore = mode;
-	auto projectile = this->projectile.lock();
-	if (!projectile)
+	if (!this->manager.isLive(this->handle))
 	{
-		LogError("Called with no owning projectile object");
+		LogError("Called with no live projectile");
 		return;
 	}
-	switch (projectile->type)
+	auto index = this->manager.getIndex(this->handle);
+	switch (this->manager.getType(index))
 	{
-		case Projectile::Type::Beam:
+		case ProjectileManager::Type::Beam:
 		{
 			Vec2<float> headScreenCoords = screenPosition;
-			Vec3<float> tailPosition =
-			    (projectile->beamLength * (glm::normalize(projectile->velocity)));
+			Vec3<float> tailPosition = (this->manager.getBeamLength(index) *
+			                            (glm::normalize(this->manager.getVelocity(index))));
 			tailPosition /= VELOCITY_SCALE;
 			Vec2<float> tailScreenCoords = view.tileToScreenCoords(tailPosition);
 			tailScreenCoords += screenPosition;
-			r.drawLine(headScreenCoords, tailScreenCoords, projectile->colour,
-			           projectile->beamWidth);
+			r.drawLine(headScreenCoords, tailScreenCoords, this->manager.getColour(index),
+			           this->manager.getBeamWidth(index));
 			break;
 		}
 		default:
@@ -36,10 +36,10 @@ void TileObjectProjectile::draw(Renderer &r, TileView &view, Vec2<float> screenP
 
 TileObjectProjectile::~TileObjectProjectile() {}
 
-TileObjectProjectile::TileObjectProjectile(TileMap &map, sp<Projectile> projectile)
-    : TileObject(map, TileObject::Type::Projectile, projectile->getPosition(),
-                 Vec3<float>{0, 0, 0}),
-      projectile(projectile)
+TileObjectProjectile::TileObjectProjectile(TileMap &map, ProjectileManager &manager,
+                                           ProjectileHandle handle, Vec3<float> position)
+    : TileObject(map, TileObject::Type::Projectile, position, Vec3<float>{0, 0, 0}),
+      manager(manager), handle(handle)
 {
 }
 
@@ -13,9 +13,12 @@ class TileObjectProjectile : public TileObject
 	virtual ~TileObjectProjectile();
 
   private:
-	friend class TileMap;
-	std::weak_ptr<Projectile> projectile;
-	TileObjectProjectile(TileMap &map, sp<Projectile> projectile);
+	friend class ProjectileManager;
+	ProjectileManager &manager;
+	// Reassigned when the tile object is reused for a new projectile
+	ProjectileHandle handle;
+	TileObjectProjectile(TileMap &map, ProjectileManager &manager, ProjectileHandle handle,
+	                     Vec3<float> position);
 };
 
 } // namespace OpenApoc
@@ -9,7 +9,7 @@ void TileObjectScenery::draw(Renderer &r, TileView &view, Vec2<float> screenPosi
 {
 	std::ignore = view;
 	// Mode isn't used as TileView::tileToScreenCoords already transforms according to the mode
-	auto scenery = this->scenery.lock();
+	auto *scenery = this->scenery.get();
 	if (!scenery)
 	{
 		LogError("Called with no owning scenery object");
@@ -44,22 +44,34 @@ void TileObjectScenery::draw(Renderer &r, TileView &view, Vec2<float> screenPosi
 
 TileObjectScenery::~TileObjectScenery() {}
 
-TileObjectScenery::TileObjectScenery(TileMap &map, sp<Scenery> scenery)
-    : TileObject(map, TileObject::Type::Scenery, scenery->getPosition(), Vec3<float>{1, 1, 1}),
+TileObjectScenery::TileObjectScenery(TileMap &map, PoolHandle<Scenery> scenery)
+    : TileObject(map, TileObject::Type::Scenery, scenery.get()->getPosition(),
+                 Vec3<float>{1, 1, 1}),
       scenery(scenery)
 {
 }
 
 sp<Scenery> TileObjectScenery::getOwner()
 {
-	auto s = this->scenery.lock();
+	auto *s = this->scenery.get();
 	if (!s)
 	{
 		LogError("Owning scenery object disappeared");
+		return nullptr;
 	}
-	return s;
+	return s->shared_from_this();
 }
 
-sp<VoxelMap> TileObjectScenery::getVoxelMap() { return this->getOwner()->tileDef.getVoxelMap(); }
+sp<VoxelMap> TileObjectScenery::getVoxelMap()
+{
+	// Called for every collision check, so avoid taking a reference
+	auto *s = this->scenery.get();
+	if (!s)
+	{
+		LogError("Owning scenery object disappeared");
+		return nullptr;
+	}
+	return s->tileDef.getVoxelMap();
+}
 
 } // namespace OpenApoc
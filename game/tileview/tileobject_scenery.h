@@ -2,6 +2,7 @@
 
 #include "game/city/scenery.h"
 #include "game/tileview/tileobject.h"
+#include "library/objectpool.h"
 
 namespace OpenApoc
 {
@@ -12,7 +13,7 @@ class TileObjectScenery : public TileObject
 	void draw(Renderer &r, TileView &view, Vec2<float> screenPosition, TileViewMode mode) override;
 	virtual ~TileObjectScenery();
 
-	std::weak_ptr<Scenery> scenery;
+	PoolHandle<Scenery> scenery;
 
 	sp<Scenery> getOwner();
 
@@ -20,7 +21,8 @@ class TileObjectScenery : public TileObject
 
   private:
 	friend class TileMap;
-	TileObjectScenery(TileMap &map, sp<Scenery> scenery);
+	friend class ObjectPool<TileObjectScenery>;
+	TileObjectScenery(TileMap &map, PoolHandle<Scenery> scenery);
 };
 
 } // namespace OpenApoc
@@ -5,8 +5,13 @@
 
 #include "framework/includes.h"
 #include "framework/framework.h"
+#include "framework/deferredrenderer.h"
+#include "framework/metrics.h"
 #include "game/resources/gamecore.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace OpenApoc
 {
 
@@ -23,6 +28,8 @@ TileView::TileView(TileMap &map, Vec3<int> isoTileSize, Vec2<int> stratTileSize,
       pal(fw().data->load_palette("xcom3/ufodata/PAL_01.DAT"))
 {
 	LogWarning("dpySize: {%d,%d}", dpySize.x, dpySize.y);
+	if (fw().Settings->getBool("Visual.DeferredWorldRendering"))
+		this->deferredRenderer.reset(new DeferredRenderer(*fw().renderer));
 }
 
 TileView::~TileView() {}
@@ -161,6 +168,14 @@ void TileView::Render()
 	Renderer &r = *fw().renderer;
 	r.clear();
 	r.setPalette(this->pal);
+	// The world is drawn in strict painter's order, which the deferred renderer can regroup into
+	// far fewer batches
+	Renderer &worldRenderer = this->deferredRenderer ? *this->deferredRenderer : r;
+	worldRenderer.setPalette(this->pal);
+	// The batches the renderer really flushed for the world, to compare with and without deferring
+	static auto &flushes = Metrics::counter("Renderer.Flushes");
+	static auto &worldFlushes = Metrics::counter("TileView.WorldFlushes");
+	uint64_t flushesBefore = flushes.get();
 
 	Vec3<float> newPos = this->centerPos;
 	if (this->viewMode == TileViewMode::Isometric)
@@ -206,57 +221,68 @@ void TileView::Render()
 
 	auto screenOffset = this->getScreenOffset();
 
-	// screenOffset.x/screenOffset.y is the 'amount added to the tile coords' - so we want
-	// the inverse to tell which tiles are at the screen bounds
-	auto topLeft = screenToTileCoords(
-	    Vec2<int>{-screenOffset.x - isoTileSize.x, -screenOffset.y - isoTileSize.y}, 0);
-	auto topRight = screenToTileCoords(
-	    Vec2<int>{-screenOffset.x + dpySize.x, -screenOffset.y - isoTileSize.y}, 0);
-	auto bottomLeft = screenToTileCoords(
-	    Vec2<int>{-screenOffset.x - isoTileSize.x, -screenOffset.y + dpySize.y}, map.size.z);
-	auto bottomRight = screenToTileCoords(
-	    Vec2<int>{-screenOffset.x + dpySize.x, -screenOffset.y + dpySize.y}, map.size.z);
+	bool showSelected = fw().gamecore->DebugModeEnabled;
+	auto drawTile = [&](int x, int y, int z, int layer) {
+		bool selected = showSelected && z == selectedTilePosition.z &&
+		                y == selectedTilePosition.y && x == selectedTilePosition.x;
+		Vec2<float> screenPos;
+		if (selected)
+		{
+			screenPos = tileToScreenCoords(Vec3<float>{static_cast<float>(x),
+			                                           static_cast<float>(y),
+			                                           static_cast<float>(z)});
+			screenPos.x += screenOffset.x;
+			screenPos.y += screenOffset.y;
+			worldRenderer.draw(selectedTileImageBack, screenPos);
+		}
 
-	int minX = std::max(0, topLeft.x);
-	int maxX = std::min(map.size.x, bottomRight.x);
+		for (auto &obj : map.getTile(x, y, z)->drawnObjects[layer])
+		{
+			Vec2<float> pos = tileToScreenCoords(obj->getPosition());
+			pos.x += screenOffset.x;
+			pos.y += screenOffset.y;
+			obj->draw(worldRenderer, *this, pos, this->viewMode);
+		}
 
-	int minY = std::max(0, topRight.y);
-	int maxY = std::min(map.size.y, bottomLeft.y);
+		if (selected)
+			worldRenderer.draw(selectedTileImageFront, screenPos);
+	};
 
-	for (int z = 0; z < maxZDraw; z++)
+	// Only the visible part of each row is looked at, and within that only the tiles the map
+	// says have something in the layer, so the cost follows what's drawn rather than the area
+	int maxZ = std::min(maxZDraw, map.size.z);
+	for (int z = 0; z < maxZ; z++)
 	{
 		for (int layer = 0; layer < map.getLayerCount(); layer++)
 		{
-			for (int y = minY; y < maxY; y++)
+			for (int y = 0; y < map.size.y; y++)
 			{
-				for (int x = minX; x < maxX; x++)
+				int xBegin, xEnd;
+				this->getVisibleRowSpan(y, z, screenOffset, xBegin, xEnd);
+				// The selected tile is drawn even when empty
+				bool selectedRow = showSelected && z == selectedTilePosition.z &&
+				                   y == selectedTilePosition.y &&
+				                   selectedTilePosition.x >= xBegin &&
+				                   selectedTilePosition.x < xEnd;
+				for (int x = map.nextOccupied(layer, y, z, xBegin, xEnd); x < xEnd;
+				     x = map.nextOccupied(layer, y, z, x + 1, xEnd))
 				{
-					bool showSelected =
-					    (fw().gamecore->DebugModeEnabled && z == selectedTilePosition.z &&
-					     y == selectedTilePosition.y && x == selectedTilePosition.x);
-					auto tile = map.getTile(x, y, z);
-					auto screenPos = tileToScreenCoords(Vec3<float>{
-					    static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)});
-					screenPos.x += screenOffset.x;
-					screenPos.y += screenOffset.y;
-
-					if (showSelected)
-						r.draw(selectedTileImageBack, screenPos);
-
-					for (auto obj : tile->drawnObjects[layer])
+					if (selectedRow && selectedTilePosition.x <= x)
 					{
-						Vec2<float> pos = tileToScreenCoords(obj->getPosition());
-						pos.x += screenOffset.x;
-						pos.y += screenOffset.y;
-						obj->draw(r, *this, pos, this->viewMode);
+						if (selectedTilePosition.x < x)
+							drawTile(selectedTilePosition.x, y, z, layer);
+						selectedRow = false;
 					}
-
-					if (showSelected)
-						r.draw(selectedTileImageFront, screenPos);
+					drawTile(x, y, z, layer);
 				}
+				if (selectedRow)
+					drawTile(selectedTilePosition.x, y, z, layer);
 			}
 		}
 	}
+	if (this->deferredRenderer)
+		this->deferredRenderer->submit();
+	worldFlushes.add(flushes.get() - flushesBefore);
 
 	if (this->viewMode == TileViewMode::Strategy)
 	{
@@ -313,6 +339,55 @@ void TileView::Render()
 
 bool TileView::IsTransition() { return false; }
 
+void TileView::getVisibleRowSpan(int y, int z, Vec2<int> screenOffset, int &xBegin,
+                                 int &xEnd) const
+{
+	float begin, end;
+	switch (this->viewMode)
+	{
+		case TileViewMode::Isometric:
+		{
+			// Allow a tile's worth of overhang on every side for sprites drawn offset from
+			// their tile
+			float marginX = isoTileSize.x;
+			float marginY = isoTileSize.y + isoTileSize.z;
+			float halfWidth = isoTileSize.x / 2.0f;
+			float halfHeight = isoTileSize.y / 2.0f;
+			// A tile's screen x is (x - y) * halfWidth, so each row is visible over a fixed
+			// range of x - y...
+			float minScreenX = -screenOffset.x - marginX;
+			float maxScreenX = -screenOffset.x + dpySize.x + marginX;
+			begin = y + minScreenX / halfWidth;
+			end = y + maxScreenX / halfWidth;
+			// ...and its screen y is (x + y) * halfHeight - z * isoTileSize.z, limiting x + y
+			float minScreenY = -screenOffset.y - marginY + z * isoTileSize.z;
+			float maxScreenY = -screenOffset.y + dpySize.y + marginY + z * isoTileSize.z;
+			begin = std::max(begin, minScreenY / halfHeight - y);
+			end = std::min(end, maxScreenY / halfHeight - y);
+			break;
+		}
+		case TileViewMode::Strategy:
+		{
+			float rowScreenY = y * stratTileSize.y + screenOffset.y;
+			if (rowScreenY < -stratTileSize.y || rowScreenY >= dpySize.y + stratTileSize.y)
+			{
+				xBegin = xEnd = 0;
+				return;
+			}
+			begin = static_cast<float>(-screenOffset.x - stratTileSize.x) / stratTileSize.x;
+			end = static_cast<float>(-screenOffset.x + dpySize.x + stratTileSize.x) /
+			      stratTileSize.x;
+			break;
+		}
+		default:
+			LogError("Invalid view mode");
+			xBegin = xEnd = 0;
+			return;
+	}
+	xBegin = std::max(0, static_cast<int>(std::ceil(begin)));
+	xEnd = std::min(map.size.x, static_cast<int>(std::ceil(end)));
+}
+
 void TileView::setViewMode(TileViewMode newMode) { this->viewMode = newMode; }
 
 TileViewMode TileView::getViewMode() const { return this->viewMode; }
@@ -326,7 +401,6 @@ Vec2<int> TileView::getScreenOffset() const
 
 void TileView::setScreenCenterTile(Vec3<float> center)
 {
-	fw().soundBackend->setListenerPosition({center.x, center.y, map.size.z / 2});
 	Vec3<float> clampedCenter;
 	if (center.x < 0.0f)
 		clampedCenter.x = 0.0f;
@@ -348,6 +422,8 @@ void TileView::setScreenCenterTile(Vec3<float> center)
 		clampedCenter.z = center.z;
 
 	this->centerPos = clampedCenter;
+	fw().soundBackend->setListenerPosition(
+	    {clampedCenter.x, clampedCenter.y, static_cast<float>(map.size.z) / 2});
 }
 
 void TileView::setScreenCenterTile(Vec2<float> center)
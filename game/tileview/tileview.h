@@ -11,6 +11,7 @@ namespace OpenApoc
 
 class TileMap;
 class Image;
+class DeferredRenderer;
 
 enum class TileViewMode
 {
@@ -37,6 +38,13 @@ class TileView : public Stage
 	Colour strategyViewBoxColour;
 	float strategyViewBoxThickness;
 
+	// Null unless "Visual.DeferredWorldRendering" is set
+	up<DeferredRenderer> deferredRenderer;
+
+	// The tiles on row {y, z} that are on screen (or close enough that their sprites could be)
+	// are those with x in [xBegin, xEnd), which is empty if xEnd <= xBegin
+	void getVisibleRowSpan(int y, int z, Vec2<int> screenOffset, int &xBegin, int &xEnd) const;
+
   public:
 	int maxZDraw;
 	Vec3<float> centerPos;
@@ -3,6 +3,7 @@
 #include "game/tileview/tile.h"
 #include "game/tileview/tileobject.h"
 #include "framework/logger.h"
+#include "framework/metrics.h"
 
 #include <iterator>
 
@@ -252,6 +253,10 @@ Collision Tile::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegm
 
 Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineSegmentEnd)
 {
+	// Called from the collision worker threads, so count locally and only touch the shared
+	// counter once per line
+	static auto &tileTests = Metrics::counter("Collision.TileTests");
+	unsigned int tested = 0;
 	Collision c;
 	c.obj = nullptr;
 	// We can increment by '1f' and still get a point in every affected tile
@@ -261,14 +266,16 @@ Collision TileMap::findCollision(Vec3<float> lineSegmentStart, Vec3<float> lineS
 		if (point.x < 0 || point.x >= size.x || point.y < 0 || point.y >= size.y || point.z < 0 ||
 		    point.z >= size.z)
 		{
-			return c;
+			break;
 		}
 
 		Tile *t = this->getTile(point);
+		tested++;
 		c = t->findCollision(lineSegmentStart, lineSegmentEnd);
 		if (c)
-			return c;
+			break;
 	}
+	tileTests.add(tested);
 	return c;
 }
 
@@ -2,6 +2,7 @@
 #include "library/sp.h"
 
 #include "library/vec.h"
+#include "game/city/projectile.h"
 #include <vector>
 #include <memory>
 
@@ -9,13 +10,12 @@ namespace OpenApoc
 {
 
 class TileObject;
-class Projectile;
 
 class Collision
 {
   public:
 	sp<TileObject> obj;
-	sp<Projectile> projectile;
+	ProjectileHandle projectile;
 	Vec3<float> position;
 	explicit operator bool() const { return obj != nullptr; }
 };
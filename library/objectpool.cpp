@@ -0,0 +1,76 @@
+#include "library/objectpool.h"
+#include "framework/logger.h"
+
+namespace OpenApoc
+{
+
+BlockPool::BlockPool(size_t blocksPerChunk) : blockSize(0), blocksPerChunk(blocksPerChunk) {}
+
+BlockPool::BlockHeader *BlockPool::getHeader(size_t index) const
+{
+	auto *chunk = reinterpret_cast<char *>(this->chunks[index / this->blocksPerChunk].get());
+	return reinterpret_cast<BlockHeader *>(chunk + (index % this->blocksPerChunk) *
+	                                                   (HeaderSize + this->blockSize));
+}
+
+void *BlockPool::allocate(size_t size)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (this->blockSize == 0)
+	{
+		// Round up so every block stays aligned
+		const size_t align = alignof(std::max_align_t);
+		this->blockSize = (size + align - 1) / align * align;
+	}
+	this->stats.allocations++;
+	if (size > this->blockSize)
+	{
+		this->stats.heapAllocations++;
+		return ::operator new(size);
+	}
+	if (this->freeBlocks.empty())
+	{
+		this->stats.heapAllocations++;
+		size_t chunkElements =
+		    (HeaderSize + this->blockSize) * this->blocksPerChunk / sizeof(std::max_align_t);
+		this->chunks.emplace_back(new std::max_align_t[chunkElements]);
+		size_t first = (this->chunks.size() - 1) * this->blocksPerChunk;
+		for (size_t i = first; i < first + this->blocksPerChunk; i++)
+		{
+			auto *header = new (this->getHeader(i)) BlockHeader;
+			header->index = i;
+			header->generation.store(0, std::memory_order_relaxed);
+		}
+		// Push in reverse so blocks are handed out in address order
+		for (size_t i = first + this->blocksPerChunk; i > first; i--)
+			this->freeBlocks.push_back(i - 1);
+		this->stats.capacity += this->blocksPerChunk;
+	}
+	size_t index = this->freeBlocks.back();
+	this->freeBlocks.pop_back();
+	this->stats.live++;
+	return reinterpret_cast<char *>(this->getHeader(index)) + HeaderSize;
+}
+
+void BlockPool::deallocate(void *block, size_t size)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->stats.frees++;
+	if (size > this->blockSize)
+	{
+		::operator delete(block);
+		return;
+	}
+	auto *header = getHeader(static_cast<const void *>(block));
+	header->generation.fetch_add(1, std::memory_order_release);
+	this->freeBlocks.push_back(header->index);
+	this->stats.live--;
+}
+
+PoolStats BlockPool::getStats() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->stats;
+}
+
+} // namespace OpenApoc
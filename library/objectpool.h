@@ -0,0 +1,196 @@
+#pragma once
+
+#include "library/sp.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace OpenApoc
+{
+
+class PoolStats
+{
+  public:
+	uint64_t allocations = 0;
+	uint64_t frees = 0;
+	// Allocations that went to the system allocator, either a new chunk or something too big for
+	// the pool's blocks. This should stay flat once a game is running.
+	uint64_t heapAllocations = 0;
+	size_t live = 0;
+	size_t capacity = 0;
+
+	PoolStats &operator+=(const PoolStats &other)
+	{
+		allocations += other.allocations;
+		frees += other.frees;
+		heapAllocations += other.heapAllocations;
+		live += other.live;
+		capacity += other.capacity;
+		return *this;
+	}
+};
+
+// Hands out fixed-size blocks from chunks that are only released when the pool is, so block
+// addresses never change and allocating is just popping a free list. The block size is taken
+// from the first allocation. Each block has a generation that's bumped when it's freed, so a
+// (block, generation) pair identifies one allocation even after the block is reused.
+class BlockPool
+{
+  private:
+	// Sits in front of every block, so freeing a block doesn't have to search for it
+	class BlockHeader
+	{
+	  public:
+		size_t index;
+		std::atomic<uint32_t> generation;
+	};
+	// Rounded up so the blocks after the headers stay aligned
+	static const size_t HeaderSize = (sizeof(BlockHeader) + alignof(std::max_align_t) - 1) /
+	                                 alignof(std::max_align_t) * alignof(std::max_align_t);
+
+	mutable std::mutex mutex;
+	size_t blockSize;
+	size_t blocksPerChunk;
+	std::vector<up<std::max_align_t[]>> chunks;
+	std::vector<size_t> freeBlocks;
+	PoolStats stats;
+
+	BlockHeader *getHeader(size_t index) const;
+	static BlockHeader *getHeader(const void *block)
+	{
+		return reinterpret_cast<BlockHeader *>(
+		    static_cast<char *>(const_cast<void *>(block)) - HeaderSize);
+	}
+
+  public:
+	BlockPool(size_t blocksPerChunk);
+
+	void *allocate(size_t size);
+	void deallocate(void *block, size_t size);
+
+	// The current generation of 'block', which must be a live block from allocate()
+	static uint32_t getGeneration(const void *block)
+	{
+		return getHeader(block)->generation.load(std::memory_order_acquire);
+	}
+
+	PoolStats getStats() const;
+};
+
+// Refers to an object in an ObjectPool without keeping it alive, see ObjectPool::getHandle().
+// get() returns null once the object has been destroyed, even if its block has been reused. The
+// pool's memory has to still exist, so don't use handles after the ObjectPool and all of its
+// objects are gone.
+template <typename T> class PoolHandle
+{
+  private:
+	template <typename U> friend class PoolHandle;
+	template <typename U> friend class ObjectPool;
+	const void *block = nullptr;
+	T *object = nullptr;
+	uint32_t generation = 0;
+
+  public:
+	PoolHandle() = default;
+	// Like pointers, a handle converts to a handle to any base class
+	template <typename U,
+	          typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+	PoolHandle(const PoolHandle<U> &other)
+	    : block(other.block), object(other.object), generation(other.generation)
+	{
+	}
+
+	T *get() const
+	{
+		if (!block || BlockPool::getGeneration(block) != generation)
+			return nullptr;
+		return object;
+	}
+	explicit operator bool() const { return block != nullptr; }
+};
+
+// Allocates control blocks for shared pointers to pooled objects
+template <typename T> class PoolAllocator
+{
+  public:
+	using value_type = T;
+	sp<BlockPool> pool;
+
+	PoolAllocator(sp<BlockPool> pool) : pool(pool) {}
+	template <typename U> PoolAllocator(const PoolAllocator<U> &other) : pool(other.pool) {}
+
+	T *allocate(size_t n) { return static_cast<T *>(pool->allocate(n * sizeof(T))); }
+	void deallocate(T *p, size_t n) { pool->deallocate(p, n * sizeof(T)); }
+
+	template <typename U> bool operator==(const PoolAllocator<U> &other) const
+	{
+		return pool == other.pool;
+	}
+	template <typename U> bool operator!=(const PoolAllocator<U> &other) const
+	{
+		return pool != other.pool;
+	}
+};
+
+// Creates objects of type T (and their shared pointer control blocks) in BlockPools, for short
+// lived objects that would otherwise churn the system allocator. The pools are kept alive by the
+// objects themselves, so these can outlive the ObjectPool that created them. Classes with private
+// constructors need to be friends of their ObjectPool.
+template <typename T> class ObjectPool
+{
+  private:
+	sp<BlockPool> objects;
+	sp<BlockPool> controlBlocks;
+
+	class Deleter
+	{
+	  public:
+		sp<BlockPool> objects;
+		void operator()(T *obj) const
+		{
+			obj->~T();
+			objects->deallocate(obj, sizeof(T));
+		}
+	};
+
+  public:
+	ObjectPool(size_t blocksPerChunk = 64)
+	    : objects(mksp<BlockPool>(blocksPerChunk)), controlBlocks(mksp<BlockPool>(blocksPerChunk))
+	{
+	}
+
+	template <typename... Args> sp<T> create(Args &&... args)
+	{
+		static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned pooled type");
+		void *block = objects->allocate(sizeof(T));
+		T *obj = new (block) T(std::forward<Args>(args)...);
+		return sp<T>(obj, Deleter{objects}, PoolAllocator<T>(controlBlocks));
+	}
+
+	// 'obj' must have been created by this pool
+	PoolHandle<T> getHandle(T *obj) const
+	{
+		PoolHandle<T> handle;
+		handle.block = obj;
+		handle.object = obj;
+		handle.generation = BlockPool::getGeneration(obj);
+		return handle;
+	}
+
+	PoolStats getStats() const
+	{
+		PoolStats stats = objects->getStats();
+		auto controlStats = controlBlocks->getStats();
+		stats.heapAllocations += controlStats.heapAllocations;
+		return stats;
+	}
+};
+
+} // namespace OpenApoc
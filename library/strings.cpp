@@ -1,7 +1,10 @@
 #include "library/strings.h"
 #include "framework/logger.h"
 
+#include <algorithm>
 #include <boost/locale.hpp>
+#include <mutex>
+#include <unordered_map>
 
 #ifdef DUMP_TRANSLATION_STRINGS
 #include <map>
@@ -41,6 +44,11 @@ void dumpStrings()
 
 #endif
 
+// Translations only change with the locale, and UI code asks for the same few strings every frame
+// so it's much cheaper to remember them than to go through boost::locale each time
+static std::mutex translationCacheMutex;
+static std::unordered_map<std::string, UString> translationCache;
+
 UString tr(const UString &str, const UString domain)
 {
 #ifdef DUMP_TRANSLATION_STRINGS
@@ -49,16 +57,36 @@ UString tr(const UString &str, const UString domain)
 		trStrings[domain].insert(str);
 	}
 #endif
-	return UString(boost::locale::translate(str.str()).str(domain.str()));
+	std::string key;
+	key.reserve(domain.str().length() + 1 + str.str().length());
+	key += domain.str();
+	key += '\0';
+	key += str.str();
+
+	std::lock_guard<std::mutex> lock(translationCacheMutex);
+	auto it = translationCache.find(key);
+	if (it != translationCache.end())
+	{
+		return it->second;
+	}
+	UString translated(boost::locale::translate(str.str()).str(domain.str()));
+	translationCache.emplace(std::move(key), translated);
+	return translated;
+}
+
+void clearTranslationCache()
+{
+	std::lock_guard<std::mutex> lock(translationCacheMutex);
+	translationCache.clear();
 }
 
 UString::~UString() {}
 
-UString::UString() : u8Str() {}
+UString::UString() : u8Str(), codePoints(0), ascii(true) {}
 
-UString::UString(std::string str) : u8Str(str) {}
+UString::UString(std::string str) : u8Str(str) { updateCachedInfo(); }
 
-UString::UString(char c) : u8Str(1, c) {}
+UString::UString(char c) : u8Str(1, c) { updateCachedInfo(); }
 
 UString::UString(const char *cstr)
 {
@@ -67,15 +95,65 @@ UString::UString(const char *cstr)
 	{
 		this->u8Str = cstr;
 	}
+	updateCachedInfo();
 }
 
-UString::UString(const UString &other) : u8Str(other.u8Str) {}
+UString::UString(const UString &other)
+    : u8Str(other.u8Str), codePoints(other.codePoints), ascii(other.ascii)
+{
+}
 
-UString::UString(UString &&other) { this->u8Str = std::move(other.u8Str); }
+UString::UString(UString &&other)
+    : u8Str(std::move(other.u8Str)), codePoints(other.codePoints), ascii(other.ascii)
+{
+	other.u8Str.clear();
+	other.codePoints = 0;
+	other.ascii = true;
+}
 
 UString::UString(UniChar uc) : u8Str()
 {
 	u8Str = boost::locale::conv::utf_to_utf<char>(&uc, &uc + 1);
+	updateCachedInfo();
+}
+
+static bool isContinuationByte(char c) { return (static_cast<unsigned char>(c) & 0xC0) == 0x80; }
+
+void UString::updateCachedInfo()
+{
+	codePoints = 0;
+	ascii = true;
+	for (char c : u8Str)
+	{
+		if (static_cast<unsigned char>(c) >= 0x80)
+		{
+			ascii = false;
+		}
+		if (!isContinuationByte(c))
+		{
+			codePoints++;
+		}
+	}
+}
+
+size_t UString::byteOffset(size_t offset) const
+{
+	if (ascii)
+	{
+		return std::min(offset, u8Str.length());
+	}
+	for (size_t pos = 0; pos < u8Str.length(); pos++)
+	{
+		if (!isContinuationByte(u8Str[pos]))
+		{
+			if (offset == 0)
+			{
+				return pos;
+			}
+			offset--;
+		}
+	}
+	return u8Str.length();
 }
 
 std::string UString::str() const { return this->u8Str; };
@@ -88,38 +166,87 @@ bool UString::operator==(const UString &other) const { return (this->u8Str) == (
 
 UString UString::substr(size_t offset, size_t length) const
 {
-	return this->u8Str.substr(offset, length);
+	size_t start = byteOffset(offset);
+	if (length == npos || length >= codePoints)
+	{
+		return this->u8Str.substr(start);
+	}
+	return this->u8Str.substr(start, byteOffset(offset + length) - start);
 }
 
-UString UString::toUpper() const { return boost::locale::to_upper(this->u8Str); }
+// Most strings case-converted are resource paths used as cache keys, which are always ASCII and
+// don't need the locale
+UString UString::toUpper() const
+{
+	if (!ascii)
+	{
+		return boost::locale::to_upper(this->u8Str);
+	}
+	UString upper(*this);
+	for (auto &c : upper.u8Str)
+	{
+		if (c >= 'a' && c <= 'z')
+		{
+			c = c - 'a' + 'A';
+		}
+	}
+	return upper;
+}
 
-UString UString::toLower() const { return boost::locale::to_lower(this->u8Str); }
+UString UString::toLower() const
+{
+	if (!ascii)
+	{
+		return boost::locale::to_lower(this->u8Str);
+	}
+	UString lower(*this);
+	for (auto &c : lower.u8Str)
+	{
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = c - 'A' + 'a';
+		}
+	}
+	return lower;
+}
 
 UString &UString::operator=(const UString &other)
 {
 	this->u8Str = other.u8Str;
+	this->codePoints = other.codePoints;
+	this->ascii = other.ascii;
 	return *this;
 }
 
 UString &UString::operator+=(const UString &other)
 {
 	this->u8Str += other.u8Str;
+	this->codePoints += other.codePoints;
+	this->ascii = this->ascii && other.ascii;
 	return *this;
 }
 
-size_t UString::length() const
+void UString::insert(size_t offset, const UString &other)
 {
-	auto pointString = boost::locale::conv::utf_to_utf<UniChar>(this->u8Str);
-	return pointString.length();
+	this->u8Str.insert(byteOffset(offset), other.u8Str);
+	this->codePoints += other.codePoints;
+	this->ascii = this->ascii && other.ascii;
 }
 
-void UString::insert(size_t offset, const UString &other)
+void UString::remove(size_t offset, size_t count)
 {
-	this->u8Str.insert(offset, other.u8Str);
+	size_t start = byteOffset(offset);
+	if (count >= codePoints)
+	{
+		this->u8Str.erase(start);
+	}
+	else
+	{
+		this->u8Str.erase(start, byteOffset(offset + count) - start);
+	}
+	updateCachedInfo();
 }
 
-void UString::remove(size_t offset, size_t count) { this->u8Str.erase(offset, count); }
-
 bool UString::operator!=(const UString &other) const { return this->u8Str != other.u8Str; }
 
 UString operator+(const UString &lhs, const UString &rhs)
@@ -156,28 +283,89 @@ UniChar UString::u8Char(char c)
 
 int UString::compare(const UString &other) const { return this->u8Str.compare(other.u8Str); }
 
-UString::const_iterator UString::begin() const { return UString::const_iterator(*this, 0); }
+UString::const_iterator UString::begin() const
+{
+	// Stray continuation bytes at the start aren't counted as a code point by length() either
+	size_t offset = 0;
+	while (offset < u8Str.length() && isContinuationByte(u8Str[offset]))
+	{
+		offset++;
+	}
+	return UString::const_iterator(*this, offset);
+}
 
 UString::const_iterator UString::end() const
 {
-	return UString::const_iterator(*this, this->length());
+	return UString::const_iterator(*this, this->u8Str.length());
 }
 
-UString::const_iterator UString::const_iterator::operator++()
+UString::const_iterator &UString::const_iterator::operator++()
 {
-	this->offset++;
+	auto &str = this->s->u8Str;
+	do
+	{
+		this->offset++;
+	} while (this->offset < str.length() && isContinuationByte(str[this->offset]));
 	return *this;
 }
 
+UString::const_iterator UString::const_iterator::operator++(int)
+{
+	auto previous = *this;
+	++(*this);
+	return previous;
+}
+
+bool UString::const_iterator::operator==(const UString::const_iterator &other) const
+{
+	return this->offset == other.offset && this->s == other.s;
+}
+
 bool UString::const_iterator::operator!=(const UString::const_iterator &other) const
 {
-	return (this->offset != other.offset || this->s != other.s);
+	return !(*this == other);
 }
 
 UniChar UString::const_iterator::operator*() const
 {
-	auto pointString = boost::locale::conv::utf_to_utf<int>(this->s.str());
-	return pointString[this->offset];
+	auto &str = this->s->u8Str;
+	auto lead = static_cast<unsigned char>(str[this->offset]);
+	if (lead < 0x80)
+	{
+		return lead;
+	}
+	int extraBytes;
+	UniChar c;
+	if ((lead & 0xE0) == 0xC0)
+	{
+		extraBytes = 1;
+		c = lead & 0x1F;
+	}
+	else if ((lead & 0xF0) == 0xE0)
+	{
+		extraBytes = 2;
+		c = lead & 0x0F;
+	}
+	else if ((lead & 0xF8) == 0xF0)
+	{
+		extraBytes = 3;
+		c = lead & 0x07;
+	}
+	else
+	{
+		return 0xFFFD;
+	}
+	for (int i = 1; i <= extraBytes; i++)
+	{
+		size_t pos = this->offset + i;
+		if (pos >= str.length() || !isContinuationByte(str[pos]))
+		{
+			// Truncated sequence, show the replacement character rather than guessing
+			return 0xFFFD;
+		}
+		c = (c << 6) | (static_cast<unsigned char>(str[pos]) & 0x3F);
+	}
+	return c;
 }
 
 int Strings::ToInteger(const UString &s)
@@ -210,7 +398,30 @@ bool Strings::IsFloat(const UString &s)
 	return (endpos != u8str.c_str());
 }
 
-UString Strings::FromInteger(int i) { return UString::format("%d", i); }
+UString Strings::FromInteger(int i, unsigned int minDigits)
+{
+	// Enough for any 64 bit value and its sign, short results then fit in the string's own buffer
+	// without touching the heap
+	char buffer[24];
+	char *end = buffer + sizeof(buffer);
+	char *pos = end;
+	// Work on the unsigned value so INT_MIN doesn't overflow
+	unsigned int value = i < 0 ? 0u - static_cast<unsigned int>(i) : static_cast<unsigned int>(i);
+	do
+	{
+		*--pos = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value);
+	while (static_cast<unsigned int>(end - pos) < minDigits && pos > buffer + 1)
+	{
+		*--pos = '0';
+	}
+	if (i < 0)
+	{
+		*--pos = '-';
+	}
+	return UString(std::string(pos, end));
+}
 
 UString Strings::FromFloat(float f) { return UString::format("%f", f); }
 
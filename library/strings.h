@@ -17,6 +17,14 @@ class UString
 {
   private:
 	std::string u8Str;
+	// Kept up to date by everything that changes u8Str, so length() and offsets into ASCII-only
+	// strings (which is nearly all of them) don't have to decode anything
+	size_t codePoints;
+	bool ascii;
+
+	void updateCachedInfo();
+	// The byte offset of the code point 'offset', or u8Str.length() if it's past the end
+	size_t byteOffset(size_t offset) const;
 
 	static boost::format &_format(boost::format &f) { return f; }
 
@@ -61,7 +69,8 @@ class UString
 	UString toLower() const;
 	std::vector<UString> split(const UString &delims) const;
 
-	size_t length() const;
+	size_t length() const { return codePoints; }
+	bool isASCII() const { return ascii; }
 	UString substr(size_t offset, size_t length = npos) const;
 
 	static const size_t npos = static_cast<size_t>(-1);
@@ -84,18 +93,21 @@ class UString
 	bool operator!=(const UString &other) const;
 	bool operator<(const UString &other) const;
 
+	// Decodes code points straight out of the UTF-8 string as it goes, so iterating never allocates
 	class const_iterator : public std::iterator<std::forward_iterator_tag, UniChar>
 	{
 	  private:
-		const UString &s;
+		const UString *s;
+		// In bytes
 		size_t offset;
 		friend class UString;
-		const_iterator(const UString &s, size_t initial_offset) : s(s), offset(initial_offset) {}
+		const_iterator(const UString &s, size_t initial_offset) : s(&s), offset(initial_offset) {}
 
 	  public:
-		// Just enough to struggle through a range-based for
+		bool operator==(const const_iterator &other) const;
 		bool operator!=(const const_iterator &other) const;
-		const_iterator operator++();
+		const_iterator &operator++();
+		const_iterator operator++(int);
 		UniChar operator*() const;
 	};
 	const_iterator begin() const;
@@ -124,23 +136,26 @@ class Strings
 	static int ToInteger(const UString &s);
 	static uint8_t ToU8(const UString &s);
 	static float ToFloat(const UString &s);
-	static UString FromInteger(int i);
+	// Like "%d", zero padded to at least 'minDigits' digits
+	static UString FromInteger(int i, unsigned int minDigits = 1);
 	static UString FromFloat(float f);
 	static bool IsWhiteSpace(UniChar c);
 };
 
 UString tr(const UString &str, const UString domain = "ufo_string");
+// Forget all cached translations, must be called whenever the global locale changes
+void clearTranslationCache();
 
 template <typename... Args> static UString tr(const UString &fmt, Args &&... args)
 {
-	boost::locale::format f(boost::locale::translate(fmt.str()).str("ufo_string"));
+	boost::locale::format f(tr(fmt).str());
 	return UString::_lformat(f, std::forward<Args>(args)...).str();
 }
 
 template <typename... Args>
 static UString tr(const UString &fmt, const UString domain, Args &&... args)
 {
-	boost::locale::format f(boost::locale::translate(fmt.str()).str(domain.str()));
+	boost::locale::format f(tr(fmt, domain).str());
 	return UString::_lformat(f, std::forward<Args>(args)...).str();
 }
 
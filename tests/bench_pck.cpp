@@ -0,0 +1,166 @@
+#include "framework/fs.h"
+#include "framework/image.h"
+#include "framework/logger.h"
+#include "game/apocresources/pck.h"
+
+#include <physfs.h>
+
+#include <chrono>
+#include <cstdio>
+
+using namespace OpenApoc;
+
+// Benchmark the PCK decoder over the city sprite sets. This needs the game data, so it isn't run as
+// part of the test suite:
+//   bench_pck path/to/cd.iso [iterations]
+//
+// Each set is also decoded with a reference decoder that works like the original stream-based
+// loader (reading the TAB 4 bytes at a time and writing each pixel through a PaletteImageLock), so
+// the output can be checked for equality and the speedup reported.
+
+static const std::vector<std::pair<UString, UString>> cityPCKs = {
+    {"xcom3/ufodata/city.pck", "xcom3/ufodata/city.tab"},
+    {"xcom3/ufodata/cityovr.pck", "xcom3/ufodata/cityovr.tab"},
+    {"xcom3/ufodata/saucer.pck", "xcom3/ufodata/saucer.tab"},
+    {"xcom3/ufodata/vehicle.pck", "xcom3/ufodata/vehicle.tab"},
+    {"xcom3/ufodata/ptang.pck", "xcom3/ufodata/ptang.tab"},
+};
+
+// Only handles the RLE (version 2, compression 1) format used by all the city PCKs
+static std::vector<sp<PaletteImage>> referenceDecode(IFile &pck, IFile &tab)
+{
+	std::vector<sp<PaletteImage>> images;
+	for (unsigned int i = 0; i < tab.size() / 4; i++)
+	{
+		uint32_t offset;
+		tab.seekg(i * 4, std::ios::beg);
+		if (!tab.readule32(offset))
+			break;
+		pck.seekg(offset * 4, std::ios::beg);
+		uint16_t compression;
+		if (!pck.readule16(compression))
+			break;
+		if (compression != 1)
+			continue;
+		uint16_t header[5];
+		for (auto &h : header)
+			pck.readule16(h);
+		// header[0] is reserved, then left, right, top, bottom
+		auto img = mksp<PaletteImage>(Vec2<unsigned int>{header[2], header[4]});
+		PaletteImageLock lock(img);
+		uint32_t skip;
+		pck.readule32(skip);
+		while (pck && skip != 0xFFFFFFFF)
+		{
+			uint8_t row[4];
+			pck.read(reinterpret_cast<char *>(row), 4);
+			unsigned int y = skip / 640;
+			if (y < header[4])
+			{
+				unsigned int start = row[0], count = row[1];
+				if (row[2] != 0)
+				{
+					uint32_t chunk;
+					pck.readule32(chunk);
+					start = header[1];
+					count = row[2] > header[1] ? row[2] - header[1] : 0;
+				}
+				for (unsigned int x = start; x < start + count; x++)
+				{
+					char idx;
+					pck.read(&idx, 1);
+					if (x < header[2])
+						lock.set(Vec2<unsigned int>{x, y}, idx);
+				}
+			}
+			pck.readule32(skip);
+		}
+		img->CalculateBounds();
+		images.push_back(img);
+	}
+	return images;
+}
+
+static bool imagesEqual(sp<PaletteImage> a, sp<PaletteImage> b)
+{
+	if (a->size != b->size || !(a->bounds == b->bounds))
+		return false;
+	PaletteImageLock la(a, ImageLockUse::Read);
+	PaletteImageLock lb(b, ImageLockUse::Read);
+	return memcmp(la.getData(), lb.getData(), a->size.x * a->size.y) == 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s path/to/cd.iso [iterations]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	int iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+	PHYSFS_init(argv[0]);
+	FileSystem fs({UString(argv[1])});
+
+	using clock = std::chrono::high_resolution_clock;
+	bool failed = false;
+
+	for (auto &files : cityPCKs)
+	{
+		double newTime = 0, refTime = 0;
+		size_t imageCount = 0;
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = clock::now();
+			auto pck = fs.open(files.first);
+			auto tab = fs.open(files.second);
+			if (!pck || !tab)
+			{
+				LogError("Failed to open \"%s\"", files.first.c_str());
+				return EXIT_FAILURE;
+			}
+			auto pckView = pck.map();
+			auto tabView = tab.map();
+			auto imageSet = PCKLoader::decode(pckView.data(), pckView.size(), tabView.data(),
+			                                  tabView.size(), files.first);
+			auto mid = clock::now();
+
+			auto refPck = fs.open(files.first);
+			auto refTab = fs.open(files.second);
+			auto refImages = referenceDecode(refPck, refTab);
+			auto end = clock::now();
+
+			newTime += std::chrono::duration<double, std::milli>(mid - start).count();
+			refTime += std::chrono::duration<double, std::milli>(end - mid).count();
+			imageCount = imageSet->images.size();
+
+			if (i == 0)
+			{
+				if (refImages.size() != imageSet->images.size())
+				{
+					LogError("\"%s\" decoded %u images, reference %u", files.first.c_str(),
+					         static_cast<unsigned>(imageSet->images.size()),
+					         static_cast<unsigned>(refImages.size()));
+					failed = true;
+					continue;
+				}
+				for (unsigned int idx = 0; idx < refImages.size(); idx++)
+				{
+					auto img = std::dynamic_pointer_cast<PaletteImage>(imageSet->images[idx]);
+					if (!imagesEqual(img, refImages[idx]))
+					{
+						LogError("\"%s\" image %u differs from reference", files.first.c_str(),
+						         idx);
+						failed = true;
+					}
+				}
+			}
+		}
+		printf("%-28s %5u images: %8.2fms reference %8.2fms (%.1fx)\n", files.first.c_str(),
+		       static_cast<unsigned>(imageCount), newTime / iterations, refTime / iterations,
+		       newTime > 0 ? refTime / newTime : 0.0);
+	}
+
+	PHYSFS_deinit();
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
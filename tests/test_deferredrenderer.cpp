@@ -0,0 +1,130 @@
+#include "framework/deferredrenderer.h"
+#include "framework/logger.h"
+
+#include <vector>
+
+using namespace OpenApoc;
+
+// Records what it's asked to draw, the red channel of the colour telling the calls apart
+class StubRenderer : public Renderer
+{
+  private:
+	void setSurface(sp<Surface>) override {}
+	sp<Surface> getSurface() override { return nullptr; }
+
+  public:
+	// 'F' for a filled rect, 'R' for a rect and 'L' for a line, followed by the call's id
+	std::vector<std::pair<char, int>> calls;
+
+	void clear(Colour) override { calls.clear(); }
+	void setPalette(sp<Palette>) override {}
+	sp<Palette> getPalette() override { return nullptr; }
+	void draw(sp<Image>, Vec2<float>) override {}
+	void drawRotated(sp<Image>, Vec2<float>, Vec2<float>, float) override {}
+	void drawScaled(sp<Image>, Vec2<float>, Vec2<float>, Scaler) override {}
+	void drawTinted(sp<Image>, Vec2<float>, Colour) override {}
+	void drawFilledRect(Vec2<float>, Vec2<float>, Colour c) override
+	{
+		calls.emplace_back('F', c.r);
+	}
+	void drawRect(Vec2<float>, Vec2<float>, Colour c, float) override
+	{
+		calls.emplace_back('R', c.r);
+	}
+	void drawLine(Vec2<float>, Vec2<float>, Colour c, float) override
+	{
+		calls.emplace_back('L', c.r);
+	}
+	void flush() override {}
+	UString getName() override { return "Stub"; }
+	sp<Surface> getDefaultSurface() override { return nullptr; }
+};
+
+static Colour id(int n) { return Colour{static_cast<uint8_t>(n), 0, 0, 255}; }
+
+static void check_calls(const char *name, const StubRenderer &stub,
+                        const std::vector<std::pair<char, int>> &expected)
+{
+	bool match = stub.calls == expected;
+	if (!match)
+	{
+		LogError("%s: expected %u calls, got %u", name, (unsigned)expected.size(),
+		         (unsigned)stub.calls.size());
+		for (unsigned i = 0; i < expected.size() || i < stub.calls.size(); i++)
+		{
+			LogError("%s: call %u expected %c%d got %c%d", name, i,
+			         i < expected.size() ? expected[i].first : '-',
+			         i < expected.size() ? expected[i].second : -1,
+			         i < stub.calls.size() ? stub.calls[i].first : '-',
+			         i < stub.calls.size() ? stub.calls[i].second : -1);
+		}
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::ignore = argc;
+	std::ignore = argv;
+
+	StubRenderer stub;
+	{
+		// Nothing reaches the target until submitted
+		DeferredRenderer deferred(stub);
+		deferred.drawFilledRect({0, 0}, {10, 10}, id(1));
+		check_calls("unsubmitted", stub, {});
+
+		// A call clear of the ones before it joins the earlier batch with the same state
+		deferred.drawRect({20, 0}, {10, 10}, id(2));
+		deferred.drawFilledRect({40, 0}, {10, 10}, id(3));
+		deferred.drawLine({60, 0}, {70, 10}, id(4));
+		deferred.drawRect({80, 0}, {10, 10}, id(5));
+		deferred.submit();
+		check_calls("non-overlapping", stub, {{'F', 1}, {'F', 3}, {'R', 2}, {'R', 5}, {'L', 4}});
+	}
+
+	stub.calls.clear();
+	{
+		// A call that overlaps something drawn in between must stay on top of it
+		DeferredRenderer deferred(stub);
+		deferred.drawFilledRect({0, 0}, {10, 10}, id(1));
+		deferred.drawRect({5, 5}, {10, 10}, id(2));
+		deferred.drawFilledRect({12, 12}, {5, 5}, id(3));
+		deferred.submit();
+		check_calls("overlapping", stub, {{'F', 1}, {'R', 2}, {'F', 3}});
+	}
+
+	stub.calls.clear();
+	{
+		// Only the overlapping call is kept behind, later ones clear of everything still merge
+		DeferredRenderer deferred(stub);
+		deferred.drawFilledRect({0, 0}, {10, 10}, id(1));
+		deferred.drawRect({100, 0}, {10, 10}, id(2));
+		deferred.drawRect({0, 0}, {10, 10}, id(3));
+		deferred.drawRect({200, 0}, {10, 10}, id(4));
+		deferred.drawLine({0, 50}, {10, 50}, id(5));
+		deferred.drawFilledRect({2, 2}, {4, 4}, id(6));
+		deferred.drawFilledRect({300, 0}, {10, 10}, id(7));
+		deferred.drawRect({0, 60}, {10, 10}, id(8));
+		deferred.submit();
+		check_calls("mixed", stub, {{'F', 1},
+		                            {'R', 2},
+		                            {'R', 3},
+		                            {'R', 4},
+		                            {'R', 8},
+		                            {'L', 5},
+		                            {'F', 6},
+		                            {'F', 7}});
+	}
+
+	stub.calls.clear();
+	{
+		// Submitting happens when the deferred renderer goes away too
+		DeferredRenderer deferred(stub);
+		deferred.drawLine({0, 0}, {10, 10}, id(1));
+		deferred.drawLine({0, 0}, {10, 10}, id(2));
+	}
+	check_calls("destroyed", stub, {{'L', 1}, {'L', 2}});
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+#include "framework/inputrecording.h"
+#include "framework/event.h"
+#include "framework/logger.h"
+#include "library/configfile.h"
+
+#include <physfs.h>
+
+#include <cstdio>
+#include <list>
+
+using namespace OpenApoc;
+
+static const char *recordingPath = "test_inputrecording.txt";
+
+void check(bool condition, const char *what)
+{
+	if (!condition)
+	{
+		LogError("Check failed: %s", what);
+		remove(recordingPath);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::ignore = argc;
+	PHYSFS_init(argv[0]);
+	// Recordings are written to the write directory
+	PHYSFS_setWriteDir(".");
+
+	ConfigFile settings("test_inputrecording_missing.cfg", {{"Visual.ScreenWidth", "640"},
+	                                                        {"Visual.ScreenHeight", "480"},
+	                                                        {"Visual.ScaleX", "100"},
+	                                                        {"Visual.ScaleY", "150"},
+	                                                        {"GameRules", "XCOMAPOC.XML"},
+	                                                        {"Language", ""}});
+
+	{
+		InputRecorder recorder(recordingPath, 1234567u, settings);
+		check(recorder.isOpen(), "recording opened");
+
+		std::list<Event *> frame1;
+		auto *key = new KeyboardEvent(EVENT_KEY_DOWN);
+		key->Keyboard().KeyCode = 97;
+		key->Keyboard().UniChar = 65;
+		key->Keyboard().Modifiers = 3;
+		frame1.push_back(key);
+		auto *mouse = new MouseEvent(EVENT_MOUSE_MOVE);
+		mouse->Mouse().X = 10;
+		mouse->Mouse().Y = 20;
+		mouse->Mouse().DeltaX = -1;
+		mouse->Mouse().DeltaY = 2;
+		mouse->Mouse().WheelVertical = -3;
+		mouse->Mouse().WheelHorizontal = 4;
+		mouse->Mouse().Button = 5;
+		frame1.push_back(mouse);
+		// Raised by the game, so shouldn't be recorded
+		frame1.push_back(new FormsEvent());
+		recorder.record(1, frame1);
+
+		recorder.record(2, {});
+
+		std::list<Event *> frame3;
+		auto *finger = new FingerEvent(EVENT_FINGER_UP);
+		finger->Finger().X = 30;
+		finger->Finger().Y = 40;
+		finger->Finger().DeltaX = 5;
+		finger->Finger().DeltaY = -6;
+		finger->Finger().Id = 7;
+		finger->Finger().IsPrimary = true;
+		frame3.push_back(finger);
+		auto *display = new DisplayEvent(EVENT_WINDOW_RESIZE);
+		display->Display().Active = true;
+		display->Display().X = 1;
+		display->Display().Y = 2;
+		display->Display().Width = 800;
+		display->Display().Height = 600;
+		frame3.push_back(display);
+		recorder.record(3, frame3);
+
+		for (auto *e : frame1)
+			delete e;
+		for (auto *e : frame3)
+			delete e;
+	}
+
+	InputReplay replay(recordingPath);
+	check(replay.isLoaded(), "recording loaded");
+	check(replay.getSeed() == 1234567u, "seed");
+	bool foundScale = false;
+	for (auto &setting : replay.getSettings())
+	{
+		if (setting.first == "Visual.ScaleY")
+			foundScale = setting.second == "150";
+	}
+	check(replay.getSettings().size() == 6, "setting count");
+	check(foundScale, "setting value");
+
+	// Live input is replaced by the recording, anything else is left alone
+	std::list<Event *> queue;
+	queue.push_back(new MouseEvent(EVENT_MOUSE_DOWN));
+	queue.push_back(new FormsEvent());
+	replay.replay(1, queue);
+	check(queue.size() == 3, "frame 1 event count");
+	auto it = queue.begin();
+	check((*it)->Type() == EVENT_FORM_INTERACTION, "non-input event kept");
+	it++;
+	check((*it)->Type() == EVENT_KEY_DOWN, "key type");
+	check((*it)->Keyboard().KeyCode == 97 && (*it)->Keyboard().UniChar == 65 &&
+	          (*it)->Keyboard().Modifiers == 3,
+	      "key fields");
+	it++;
+	auto &m = (*it)->Mouse();
+	check((*it)->Type() == EVENT_MOUSE_MOVE, "mouse type");
+	check(m.X == 10 && m.Y == 20 && m.DeltaX == -1 && m.DeltaY == 2 && m.WheelVertical == -3 &&
+	          m.WheelHorizontal == 4 && m.Button == 5,
+	      "mouse fields");
+	for (auto *e : queue)
+		delete e;
+	queue.clear();
+
+	replay.replay(2, queue);
+	check(queue.empty(), "frame 2 has no events");
+	check(!replay.isFinished(3), "not finished before the last frame");
+
+	replay.replay(3, queue);
+	check(queue.size() == 2, "frame 3 event count");
+	auto &f = queue.front()->Finger();
+	check(queue.front()->Type() == EVENT_FINGER_UP, "finger type");
+	check(f.X == 30 && f.Y == 40 && f.DeltaX == 5 && f.DeltaY == -6 && f.Id == 7 && f.IsPrimary,
+	      "finger fields");
+	auto &d = queue.back()->Display();
+	check(queue.back()->Type() == EVENT_WINDOW_RESIZE, "display type");
+	check(d.Active && d.X == 1 && d.Y == 2 && d.Width == 800 && d.Height == 600,
+	      "display fields");
+	for (auto *e : queue)
+		delete e;
+
+	check(replay.isFinished(4), "finished after the last frame");
+
+	// Replayed settings are put back afterwards
+	replay.applySettings(settings);
+	check(settings.getString("Visual.ScaleY") == "150", "applied setting");
+	settings.set("Visual.ScaleY", UString("200"));
+	replay.applySettings(settings);
+	replay.restoreSettings(settings);
+	check(settings.getString("Visual.ScaleY") == "200", "restored setting");
+
+	remove(recordingPath);
+	PHYSFS_deinit();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+#include "library/strings.h"
+#include "framework/logger.h"
+
+#include <vector>
+
+using namespace OpenApoc;
+
+// "a", e-acute (2 bytes), "b", euro sign (3 bytes), "c", U+1F600 (4 bytes)
+static const char *mixedString = "a\xc3\xa9"
+                                 "b\xe2\x82\xac"
+                                 "c\xf0\x9f\x98\x80";
+
+void test_length(const UString &s, size_t expected)
+{
+	if (s.length() != expected)
+	{
+		LogError("\"%s\" has length %zu, expected %zu", s.c_str(), s.length(), expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_equal(const UString &s, const UString &expected)
+{
+	if (s != expected)
+	{
+		LogError("Got \"%s\", expected \"%s\"", s.c_str(), expected.c_str());
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_code_points(const UString &s, const std::vector<UniChar> &expected)
+{
+	std::vector<UniChar> codePoints;
+	for (UniChar c : s)
+	{
+		codePoints.push_back(c);
+	}
+	if (codePoints != expected)
+	{
+		LogError("Wrong code points decoded from \"%s\"", s.c_str());
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::ignore = argc;
+	std::ignore = argv;
+
+	UString ascii = "Hello, World";
+	UString mixed = mixedString;
+
+	test_length("", 0);
+	test_length(ascii, 12);
+	test_length(mixed, 6);
+	test_length(ascii + mixed, 18);
+
+	if (!ascii.isASCII() || mixed.isASCII() || (ascii + mixed).isASCII())
+	{
+		LogError("ASCII flag incorrect");
+		exit(EXIT_FAILURE);
+	}
+
+	test_code_points(ascii.substr(0, 3), {'H', 'e', 'l'});
+	test_code_points(mixed, {'a', 0xE9, 'b', 0x20AC, 'c', 0x1F600});
+	// A truncated sequence decodes as a single replacement character
+	test_code_points(UString("x\xe2\x82"), {'x', 0xFFFD});
+
+	test_equal(ascii.substr(7), "World");
+	test_equal(ascii.substr(7, 100), "World");
+	test_equal(mixed.substr(1, 3), "\xc3\xa9"
+	                               "b\xe2\x82\xac");
+	test_equal(mixed.substr(5), "\xf0\x9f\x98\x80");
+	test_equal(mixed.substr(6), "");
+
+	UString edited = mixed;
+	edited.remove(1, 2);
+	test_equal(edited, "a\xe2\x82\xac"
+	                   "c\xf0\x9f\x98\x80");
+	test_length(edited, 4);
+	edited.insert(1, "xy");
+	test_equal(edited, "axy\xe2\x82\xac"
+	                   "c\xf0\x9f\x98\x80");
+	test_length(edited, 6);
+	edited.remove(3, UString::npos);
+	test_equal(edited, "axy");
+	if (!edited.isASCII())
+	{
+		LogError("Removing all non-ASCII characters didn't set the ASCII flag");
+		exit(EXIT_FAILURE);
+	}
+
+	test_equal(ascii.toUpper(), "HELLO, WORLD");
+	test_equal(ascii.toLower(), "hello, world");
+
+	UString moved = std::move(edited);
+	test_length(moved, 3);
+	test_length(edited, 0);
+
+	return EXIT_SUCCESS;
+}